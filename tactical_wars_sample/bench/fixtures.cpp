@@ -0,0 +1,138 @@
+#include <bench/fixtures.hpp>
+#include <game/level.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+constexpr uint32_t TILESET_TILE_COUNT = 360;
+constexpr uint32_t PLAIN_GID = 1;
+constexpr uint32_t OBSTACLE_GID = 2;
+constexpr uint32_t FIRST_ANIMATED_ID = 2;
+
+// Files are reused across runs, bump this whenever the generated maps or tilesets change
+constexpr uint32_t FIXTURE_VERSION = 2;
+
+static std::filesystem::path GetFixtureDirectory()
+{
+    auto directory = std::filesystem::temp_directory_path() / std::format("tactical_wars_bench_v{}", FIXTURE_VERSION);
+    std::filesystem::create_directories(directory);
+
+    // The tileset image is shared with the sample, copied next to the fixtures whenever it was edited
+    auto image = directory / "tiles.png";
+    std::filesystem::copy_file("assets/images/tiles/Tiles_Fantasy_minimap_32x32.png", image, std::filesystem::copy_options::update_existing);
+
+    return directory;
+}
+
+static std::string WriteSyntheticTileSet(const std::filesystem::path& directory, uint32_t animated_tiles)
+{
+    animated_tiles = std::min(animated_tiles, TILESET_TILE_COUNT - FIRST_ANIMATED_ID);
+
+    auto file_name = std::format("tileset_{}.tsx", animated_tiles);
+    auto path = directory / file_name;
+
+    if (std::filesystem::exists(path))
+    {
+        return file_name;
+    }
+
+    std::ofstream file { path };
+    file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    file << std::format("<tileset version=\"1.10\" name=\"bench\" tilewidth=\"32\" tileheight=\"32\" tilecount=\"{}\" columns=\"20\">\n", TILESET_TILE_COUNT);
+    file << " <image source=\"tiles.png\" width=\"640\" height=\"576\"/>\n";
+    file << " <tile id=\"1\">\n  <properties>\n   <property name=\"Obstacle\" type=\"bool\" value=\"true\"/>\n  </properties>\n </tile>\n";
+
+    for (uint32_t id = FIRST_ANIMATED_ID; id < FIRST_ANIMATED_ID + animated_tiles; ++id)
+    {
+        file << std::format(" <tile id=\"{}\">\n  <animation>\n", id);
+
+        for (uint32_t frame = 0; frame < 4; ++frame)
+        {
+            file << std::format("   <frame tileid=\"{}\" duration=\"{}\"/>\n", (id + frame * 7) % TILESET_TILE_COUNT, 100 + (id % 4) * 50);
+        }
+
+        file << "  </animation>\n </tile>\n";
+    }
+
+    file << "</tileset>\n";
+    return file_name;
+}
+
+std::string WriteSyntheticMap(const SyntheticMapConfig& config)
+{
+    auto directory = GetFixtureDirectory();
+    auto tileset_name = WriteSyntheticTileSet(directory, config.animated_tiles);
+
+    auto path = directory / std::format("map_{}_{}_{}_{}.tmx", config.size, config.obstacle_percent, config.animated_tiles, config.seed);
+
+    if (std::filesystem::exists(path))
+    {
+        return path.string();
+    }
+
+    std::mt19937_64 rng { config.seed };
+    std::uniform_int_distribution<uint32_t> percent { 0, 99 };
+    uint32_t centre = config.size / 2;
+
+    std::ofstream file { path };
+    file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    file << std::format("<map version=\"1.10\" orientation=\"orthogonal\" renderorder=\"right-down\" width=\"{0}\" height=\"{0}\" tilewidth=\"32\" tileheight=\"32\" infinite=\"0\" nextlayerid=\"2\" nextobjectid=\"1\">\n", config.size);
+    file << std::format(" <tileset firstgid=\"1\" source=\"{}\"/>\n", tileset_name);
+    file << std::format(" <layer id=\"1\" name=\"Terrain\" width=\"{0}\" height=\"{0}\">\n  <data encoding=\"csv\">\n", config.size);
+
+    for (uint32_t y = 0; y < config.size; ++y)
+    {
+        for (uint32_t x = 0; x < config.size; ++x)
+        {
+            // The centre stays free for the benchmarked unit
+            bool obstacle = percent(rng) < config.obstacle_percent && !(x == centre && y == centre);
+            bool last = x + 1 == config.size && y + 1 == config.size;
+
+            file << (obstacle ? OBSTACLE_GID : PLAIN_GID) << (last ? "" : ",");
+        }
+
+        file << "\n";
+    }
+
+    file << "</data>\n </layer>\n</map>\n";
+    return path.string();
+}
+
+GameState CreateBenchGameState(const SyntheticMapConfig& config)
+{
+    GameState game_state {};
+    game_state.current_level = std::make_shared<Level>(LoadLevelData(WriteSyntheticMap(config)));
+    game_state.unit_state = SetupUnitMapState(*game_state.current_level);
+    game_state.teams = { UnitTeam::RED, UnitTeam::BLUE };
+    AdvanceTurn(game_state);
+
+    for (auto& tileset : game_state.current_level->map.getTileSets())
+    {
+        tileset.getImage().freeData();
+    }
+
+    std::mt19937_64 rng { config.seed + 1 };
+    std::uniform_int_distribution<uint32_t> percent { 0, 99 };
+
+    auto& terrain = game_state.current_level->terrain;
+    auto& units = game_state.unit_state.units;
+
+    for (auto it = units.begin(); it != units.end(); ++it)
+    {
+        auto tile = it.getIndices();
+
+        if (terrain.at(tile.x, tile.y).move_cost != 0 && percent(rng) < 5)
+        {
+            *it = Unit { UnitTeam::BLUE, UnitType::SOLDIER, UnitState::IDLE, false, 100 };
+        }
+    }
+
+    units.at(config.size / 2, config.size / 2) = Unit { UnitTeam::RED, UnitType::SOLDIER, UnitState::IDLE, true, 100 };
+    return game_state;
+}
+
+glm::uvec2 GetBenchUnitTile(const GameState& game_state)
+{
+    auto grid_size = game_state.current_level->map.getMapGridSize();
+    return { grid_size.x / 2, grid_size.y / 2 };
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <game/game_state.hpp>
+#include <string>
+
+// Synthetic maps for the micro benchmarks, written to a temporary directory and loaded with the
+// regular level code. The tileset reuses the terrain spritesheet, so run from the repository root.
+struct SyntheticMapConfig
+{
+    uint32_t size = 64; // Square grid
+    uint32_t obstacle_percent = 10;
+    uint32_t animated_tiles = 16; // Animated tiles in the tileset, drawn or not
+    uint64_t seed = 0;
+};
+
+// Returns the path of the .tmx, files are only written once per config and fixture version
+std::string WriteSyntheticMap(const SyntheticMapConfig& config);
+
+// Level loaded from a synthetic map. One soldier stands in the centre, with enemies scattered
+// over a twentieth of the free tiles.
+GameState CreateBenchGameState(const SyntheticMapConfig& config);
+glm::uvec2 GetBenchUnitTile(const GameState& game_state);
@@ -0,0 +1,315 @@
+#include <engine/common.hpp>
+
+#include <bench/fixtures.hpp>
+#include <benchmark/benchmark.h>
+#include <game/cursor.hpp>
+#include <game/flow_field.hpp>
+#include <game/level.hpp>
+#include <game/pathfinding.hpp>
+#include <game/text.hpp>
+#include <algorithm>
+#include <map>
+
+// Isolated game logic kernels on synthetic fixtures. Never creates a window or renderer.
+//
+// Usage: TacticalWarsMicroBench [--benchmark_filter=REGEX] [--benchmark_repetitions=N]
+//                               [--benchmark_out=results.json --benchmark_out_format=json]
+
+// Fixtures are built once per config and shared by every run of a benchmark
+static const GameState& GetGameState(const SyntheticMapConfig& config)
+{
+    static std::map<std::tuple<uint32_t, uint32_t, uint32_t>, GameState> states {};
+    auto key = std::tuple { config.size, config.obstacle_percent, config.animated_tiles };
+
+    auto it = states.find(key);
+
+    if (it == states.end())
+    {
+        it = states.emplace(key, CreateBenchGameState(config)).first;
+    }
+
+    return it->second;
+}
+
+static void BM_CalculateSelectedCursorState(benchmark::State& state)
+{
+    SyntheticMapConfig config {};
+    config.obstacle_percent = state.range(0);
+
+    auto& game_state = GetGameState(config);
+    auto tile = GetBenchUnitTile(game_state);
+
+    for (auto _ : state)
+    {
+        auto cursor_state = CalculateSelectedCursorState(game_state, tile);
+        benchmark::DoNotOptimize(cursor_state);
+    }
+}
+
+BENCHMARK(BM_CalculateSelectedCursorState)->ArgName("obstacle_percent")->Arg(0)->Arg(10)->Arg(25)->Arg(40);
+
+static void BM_FindMoveTiles(benchmark::State& state)
+{
+    SyntheticMapConfig config {};
+    config.obstacle_percent = state.range(1);
+
+    auto& game_state = GetGameState(config);
+    auto tile = GetBenchUnitTile(game_state);
+    size_t reached = 0;
+
+    for (auto _ : state)
+    {
+        auto move_tiles = FindMoveTiles(*game_state.current_level, game_state.unit_state, tile, state.range(0));
+        reached = move_tiles.size();
+        benchmark::DoNotOptimize(move_tiles);
+    }
+
+    state.counters["reached_tiles"] = reached;
+}
+
+BENCHMARK(BM_FindMoveTiles)->ArgNames({ "range", "obstacle_percent" })->ArgsProduct({ { 2, 4, 8, 16 }, { 0, 10, 25, 40 } });
+
+static void BM_BuildFlowField(benchmark::State& state)
+{
+    SyntheticMapConfig config {};
+    config.size = state.range(0);
+
+    auto& game_state = GetGameState(config);
+    auto cache = CreateFlowFieldCache(*game_state.current_level);
+    SyncFlowFieldBlockers(cache, game_state.unit_state);
+
+    for (auto _ : state)
+    {
+        cache.fields.clear();
+        benchmark::DoNotOptimize(GetFlowField(cache, GetBenchUnitTile(game_state)).directions.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * config.size * config.size);
+}
+
+BENCHMARK(BM_BuildFlowField)->ArgName("size")->Arg(32)->Arg(64)->Arg(128);
+
+// One unit stepping back and forth next to the target, as happens between the moves of a turn
+static void BM_RepairFlowField(benchmark::State& state)
+{
+    SyntheticMapConfig config {};
+    config.size = state.range(0);
+
+    auto& game_state = GetGameState(config);
+    auto cache = CreateFlowFieldCache(*game_state.current_level);
+    SyncFlowFieldBlockers(cache, game_state.unit_state);
+
+    auto target = GetBenchUnitTile(game_state);
+    auto from = target + glm::uvec2(2, 0);
+    auto to = target + glm::uvec2(2, 1);
+    GetFlowField(cache, target);
+
+    for (auto _ : state)
+    {
+        SetFlowTileBlocked(cache, from, false);
+        SetFlowTileBlocked(cache, to, true);
+        benchmark::DoNotOptimize(GetFlowField(cache, target).directions.data());
+        std::swap(from, to);
+    }
+}
+
+BENCHMARK(BM_RepairFlowField)->ArgName("size")->Arg(32)->Arg(64)->Arg(128);
+
+// From the centre unit to the enemies furthest away, with every unit blocking its tile
+static void BM_FindLongPath(benchmark::State& state)
+{
+    SyntheticMapConfig config {};
+    config.size = state.range(0);
+
+    auto& game_state = GetGameState(config);
+    auto graph = BuildPathGraph(*game_state.current_level);
+    SyncPathGraphBlockers(graph, game_state.unit_state);
+
+    auto start = GetBenchUnitTile(game_state);
+    std::vector<glm::uvec2> goals {};
+
+    for (auto it = game_state.unit_state.units.begin(); it != game_state.unit_state.units.end(); ++it)
+    {
+        if ((*it).health > 0 && (*it).team != UnitTeam::RED)
+        {
+            goals.emplace_back(it.getIndices().x, it.getIndices().y);
+        }
+    }
+
+    auto distance = [&](const glm::uvec2& tile)
+    {
+        auto d = glm::abs(glm::ivec2(tile) - glm::ivec2(start));
+        return d.x + d.y;
+    };
+
+    std::sort(goals.begin(), goals.end(), [&](const glm::uvec2& lhs, const glm::uvec2& rhs)
+        { return distance(lhs) > distance(rhs); });
+    goals.resize(std::min<size_t>(goals.size(), 16));
+
+    size_t next_goal = 0;
+    size_t found = 0;
+
+    for (auto _ : state)
+    {
+        auto path = FindLongPath(graph, start, goals.at(next_goal));
+        found += path.has_value();
+        benchmark::DoNotOptimize(path);
+
+        next_goal = (next_goal + 1) % goals.size();
+    }
+
+    state.counters["found_percent"] = 100.0 * found / std::max<size_t>(state.iterations(), 1);
+    state.counters["abstract_nodes"] = graph.nodes.size();
+}
+
+BENCHMARK(BM_FindLongPath)->ArgName("size")->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+static void BM_AttackUnit(benchmark::State& state)
+{
+    // Every health and defence pairing, so no branch outcome is always the same
+    std::vector<std::tuple<Unit, Unit, uint8_t, uint8_t>> fights {};
+
+    for (int8_t attacker_health = 10; attacker_health <= 100; attacker_health += 10)
+    {
+        for (int8_t defender_health = 5; defender_health <= 100; defender_health += 5)
+        {
+            auto defence = uint8_t((attacker_health + defender_health) % 40);
+
+            fights.emplace_back(
+                Unit { UnitTeam::RED, UnitType::SOLDIER, UnitState::IDLE, true, attacker_health },
+                Unit { UnitTeam::BLUE, UnitType::SOLDIER, UnitState::IDLE, false, defender_health },
+                defence, uint8_t(40 - defence));
+        }
+    }
+
+    for (auto _ : state)
+    {
+        for (auto [attacker, defender, attacker_defence, defender_defence] : fights)
+        {
+            AttackUnit(attacker, defender, attacker_defence, defender_defence);
+            benchmark::DoNotOptimize(attacker);
+            benchmark::DoNotOptimize(defender);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * fights.size());
+}
+
+BENCHMARK(BM_AttackUnit);
+
+static void BM_GetTileRect(benchmark::State& state)
+{
+    SyntheticMapConfig config {};
+    config.animated_tiles = 64;
+
+    auto& tileset = GetGameState(config).current_level->map.getTileSets().front();
+    TileSetDrawData draw_data {};
+    ResetAnimationStates(tileset, draw_data);
+
+    // Static tiles sit after the animated ones in the synthetic tileset
+    bool animated = state.range(0) != 0;
+    uint32_t first_id = animated ? 2 : 2 + config.animated_tiles;
+
+    for (auto _ : state)
+    {
+        for (uint32_t id = first_id; id < first_id + 64; ++id)
+        {
+            benchmark::DoNotOptimize(GetTileRect(tileset, draw_data, id));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * 64);
+}
+
+BENCHMARK(BM_GetTileRect)->ArgName("animated")->Arg(0)->Arg(1);
+
+static void BM_UpdateAnimationData(benchmark::State& state)
+{
+    SyntheticMapConfig config {};
+    config.animated_tiles = state.range(0);
+
+    auto& tileset = GetGameState(config).current_level->map.getTileSets().front();
+    TileSetDrawData draw_data {};
+    ResetAnimationStates(tileset, draw_data);
+
+    for (auto _ : state)
+    {
+        // One 60 Hz frame
+        UpdateAnimationData(tileset, draw_data, DeltaMS(16.6f));
+        benchmark::DoNotOptimize(draw_data.animation_states);
+    }
+
+    state.SetItemsProcessed(state.iterations() * draw_data.animation_states.size());
+}
+
+BENCHMARK(BM_UpdateAnimationData)->ArgName("animated_tiles")->Arg(16)->Arg(64)->Arg(256);
+
+// Fixed metrics in place of a loaded font, layout only reads these getters
+struct SyntheticGlyphs
+{
+    FontMetrics GetFontMetrics() const
+    {
+        FontMetrics metrics {};
+        metrics.resolution = 32.0f;
+        metrics.ascent = 24.0f;
+        return metrics;
+    }
+
+    GlyphInfo GetCodepointInfo(char32_t codepoint) const
+    {
+        GlyphInfo glyph {};
+        glyph.left_bearing = 1.0f;
+        glyph.advance = 14.0f + codepoint % 5;
+        glyph.offset = { 0.0f, -20.0f };
+        glyph.atlas_index = codepoint % 96;
+        return glyph;
+    }
+
+    float GetKerning(char32_t lhs, char32_t rhs) const
+    {
+        return (lhs + rhs) % 3 == 0 ? -1.0f : 0.0f;
+    }
+};
+
+static void BM_LayoutText(benchmark::State& state)
+{
+    unicode::String text {};
+
+    for (int64_t i = 0; i < state.range(0); ++i)
+    {
+        text.push_back(U'a' + i % 26);
+    }
+
+    SyntheticGlyphs glyphs {};
+    std::vector<CodepointDraw> layout {};
+
+    for (auto _ : state)
+    {
+        LayoutText(layout, glyphs, text, glm::vec2(10.0f, 20.0f), 0.5f);
+        benchmark::DoNotOptimize(layout.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * text.size());
+}
+
+BENCHMARK(BM_LayoutText)->ArgName("characters")->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_LoadLevelData(benchmark::State& state)
+{
+    SyntheticMapConfig config {};
+    config.size = state.range(0);
+
+    auto path = WriteSyntheticMap(config);
+
+    for (auto _ : state)
+    {
+        auto level = LoadLevelData(path);
+        benchmark::DoNotOptimize(level);
+    }
+
+    state.SetItemsProcessed(state.iterations() * config.size * config.size);
+}
+
+BENCHMARK(BM_LoadLevelData)->ArgName("size")->Arg(16)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,266 @@
+#include <game/ai.hpp>
+#include <game/combat.hpp>
+
+#include <algorithm>
+
+static constexpr glm::ivec2 DIRECTIONS[4] = {
+    glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1)
+};
+
+static bool IsInsideLevel(const Level& level, const glm::ivec2& tile)
+{
+    auto size = level.map.getMapGridSize();
+    return tile.x >= 0 && tile.y >= 0 && tile.x < (int)size.x && tile.y < (int)size.y;
+}
+
+static bool IsEnemy(const Unit& unit, UnitTeam team)
+{
+    return unit.health > 0 && unit.team != team;
+}
+
+static bool CanStopAt(const UnitMapState& unit_map, const glm::uvec2& unit_tile, const glm::uvec2& tile)
+{
+    return tile == unit_tile || unit_map.units.at(tile.x, tile.y).health == 0;
+}
+
+static std::optional<glm::uvec2> FindNearestEnemy(const UnitMapState& unit_map, const glm::uvec2& unit_tile, UnitTeam team)
+{
+    std::optional<glm::uvec2> nearest_enemy {};
+    int nearest_distance = std::numeric_limits<int>::max();
+
+    for (auto it = unit_map.units.begin(); it != unit_map.units.end(); ++it)
+    {
+        if (!IsEnemy(*it, team))
+        {
+            continue;
+        }
+
+        auto diff = glm::abs(glm::ivec2(it.getIndices().x, it.getIndices().y) - glm::ivec2(unit_tile));
+
+        if (diff.x + diff.y < nearest_distance)
+        {
+            nearest_distance = diff.x + diff.y;
+            nearest_enemy = glm::uvec2 { it.getIndices().x, it.getIndices().y };
+        }
+    }
+
+    return nearest_enemy;
+}
+
+static std::vector<glm::uvec2> FindAttackTargets(const Level& level, const UnitMapState& unit_map, const glm::uvec2& from, UnitTeam team)
+{
+    std::vector<glm::uvec2> targets {};
+
+    for (auto dir : DIRECTIONS)
+    {
+        auto adjacent = glm::ivec2(from) + dir;
+
+        if (IsInsideLevel(level, adjacent) && IsEnemy(unit_map.units.at(adjacent.x, adjacent.y), team))
+        {
+            targets.emplace_back(adjacent);
+        }
+    }
+
+    return targets;
+}
+
+static UnitAction PlanScriptedAction(const GameState& game_state, const glm::uvec2& unit_tile, std::mt19937_64& rng)
+{
+    const auto& level = *game_state.current_level;
+    const auto& unit_map = game_state.unit_state;
+    auto team = unit_map.units.at(unit_tile.x, unit_tile.y).team;
+
+    std::vector<glm::uvec2> destinations {};
+
+    for (auto& [tile, path] : FindMoveTiles(level, unit_map, unit_tile))
+    {
+        if (CanStopAt(unit_map, unit_tile, tile))
+        {
+            destinations.emplace_back(tile);
+        }
+    }
+
+    // Map iteration order is not deterministic across standard libraries
+    std::sort(destinations.begin(), destinations.end(), [](auto a, auto b)
+        { return std::tie(a.y, a.x) < std::tie(b.y, b.x); });
+
+    UnitAction action { unit_tile, unit_tile };
+    action.move_tile = destinations.at(rng() % destinations.size());
+
+    if (auto targets = FindAttackTargets(level, unit_map, action.move_tile, team); !targets.empty())
+    {
+        action.attack_tile = targets.at(rng() % targets.size());
+    }
+
+    return action;
+}
+
+static UnitAction PlanAIAction(const GameState& game_state, const glm::uvec2& unit_tile, PathGraph& path_graph, FlowFieldCache* flow_fields)
+{
+    const auto& level = *game_state.current_level;
+    const auto& unit_map = game_state.unit_state;
+    const auto unit = unit_map.units.at(unit_tile.x, unit_tile.y);
+
+    auto move_tiles = FindMoveTiles(level, unit_map, unit_tile);
+
+    // Best trade reachable this turn, all candidate fights are forecast in one batch
+    CombatForecastBatch forecasts {};
+    std::vector<UnitAction> candidates {};
+
+    for (auto& [tile, path] : move_tiles)
+    {
+        if (!CanStopAt(unit_map, unit_tile, tile))
+        {
+            continue;
+        }
+
+        for (auto target : FindAttackTargets(level, unit_map, tile, unit.team))
+        {
+            AddCombatForecast(forecasts, unit, unit_map.units.at(target.x, target.y), level.terrain.at(tile.x, tile.y).defence, level.terrain.at(target.x, target.y).defence);
+            candidates.emplace_back(UnitAction { unit_tile, tile, target });
+        }
+    }
+
+    ForecastCombat(forecasts);
+
+    std::optional<UnitAction> best_attack {};
+    int best_score = 0;
+
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        auto& candidate = candidates.at(i);
+        bool defender_killed = forecasts.defender_killed.at(i) != 0;
+        bool attacker_killed = forecasts.attacker_killed.at(i) != 0;
+
+        int dealt = defender_killed ? forecasts.defender_health.at(i) : forecasts.defender_damage.at(i);
+        int taken = attacker_killed ? unit.health : forecasts.attacker_damage.at(i);
+        int score = dealt - taken + (defender_killed ? 100 : 0);
+
+        auto tile = candidate.move_tile;
+        auto target = candidate.attack_tile.value();
+
+        bool better = !best_attack || score > best_score
+            || (score == best_score && std::tie(tile.y, tile.x, target.y, target.x) < std::tie(best_attack->move_tile.y, best_attack->move_tile.x, best_attack->attack_tile->y, best_attack->attack_tile->x));
+
+        if (better)
+        {
+            best_attack = candidate;
+            best_score = score;
+        }
+    }
+
+    if (best_attack && best_score >= 0)
+    {
+        return best_attack.value();
+    }
+
+    // Otherwise advance along the long range route to the nearest enemy
+    auto nearest_enemy = FindNearestEnemy(unit_map, unit_tile, unit.team);
+    UnitAction action { unit_tile, unit_tile };
+
+    if (!nearest_enemy)
+    {
+        return action;
+    }
+
+    if (flow_fields)
+    {
+        const auto& field = GetFlowField(*flow_fields, nearest_enemy.value());
+        auto tile = unit_tile;
+
+        while (auto next = GetFlowStep(field, tile))
+        {
+            if (!move_tiles.contains(next.value()))
+            {
+                break;
+            }
+
+            tile = next.value();
+
+            if (CanStopAt(unit_map, unit_tile, tile))
+            {
+                action.move_tile = tile;
+            }
+        }
+    }
+    else if (auto route = FindLongPath(path_graph, unit_tile, nearest_enemy.value()))
+    {
+        for (auto tile : route->tiles)
+        {
+            if (!move_tiles.contains(tile))
+            {
+                break;
+            }
+
+            if (CanStopAt(unit_map, unit_tile, tile))
+            {
+                action.move_tile = tile;
+            }
+        }
+    }
+
+    return action;
+}
+
+std::vector<glm::uvec2> PlayTurn(GameState& game_state, PlayerKind player, PathGraph& path_graph, std::mt19937_64& rng, std::vector<UnitAction>* played_actions, FlowFieldCache* flow_fields)
+{
+    auto team = GetCurrentTeam(game_state);
+    std::vector<glm::uvec2> unit_tiles {};
+    std::vector<glm::uvec2> changed_tiles {};
+
+    for (auto it = game_state.unit_state.units.begin(); it != game_state.unit_state.units.end(); ++it)
+    {
+        if ((*it).health > 0 && (*it).team == team && (*it).state == UnitState::IDLE)
+        {
+            unit_tiles.emplace_back(it.getIndices().x, it.getIndices().y);
+        }
+    }
+
+    if (flow_fields && player == PlayerKind::AI)
+    {
+        // Fields towards every likely target are built up front, in parallel
+        std::vector<glm::uvec2> targets {};
+
+        for (auto tile : unit_tiles)
+        {
+            if (auto enemy = FindNearestEnemy(game_state.unit_state, tile, team))
+            {
+                targets.emplace_back(enemy.value());
+            }
+        }
+
+        PrepareFlowFields(*flow_fields, targets);
+    }
+
+    for (auto tile : unit_tiles)
+    {
+        auto unit = game_state.unit_state.units.at(tile.x, tile.y);
+
+        // Killed by a counter attack earlier in the turn
+        if (unit.health <= 0 || unit.team != team || unit.state != UnitState::IDLE)
+        {
+            continue;
+        }
+
+        auto action = player == PlayerKind::AI
+            ? PlanAIAction(game_state, tile, path_graph, flow_fields)
+            : PlanScriptedAction(game_state, tile, rng);
+
+        auto changed = ApplyUnitAction(*game_state.current_level, game_state.unit_state, action);
+        changed_tiles.insert(changed_tiles.end(), changed.begin(), changed.end());
+
+        UpdatePathGraphBlockers(path_graph, game_state.unit_state, changed);
+
+        if (flow_fields)
+        {
+            UpdateFlowFieldBlockers(*flow_fields, game_state.unit_state, changed);
+        }
+
+        if (played_actions)
+        {
+            played_actions->emplace_back(action);
+        }
+    }
+
+    return changed_tiles;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <game/flow_field.hpp>
+#include <game/game_state.hpp>
+#include <random>
+
+enum class PlayerKind : uint8_t
+{
+    SCRIPTED, // Random legal moves, attacks whatever is adjacent
+    AI // Greedy: best trade in reach, otherwise advances towards the nearest enemy
+};
+
+// Plays every idle unit of the current team once. The path graph is only used
+// for routing towards enemies outside the movement range. With flow fields, units heading for
+// the same enemy share one field instead, which routes around every unit on the map.
+// The blockers of the graph and the fields have to match the units when the turn starts, the moves
+// played here keep them in sync. Returns the tiles whose contents changed, the applied actions are
+// appended to played_actions.
+std::vector<glm::uvec2> PlayTurn(GameState& game_state, PlayerKind player, PathGraph& path_graph, std::mt19937_64& rng, std::vector<UnitAction>* played_actions = nullptr, FlowFieldCache* flow_fields = nullptr);
@@ -0,0 +1,104 @@
+#include <game/asset_watcher.hpp>
+
+#include <algorithm>
+#include <filesystem>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+AssetWatcher::AssetWatcher(const std::vector<std::string>& directories)
+{
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (inotify_fd < 0)
+    {
+        return;
+    }
+
+    // Editors either write in place or save to a temporary file and rename it
+    constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+    auto add_watch = [&](const std::filesystem::path& dir)
+    {
+        int wd = inotify_add_watch(inotify_fd, dir.c_str(), WATCH_MASK);
+
+        if (wd >= 0)
+        {
+            watched_directories.emplace(wd, dir.string());
+        }
+    };
+
+    for (auto& directory : directories)
+    {
+        std::error_code error {};
+        add_watch(directory);
+
+        for (auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+        {
+            if (entry.is_directory())
+            {
+                add_watch(entry.path());
+            }
+        }
+    }
+#endif
+}
+
+AssetWatcher::~AssetWatcher()
+{
+#ifdef __linux__
+    if (inotify_fd >= 0)
+    {
+        close(inotify_fd);
+    }
+#endif
+}
+
+std::vector<std::string> AssetWatcher::PollChangedFiles()
+{
+    std::vector<std::string> changed {};
+
+#ifdef __linux__
+    if (inotify_fd < 0)
+    {
+        return changed;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+
+    while (true)
+    {
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+
+        if (length <= 0)
+        {
+            break;
+        }
+
+        for (char* ptr = buffer; ptr < buffer + length;)
+        {
+            auto* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            auto dir = watched_directories.find(event->wd);
+
+            if (event->len == 0 || dir == watched_directories.end())
+            {
+                continue;
+            }
+
+            auto path = (std::filesystem::path(dir->second) / event->name).lexically_normal().string();
+
+            if (std::find(changed.begin(), changed.end(), path) == changed.end())
+            {
+                changed.emplace_back(path);
+            }
+        }
+    }
+#endif
+
+    return changed;
+}
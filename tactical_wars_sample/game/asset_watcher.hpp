@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports files written in the watched directories (and their subdirectories).
+// Backed by inotify, on other platforms no changes are ever reported.
+class AssetWatcher
+{
+public:
+    AssetWatcher(const std::vector<std::string>& directories);
+    ~AssetWatcher();
+
+    AssetWatcher(const AssetWatcher&) = delete;
+    AssetWatcher& operator=(const AssetWatcher&) = delete;
+
+    // Non-blocking, returns each changed path once per call
+    std::vector<std::string> PollChangedFiles();
+
+private:
+    int inotify_fd = -1;
+    std::unordered_map<int, std::string> watched_directories {};
+};
@@ -0,0 +1,151 @@
+#include <game/combat.hpp>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COMBAT_FORECAST_SSE2
+#endif
+
+static void ForecastCombatScalar(CombatForecastBatch& batch, size_t index)
+{
+    auto attacker_health = batch.attacker_health[index];
+    auto defender_health = batch.defender_health[index];
+
+    auto defender_damage = CalculateDamage(batch.attack_multipliers[index], attacker_health);
+    defender_health -= defender_damage;
+
+    batch.defender_damage[index] = defender_damage;
+    batch.defender_killed[index] = defender_health < 0;
+    batch.attacker_damage[index] = 0;
+    batch.attacker_killed[index] = 0;
+
+    if (defender_health < 0)
+    {
+        return;
+    }
+
+    auto attacker_damage = CalculateDamage(batch.counter_multipliers[index], defender_health);
+    attacker_health -= attacker_damage;
+
+    batch.attacker_damage[index] = attacker_damage;
+    batch.attacker_killed[index] = attacker_health < 0;
+}
+
+#ifdef COMBAT_FORECAST_SSE2
+
+static __m128i LoadInt8x4(const void* data)
+{
+    int32_t packed {};
+    std::memcpy(&packed, data, sizeof(packed));
+
+    // Sign extend the four bytes to 32 bit lanes
+    __m128i value = _mm_cvtsi32_si128(packed);
+    value = _mm_unpacklo_epi8(value, value);
+    value = _mm_unpacklo_epi16(value, value);
+    return _mm_srai_epi32(value, 24);
+}
+
+static void StoreInt8x4(void* data, __m128i value)
+{
+    // Values are already in int8 range, so the saturating packs are exact
+    value = _mm_packs_epi32(value, value);
+    value = _mm_packs_epi16(value, value);
+
+    int32_t packed = _mm_cvtsi128_si32(value);
+    std::memcpy(data, &packed, sizeof(packed));
+}
+
+static __m128i WrapInt8(__m128i value)
+{
+    return _mm_srai_epi32(_mm_slli_epi32(value, 24), 24);
+}
+
+// Low 32 bits of each lane product, which are the same for signed and unsigned inputs.
+// SSE2 has no 32 bit multiply, so the even and odd lanes go through the 64 bit one.
+static __m128i MultiplyInt32(__m128i lhs, __m128i rhs)
+{
+    __m128i even = _mm_mul_epu32(lhs, rhs);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(lhs, 32), _mm_srli_epi64(rhs, 32));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Division by the fixed point one, rounding towards zero like the scalar integer division
+static __m128i DivideFixed(__m128i value)
+{
+    __m128i bias = _mm_and_si128(_mm_srai_epi32(value, 31), _mm_set1_epi32((1 << DAMAGE_FIXED_SHIFT) - 1));
+    return _mm_srai_epi32(_mm_add_epi32(value, bias), DAMAGE_FIXED_SHIFT);
+}
+
+static void ForecastCombatSSE2(CombatForecastBatch& batch, size_t index)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+
+    __m128i attacker_health = LoadInt8x4(batch.attacker_health.data() + index);
+    __m128i defender_health = LoadInt8x4(batch.defender_health.data() + index);
+
+    // Attack: fixed point product, then the int8_t narrowing of the damage and the subtraction
+    __m128i attack_multiplier = _mm_loadu_si128(reinterpret_cast<const __m128i*>(batch.attack_multipliers.data() + index));
+    __m128i defender_damage = WrapInt8(DivideFixed(MultiplyInt32(attack_multiplier, attacker_health)));
+    __m128i new_defender_health = WrapInt8(_mm_sub_epi32(defender_health, defender_damage));
+    __m128i defender_killed = _mm_cmplt_epi32(new_defender_health, zero);
+
+    // Counter attack, masked out where the defender died
+    __m128i counter_multiplier = _mm_loadu_si128(reinterpret_cast<const __m128i*>(batch.counter_multipliers.data() + index));
+    __m128i attacker_damage = WrapInt8(DivideFixed(MultiplyInt32(counter_multiplier, new_defender_health)));
+    attacker_damage = _mm_andnot_si128(defender_killed, attacker_damage);
+
+    __m128i new_attacker_health = WrapInt8(_mm_sub_epi32(attacker_health, attacker_damage));
+    __m128i attacker_killed = _mm_andnot_si128(defender_killed, _mm_cmplt_epi32(new_attacker_health, zero));
+
+    StoreInt8x4(batch.defender_damage.data() + index, defender_damage);
+    StoreInt8x4(batch.attacker_damage.data() + index, attacker_damage);
+    StoreInt8x4(batch.defender_killed.data() + index, _mm_and_si128(defender_killed, one));
+    StoreInt8x4(batch.attacker_killed.data() + index, _mm_and_si128(attacker_killed, one));
+}
+
+#endif
+
+void AddCombatForecast(CombatForecastBatch& batch, const Unit& attacker, const Unit& defender, uint8_t attacker_defence, uint8_t defender_defence)
+{
+    batch.attack_multipliers.emplace_back(GetDamageMultiplier(attacker.type, defender.type, defender_defence));
+    batch.counter_multipliers.emplace_back(GetDamageMultiplier(defender.type, attacker.type, attacker_defence));
+    batch.attacker_health.emplace_back(attacker.health);
+    batch.defender_health.emplace_back(defender.health);
+}
+
+void ClearCombatForecasts(CombatForecastBatch& batch)
+{
+    // Keeps the capacity, batches are usually refilled every frame
+    batch.attack_multipliers.clear();
+    batch.counter_multipliers.clear();
+    batch.attacker_health.clear();
+    batch.defender_health.clear();
+}
+
+void ForecastCombat(CombatForecastBatch& batch)
+{
+    size_t count = batch.attack_multipliers.size();
+    assert(batch.counter_multipliers.size() == count && batch.attacker_health.size() == count && batch.defender_health.size() == count);
+
+    batch.defender_damage.resize(count);
+    batch.attacker_damage.resize(count);
+    batch.defender_killed.resize(count);
+    batch.attacker_killed.resize(count);
+
+    size_t index = 0;
+
+#ifdef COMBAT_FORECAST_SSE2
+    for (; index + 4 <= count; index += 4)
+    {
+        ForecastCombatSSE2(batch, index);
+    }
+#endif
+
+    for (; index < count; ++index)
+    {
+        ForecastCombatScalar(batch, index);
+    }
+}
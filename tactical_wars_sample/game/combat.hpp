@@ -0,0 +1,24 @@
+#pragma once
+#include <game/unit.hpp>
+
+// Structure of arrays, so the forecast can run several fights per instruction.
+// Results match AttackUnit exactly: fixed point multiplier, truncation to int8_t
+// and a unit only dies when its health drops below zero.
+struct CombatForecastBatch
+{
+    std::vector<int32_t> attack_multipliers {}; // Attack matrix and terrain defence, resolved when added
+    std::vector<int32_t> counter_multipliers {};
+    std::vector<int8_t> attacker_health {};
+    std::vector<int8_t> defender_health {};
+
+    std::vector<int8_t> defender_damage {};
+    std::vector<int8_t> attacker_damage {}; // Counter attack, zero when the defender dies
+    std::vector<uint8_t> defender_killed {};
+    std::vector<uint8_t> attacker_killed {};
+};
+
+void AddCombatForecast(CombatForecastBatch& batch, const Unit& attacker, const Unit& defender, uint8_t attacker_defence = 0, uint8_t defender_defence = 0);
+void ClearCombatForecasts(CombatForecastBatch& batch);
+
+// Fills the result arrays for every fight in the batch
+void ForecastCombat(CombatForecastBatch& batch);
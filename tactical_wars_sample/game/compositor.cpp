@@ -0,0 +1,490 @@
+#include <game/compositor.hpp>
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define COMPOSITOR_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COMPOSITOR_SSE2
+#endif
+
+// One spritesheet as seen by a frame, in the same order as TileCompositor::sheets
+struct CompositorSource
+{
+    const tpp::TileSet* tileset {};
+    const TileSetDrawData* draw_data {};
+    glm::vec2 screen_tile_size {};
+    bool is_unit = false;
+};
+
+struct CompositorQuad
+{
+    uint32_t source {};
+    uint32_t tile_id {};
+    glm::ivec2 start {}; // Screen pixels covered, end exclusive
+    glm::ivec2 end {};
+    bool flipped = false;
+};
+
+struct CompositorScene
+{
+    std::vector<CompositorSource> sources {};
+    std::vector<CompositorQuad> quads {}; // Back to front
+};
+
+static int32_t RoundToPixel(float value)
+{
+    return (int32_t)std::floor(value + 0.5f);
+}
+
+// Source pixel for a destination pixel, nearest sampling at the pixel centre
+static uint32_t SampleIndex(uint32_t dst_index, uint32_t source_size, float screen_size)
+{
+    return std::min(uint32_t((dst_index + 0.5f) * source_size / screen_size), source_size - 1);
+}
+
+// Pixels are handled as little endian uint32_t, alpha in the top byte
+static uint32_t LoadPixel(const TileSetDrawData& draw_data, uint32_t x, uint32_t y)
+{
+    uint32_t pixel {};
+    std::memcpy(&pixel, draw_data.cpu_pixels->data() + (size_t(y) * draw_data.image_size.x + x) * 4, sizeof(pixel));
+    return pixel;
+}
+
+static uint32_t PackColour(const glm::vec4& colour)
+{
+    uint8_t bytes[4] = {
+        (uint8_t)RoundToPixel(glm::clamp(colour.x, 0.0f, 1.0f) * 255.0f),
+        (uint8_t)RoundToPixel(glm::clamp(colour.y, 0.0f, 1.0f) * 255.0f),
+        (uint8_t)RoundToPixel(glm::clamp(colour.z, 0.0f, 1.0f) * 255.0f),
+        (uint8_t)RoundToPixel(glm::clamp(colour.w, 0.0f, 1.0f) * 255.0f),
+    };
+
+    uint32_t pixel {};
+    std::memcpy(&pixel, bytes, sizeof(pixel));
+    return pixel;
+}
+
+static glm::vec2 GetScreenSize(const FrameCamera& camera, const glm::vec2& world_size)
+{
+    auto rect = camera.ToScreenRect(SDL_FRect { 0.0f, 0.0f, world_size.x, world_size.y });
+    return { rect.w, rect.h };
+}
+
+static CompositorQuad MakeQuad(const FrameCamera& camera, const CompositorSource& source, uint32_t source_index, uint32_t tile_id, const SDL_FRect& world_rect, bool flipped)
+{
+    auto rect = camera.ToScreenRect(world_rect);
+
+    CompositorQuad quad {};
+    quad.source = source_index;
+    quad.tile_id = tile_id;
+    quad.start = { RoundToPixel(rect.x), RoundToPixel(rect.y) };
+    quad.end = { RoundToPixel(rect.x + source.screen_tile_size.x), RoundToPixel(rect.y + source.screen_tile_size.y) };
+    quad.flipped = flipped;
+    return quad;
+}
+
+// Same draw order as DrawLevel followed by DrawMapUnits. Moving units are left out, they are drawn over the frame.
+static CompositorScene BuildScene(const Level& level, const GameAssets& assets, const UnitMapState& unit_map, const FrameCamera& camera, const glm::uvec2& screen_size, const FogVisibility* fog, const UnitTweens* tweens)
+{
+    CompositorScene scene {};
+
+    auto& tilesets = level.map.getTileSets();
+    auto grid_size = glm::uvec2 { level.map.getMapGridSize().x, level.map.getMapGridSize().y };
+    auto map_tile_size = glm::vec2 { level.map.getMapTileSize().x, level.map.getMapTileSize().y };
+
+    for (uint32_t i = 0; i < tilesets.size(); ++i)
+    {
+        scene.sources.emplace_back(CompositorSource { &tilesets.at(i), &level.tile_set_data.at(i), GetScreenSize(camera, map_tile_size) });
+    }
+
+    std::unordered_map<UnitTeam, uint32_t> team_sources {};
+
+    for (auto& [team, team_assets] : assets.team_assets)
+    {
+        glm::vec2 sprite_size = { team_assets.tileset.getTileSize().x, team_assets.tileset.getTileSize().y };
+
+        team_sources[team] = scene.sources.size();
+        scene.sources.emplace_back(CompositorSource { &team_assets.tileset, &team_assets.draw_data, GetScreenSize(camera, sprite_size * team_assets.scale), true });
+    }
+
+    // Tiles outside the screen are skipped, one tile of margin covers rounding and oversized sprites
+    auto world_start = camera.ToWorld(glm::vec2(0.0f)) / map_tile_size;
+    auto world_end = camera.ToWorld(glm::vec2(screen_size)) / map_tile_size;
+
+    auto visible_start = glm::uvec2(glm::clamp(glm::ivec2(glm::floor(world_start)) - 1, glm::ivec2(0), glm::ivec2(grid_size)));
+    auto visible_end = glm::uvec2(glm::clamp(glm::ivec2(glm::floor(world_end)) + 2, glm::ivec2(0), glm::ivec2(grid_size)));
+
+    auto& layers = level.map.getTileLayers();
+
+    for (uint32_t l = 0; l < layers.size(); ++l)
+    {
+        for (uint32_t y = visible_start.y; y < visible_end.y; ++y)
+        {
+            for (uint32_t x = visible_start.x; x < visible_end.x; ++x)
+            {
+                auto tile_id = layers.at(l).tile_ids.at(x, y);
+
+                if (!tile_id.isValid())
+                    continue;
+
+                // Hidden and fully transparent tiles
+                if (!IsLayerDrawn(level, l, x, y))
+                    continue;
+
+                auto& source = scene.sources.at(tile_id.getTileset());
+                auto animated_id = GetAnimatedTileId(*source.tileset, *source.draw_data, tile_id.getId());
+                SDL_FRect world_rect { x * map_tile_size.x, y * map_tile_size.y, map_tile_size.x, map_tile_size.y };
+
+                scene.quads.emplace_back(MakeQuad(camera, source, tile_id.getTileset(), animated_id, world_rect, false));
+            }
+        }
+    }
+
+    for (uint32_t y = visible_start.y; y < visible_end.y; ++y)
+    {
+        for (uint32_t x = visible_start.x; x < visible_end.x; ++x)
+        {
+            auto unit = unit_map.units.at(x, y);
+
+            if (unit.health <= 0 || IsUnitHidden(fog, { x, y }, unit) || IsUnitTweening(tweens, { x, y }))
+                continue;
+
+            auto& team_assets = assets.team_assets.at(unit.team);
+            auto source_index = team_sources.at(unit.team);
+            auto& source = scene.sources.at(source_index);
+
+            // Matches the placement in DrawUnit
+            glm::vec2 tile_size = unit_map.map_tile_size;
+            glm::vec2 sprite_size = { team_assets.tileset.getTileSize().x, team_assets.tileset.getTileSize().y };
+            glm::vec2 offset = (sprite_size * team_assets.scale - tile_size) * 0.5f;
+
+            SDL_FRect world_rect {
+                tile_size.x * x - offset.x,
+                tile_size.y * y - offset.y,
+                sprite_size.x * team_assets.scale,
+                sprite_size.y * team_assets.scale
+            };
+
+            auto tile_id = GetAnimatedTileId(team_assets.tileset, team_assets.draw_data, GetUnitAnimIndex(team_assets, unit.state));
+            scene.quads.emplace_back(MakeQuad(camera, source, source_index, tile_id, world_rect, !unit.facingRight));
+        }
+    }
+
+    return scene;
+}
+
+static CompositorSheet CreateCompositorSheet(const CompositorSource& source)
+{
+    auto& tileset = *source.tileset;
+    auto& draw_data = *source.draw_data;
+    assert(draw_data.cpu_pixels && "Tileset was loaded without keep_cpu_pixels");
+
+    CompositorSheet sheet {};
+    sheet.image_hash = draw_data.image_hash;
+    sheet.screen_tile_size = source.screen_tile_size;
+    sheet.cell_size = { (uint32_t)std::ceil(source.screen_tile_size.x), (uint32_t)std::ceil(source.screen_tile_size.y) };
+
+    size_t cell_pixels = size_t(sheet.cell_size.x) * sheet.cell_size.y;
+    sheet.cells.resize(cell_pixels * tileset.getTileCount());
+    sheet.opaque_cells.resize(tileset.getTileCount());
+
+    if (source.is_unit)
+    {
+        sheet.flipped_cells.resize(sheet.cells.size());
+    }
+
+    for (uint32_t i = 0; i < tileset.getTileCount(); ++i)
+    {
+        auto rect = tileset.getTileRect(i);
+
+        if (!rect)
+            continue;
+
+        bool opaque = true;
+
+        for (uint32_t y = 0; y < sheet.cell_size.y; ++y)
+        {
+            uint32_t source_y = rect->start.y + SampleIndex(y, rect->size.y, source.screen_tile_size.y);
+            size_t row = i * cell_pixels + size_t(y) * sheet.cell_size.x;
+
+            for (uint32_t x = 0; x < sheet.cell_size.x; ++x)
+            {
+                uint32_t offset = SampleIndex(x, rect->size.x, source.screen_tile_size.x);
+                uint32_t pixel = LoadPixel(draw_data, rect->start.x + offset, source_y);
+
+                sheet.cells[row + x] = pixel;
+                opaque &= (pixel >> 24) == 255;
+
+                if (source.is_unit)
+                {
+                    sheet.flipped_cells[row + x] = LoadPixel(draw_data, rect->start.x + rect->size.x - 1 - offset, source_y);
+                }
+            }
+        }
+
+        sheet.opaque_cells.at(i) = opaque;
+    }
+
+    return sheet;
+}
+
+// a * b / 255 the way the SDL software blitter divides (MULT_DIV_255)
+static uint32_t MultiplyDiv255(uint32_t a, uint32_t b)
+{
+    uint32_t x = a * b + 1;
+    return (x + (x >> 8)) >> 8;
+}
+
+// src * a / 255 + dst * (255 - a) / 255 per channel, each term divided on its own like the
+// blended blits of the software renderer, so both paths agree bit for bit.
+// The source alpha channel counts as 255.
+static uint32_t BlendPixel(uint32_t src, uint32_t dst)
+{
+    uint32_t alpha = src >> 24;
+    uint32_t result = 0;
+
+    for (uint32_t shift = 0; shift < 32; shift += 8)
+    {
+        uint32_t s = shift == 24 ? 255 : (src >> shift) & 0xFF;
+        uint32_t d = (dst >> shift) & 0xFF;
+
+        result |= (MultiplyDiv255(s, alpha) + MultiplyDiv255(d, 255 - alpha)) << shift;
+    }
+
+    return result;
+}
+
+static void BlendRowScalar(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dst[i] = BlendPixel(src[i], dst[i]);
+    }
+}
+
+#if defined(COMPOSITOR_AVX2)
+
+// Eight pixels per iteration, same arithmetic as BlendPixel in 16 bit lanes
+static uint32_t BlendRowAVX2(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32(int32_t(0xFF000000));
+    const __m256i max = _mm256_set1_epi16(255);
+    const __m256i one = _mm256_set1_epi16(1);
+
+    uint32_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i s_opaque = _mm256_or_si256(s, alpha_mask);
+
+        auto blend_half = [&](__m256i s16, __m256i d16, __m256i a16)
+        {
+            a16 = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(a16, 0xFF), 0xFF);
+            auto multiply_div_255 = [&](__m256i lhs, __m256i rhs)
+            {
+                __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(lhs, rhs), one);
+                return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+            };
+
+            return _mm256_add_epi16(multiply_div_255(s16, a16), multiply_div_255(d16, _mm256_sub_epi16(max, a16)));
+        };
+
+        __m256i lo = blend_half(_mm256_unpacklo_epi8(s_opaque, zero), _mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+        __m256i hi = blend_half(_mm256_unpackhi_epi8(s_opaque, zero), _mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+
+    return i;
+}
+
+#endif
+
+#if defined(COMPOSITOR_SSE2)
+
+// Four pixels per iteration, same arithmetic as BlendPixel in 16 bit lanes
+static uint32_t BlendRowSSE2(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32(int32_t(0xFF000000));
+    const __m128i max = _mm_set1_epi16(255);
+    const __m128i one = _mm_set1_epi16(1);
+
+    uint32_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i s_opaque = _mm_or_si128(s, alpha_mask);
+
+        auto blend_half = [&](__m128i s16, __m128i d16, __m128i a16)
+        {
+            a16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a16, 0xFF), 0xFF);
+            auto multiply_div_255 = [&](__m128i lhs, __m128i rhs)
+            {
+                __m128i x = _mm_add_epi16(_mm_mullo_epi16(lhs, rhs), one);
+                return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+            };
+
+            return _mm_add_epi16(multiply_div_255(s16, a16), multiply_div_255(d16, _mm_sub_epi16(max, a16)));
+        };
+
+        __m128i lo = blend_half(_mm_unpacklo_epi8(s_opaque, zero), _mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+        __m128i hi = blend_half(_mm_unpackhi_epi8(s_opaque, zero), _mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+
+    return i;
+}
+
+#endif
+
+static void BlendRowSIMD(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+    uint32_t done = 0;
+
+#if defined(COMPOSITOR_AVX2)
+    done = BlendRowAVX2(dst, src, count);
+#elif defined(COMPOSITOR_SSE2)
+    done = BlendRowSSE2(dst, src, count);
+#endif
+
+    BlendRowScalar(dst + done, src + done, count - done);
+}
+
+const char* GetCompositorSimdName()
+{
+#if defined(COMPOSITOR_AVX2)
+    return "AVX2";
+#elif defined(COMPOSITOR_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+static void UpdateCompositorSheets(TileCompositor& compositor, const CompositorScene& scene)
+{
+    compositor.sheets.resize(scene.sources.size());
+
+    for (uint32_t i = 0; i < scene.sources.size(); ++i)
+    {
+        auto& source = scene.sources.at(i);
+        auto& sheet = compositor.sheets.at(i);
+
+        bool outdated = sheet.image_hash != source.draw_data->image_hash
+            || sheet.screen_tile_size != source.screen_tile_size
+            || sheet.cells.empty();
+
+        if (outdated)
+        {
+            sheet = CreateCompositorSheet(source);
+        }
+    }
+}
+
+void CompositeFrame(
+    TileCompositor& compositor,
+    const Level& level,
+    const GameAssets& assets,
+    const UnitMapState& unit_map,
+    const FrameCamera& camera,
+    const glm::uvec2& screen_size,
+    const glm::vec4& clear_colour,
+    const FogVisibility* fog,
+    const UnitTweens* tweens)
+{
+    auto scene = BuildScene(level, assets, unit_map, camera, screen_size, fog, tweens);
+    UpdateCompositorSheets(compositor, scene);
+
+    compositor.framebuffer_size = screen_size;
+    compositor.framebuffer.assign(size_t(screen_size.x) * screen_size.y, PackColour(clear_colour));
+
+    auto blend_row = compositor.kernel == CompositorKernel::SIMD ? &BlendRowSIMD : &BlendRowScalar;
+
+    for (auto& quad : scene.quads)
+    {
+        auto& sheet = compositor.sheets.at(quad.source);
+
+        glm::ivec2 start = glm::max(quad.start, glm::ivec2(0));
+        glm::ivec2 end = glm::min(quad.end, glm::ivec2(screen_size));
+
+        if (start.x >= end.x || start.y >= end.y)
+            continue;
+
+        auto& cells = quad.flipped ? sheet.flipped_cells : sheet.cells;
+        bool opaque = sheet.opaque_cells.at(quad.tile_id);
+        uint32_t count = end.x - start.x;
+
+        for (int32_t y = start.y; y < end.y; ++y)
+        {
+            size_t cell_row = size_t(quad.tile_id) * sheet.cell_size.y + (y - quad.start.y);
+            const uint32_t* src = cells.data() + cell_row * sheet.cell_size.x + (start.x - quad.start.x);
+            uint32_t* dst = compositor.framebuffer.data() + size_t(y) * screen_size.x + start.x;
+
+            if (opaque)
+            {
+                std::memcpy(dst, src, count * sizeof(uint32_t));
+            }
+            else
+            {
+                blend_row(dst, src, count);
+            }
+        }
+    }
+}
+
+void DrawCompositedMap(
+    Renderer& renderer,
+    SDL_Renderer* sdl_renderer,
+    TileCompositor& compositor,
+    Level& level,
+    GameAssets& assets,
+    const UnitMapState& unit_map,
+    const FrameCamera& camera,
+    const glm::uvec2& screen_size,
+    const glm::vec4& clear_colour,
+    DeltaMS delta,
+    const FogVisibility* fog,
+    const UnitTweens* tweens)
+{
+    UpdateLevelAnimations(level, delta);
+    UpdateUnitAnimations(assets, delta);
+
+    CompositeFrame(compositor, level, assets, unit_map, camera, screen_size, clear_colour, fog, tweens);
+
+    // The frame is opaque, the texture is only recreated when the screen size changes
+    if (!compositor.frame_texture || compositor.frame_texture_size != screen_size)
+    {
+        compositor.frame_texture = CreateStreamingTexture(sdl_renderer, screen_size, SDL_PIXELFORMAT_RGBA32);
+        compositor.frame_texture_size = screen_size;
+
+        if (compositor.frame_texture)
+        {
+            SDL_SetTextureBlendMode(compositor.frame_texture.get(), SDL_BLENDMODE_NONE);
+        }
+    }
+
+    if (compositor.frame_texture)
+    {
+        SDL_FRect rect { 0.0f, 0.0f, (float)screen_size.x, (float)screen_size.y };
+        SDL_UpdateTexture(compositor.frame_texture.get(), nullptr, compositor.framebuffer.data(), screen_size.x * sizeof(uint32_t));
+        SDL_RenderTexture(sdl_renderer, compositor.frame_texture.get(), nullptr, &rect);
+    }
+
+    if (tweens)
+    {
+        DrawUnitTweens(renderer, assets, unit_map, *tweens, camera, fog);
+    }
+
+    DrawUnitHealth(renderer, assets, unit_map, camera, fog, tweens);
+}
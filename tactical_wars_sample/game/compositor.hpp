@@ -0,0 +1,69 @@
+#pragma once
+#include <game/fog.hpp>
+#include <game/level.hpp>
+#include <game/render_target.hpp>
+#include <game/tween.hpp>
+#include <game/unit.hpp>
+
+// Optional CPU compositing backend for software rendered deployments.
+// Spritesheets are pre-scaled to the current zoom, one cell per tile, and the level and unit
+// passes are blitted row by row into a CPU framebuffer that is presented as a single texture.
+// Needs the tilesets loaded with keep_cpu_pixels.
+
+enum class CompositorKernel : uint8_t
+{
+    SCALAR,
+    SIMD
+};
+
+struct CompositorSheet
+{
+    uint64_t image_hash {};
+    glm::vec2 screen_tile_size {}; // Size of one tile on screen the cells were scaled for
+    glm::uvec2 cell_size {};
+
+    std::vector<uint32_t> cells {}; // RGBA, tile i is stored in rows [i * cell_size.y, (i + 1) * cell_size.y)
+    std::vector<uint32_t> flipped_cells {}; // Horizontally mirrored cells, only for unit sheets
+    std::vector<uint8_t> opaque_cells {}; // Cells without transparent pixels are copied instead of blended
+};
+
+struct TileCompositor
+{
+    CompositorKernel kernel = CompositorKernel::SIMD;
+    std::vector<CompositorSheet> sheets {}; // Level tilesets first, then one per team
+
+    glm::uvec2 framebuffer_size {};
+    std::vector<uint32_t> framebuffer {}; // RGBA, one uint32_t per pixel
+    StreamingTexture frame_texture {};
+    glm::uvec2 frame_texture_size {};
+};
+
+// Name of the widest blend kernel compiled in
+const char* GetCompositorSimdName();
+
+// Rebuilds the scaled sheets when the zoom or a spritesheet changed, then composites the level and units
+void CompositeFrame(
+    TileCompositor& compositor,
+    const Level& level,
+    const GameAssets& assets,
+    const UnitMapState& unit_map,
+    const FrameCamera& camera,
+    const glm::uvec2& screen_size,
+    const glm::vec4& clear_colour,
+    const FogVisibility* fog = nullptr,
+    const UnitTweens* tweens = nullptr);
+
+// Drop-in for DrawLevel and DrawMapUnits, the frame is uploaded through sdl_renderer
+void DrawCompositedMap(
+    Renderer& renderer,
+    SDL_Renderer* sdl_renderer,
+    TileCompositor& compositor,
+    Level& level,
+    GameAssets& assets,
+    const UnitMapState& unit_map,
+    const FrameCamera& camera,
+    const glm::uvec2& screen_size,
+    const glm::vec4& clear_colour,
+    DeltaMS delta,
+    const FogVisibility* fog = nullptr,
+    const UnitTweens* tweens = nullptr);
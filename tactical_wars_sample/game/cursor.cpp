@@ -1,101 +1,31 @@
+#include <game/combat.hpp>
 #include <game/cursor.hpp>
-
-#include <queue>
-#include <unordered_set>
+#include <game/text.hpp>
+#include <utility/colours.hpp>
 
 SelectedCursorState CalculateSelectedCursorState(const GameState& game_state, const glm::ivec2& tile)
 {
     SelectedCursorState state {};
     state.selected_unit_tile = tile;
+    state.move_tiles = FindMoveTiles(*game_state.current_level, game_state.unit_state, tile);
+    return state;
+}
 
-    // Flood fill to find available paths
-    {
-        auto unit = game_state.unit_state.units.at(tile.x, tile.y);
-        uint32_t unit_move_range = GetUnitStats(unit.type).movement_range;
-
-        std::vector<UnitPath> found_paths {};
-        std::unordered_set<glm::ivec2> visited {};
-
-        struct TraversalStep
-        {
-            UnitPath current_path {};
-            uint32_t remaining_range {};
-        };
-
-        std::queue<TraversalStep> steps;
-
-        TraversalStep first;
-        first.current_path.tiles.emplace_back(tile);
-        first.remaining_range = unit_move_range;
-
-        steps.emplace(first);
-
-        auto is_outside_level = [](const Level& level, const glm::ivec2& tile_pos)
-        {
-            auto level_size = level.map.getMapGridSize();
-            return tile_pos.x < 0 || tile_pos.x >= (int)level_size.x || tile_pos.y < 0 || tile_pos.y >= (int)level_size.y;
-        };
-
-        auto is_enemy_occupied = [](const UnitMapState& all_units, const glm::ivec2& tile_pos, Unit own_unit)
-        {
-            auto unit = all_units.units.at(tile_pos.x, tile_pos.y);
-            if (unit.health > 0)
-            {
-                return own_unit.team != unit.team;
-            }
-            return false;
-        };
-
-        auto is_obstacle = [](const Level& level, const glm::ivec2& tile_pos)
-        {
-            return level.tile_travel_costs.at(tile_pos.x, tile_pos.y) == 1;
-        };
-
-        while (!steps.empty())
-        {
-            auto next = steps.front();
-            steps.pop();
-
-            auto tail = next.current_path.tiles.back();
-
-            if (visited.contains(tail))
-            {
-                continue;
-            }
-
-            visited.emplace(tail);
-            auto success = state.move_tiles.emplace(tail, next.current_path);
-            assert(success.second); // Ensure we don't overwrite existing paths
-
-            glm::ivec2 dirs[4] = {
-                glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1)
-            };
+static void ApplyRecordedAction(CursorUpdateResult& result, GameState& game_state, const UnitAction& action)
+{
+    std::vector<glm::uvec2> tiles = { action.unit_tile, action.move_tile };
 
-            for (auto dir : dirs)
-            {
-                auto next_pos = glm::ivec2(tail) + dir;
-                auto next_cost = next.remaining_range;
-
-                if (next_cost == 0)
-                    continue;
-                if (is_outside_level(game_state.current_level, next_pos))
-                    continue;
-                if (is_obstacle(game_state.current_level, next_pos))
-                    continue;
-                if (is_enemy_occupied(game_state.unit_state, next_pos, unit))
-                    continue;
-
-                TraversalStep new_step {};
-                new_step.current_path = next.current_path;
-                new_step.current_path.tiles.emplace_back(next_pos);
-                new_step.remaining_range = next_cost - 1;
-
-                steps.emplace(new_step);
-            }
-        }
+    if (action.attack_tile)
+    {
+        tiles.emplace_back(action.attack_tile.value());
     }
 
-    return state;
+    auto record = BeginUndoRecord(game_state, tiles);
+    result.changed_tiles = ApplyUnitAction(*game_state.current_level, game_state.unit_state, action);
+    FinishUndoRecord(record, game_state);
+
+    result.undo_record = std::move(record);
+    result.action = action;
 }
 
 CursorUpdateResult UpdateState(std::monostate&, GameState&, const glm::ivec2&, bool, DeltaMS)
@@ -107,7 +37,7 @@ CursorUpdateResult UpdateState(std::monostate&, GameState&, const glm::ivec2&, b
 CursorUpdateResult UpdateState(DefaultCursorState& state, GameState& game_state, const glm::ivec2& mouse_tile, bool mouse_click, DeltaMS dt)
 {
     CursorUpdateResult result {};
-    auto level_size = game_state.current_level.map.getMapGridSize();
+    auto level_size = game_state.current_level->map.getMapGridSize();
 
     if (mouse_tile.x < 0 || mouse_tile.x >= (int)level_size.x || mouse_tile.y < 0 || mouse_tile.y >= (int)level_size.y)
     {
@@ -117,12 +47,13 @@ CursorUpdateResult UpdateState(DefaultCursorState& state, GameState& game_state,
     if (mouse_click)
     {
         auto& unit = game_state.unit_state.units.at(mouse_tile.x, mouse_tile.y);
-        auto current_team = game_state.teams.at(game_state.turn_index % game_state.teams.size());
+        auto current_team = GetCurrentTeam(game_state);
 
         if (unit.health > 0 && unit.team == current_team && unit.state == UnitState::IDLE)
         {
             unit.state = UnitState::MOVING;
             result.new_state = CalculateSelectedCursorState(game_state, mouse_tile);
+            result.changed_tiles.emplace_back(mouse_tile);
         }
     }
 
@@ -162,6 +93,7 @@ CursorUpdateResult UpdateState(SelectedCursorState& state, GameState& game_state
                 }
 
                 result.new_state = ConfirmationCursorState { 0.0f, state.selected_unit_tile, it->second };
+                result.changed_tiles.emplace_back(state.selected_unit_tile);
             }
         }
         else
@@ -169,6 +101,7 @@ CursorUpdateResult UpdateState(SelectedCursorState& state, GameState& game_state
             // Otherwise, reset to default state
             unit.state = UnitState::IDLE;
             result.new_state = DefaultCursorState {};
+            result.changed_tiles.emplace_back(state.selected_unit_tile);
         }
     }
 
@@ -231,61 +164,77 @@ CursorUpdateResult UpdateState(ConfirmationCursorState& state, GameState& game_s
 
     // Draw attack tiles
 
+    CombatForecastBatch forecasts {};
+    std::vector<glm::ivec2> attack_tiles {};
+
     for (auto dir : DIRECTIONS)
     {
         auto adjacent_tile = tail_end + dir;
-        auto map_grid_size = tpp::IVec2(game_state.current_level.map.getMapGridSize());
+        auto map_grid_size = tpp::IVec2(game_state.current_level->map.getMapGridSize());
 
         bool inside_level = adjacent_tile.x >= 0 && adjacent_tile.x < map_grid_size.x && adjacent_tile.y >= 0 && adjacent_tile.y < map_grid_size.y;
 
         if (inside_level)
         {
             auto unit_at_adjacent = game_state.unit_state.units.at(adjacent_tile.x, adjacent_tile.y);
-            if (unit_at_adjacent.health > 0 && unit_at_adjacent.team != unit.team)
+            bool hidden = IsUnitHidden(game_state.fog.get(), glm::uvec2(adjacent_tile), unit_at_adjacent);
+
+            if (unit_at_adjacent.health > 0 && unit_at_adjacent.team != unit.team && !hidden)
             {
                 // Draw attack tile
                 DrawTileRectCommand draw_attack { adjacent_tile, glm::vec2(tile_size), glm::vec4 { 1.0f, 0.5f, 0.5f, 0.4f } };
                 result.draw_commands.emplace_back(draw_attack);
+
+                auto& terrain = game_state.current_level->terrain;
+                AddCombatForecast(forecasts, unit, unit_at_adjacent, terrain.at(tail_end.x, tail_end.y).defence, terrain.at(adjacent_tile.x, adjacent_tile.y).defence);
+                attack_tiles.emplace_back(adjacent_tile);
             }
         }
     }
 
-    if (mouse_click)
-    {
-        auto& target_spot = game_state.unit_state.units.at(tail_end.x, tail_end.y);
+    // Damage preview for the hovered attack tile
 
-        auto hasEnemyToAttack = [DIRECTIONS](
-                                    UnitTeam own_team,
-                                    UnitMapState& map,
-                                    const glm::ivec2& mouse_tile,
-                                    const glm::ivec2& tail_end) -> Unit*
+    ForecastCombat(forecasts);
+
+    for (size_t i = 0; i < attack_tiles.size(); ++i)
+    {
+        if (attack_tiles.at(i) != mouse_tile)
         {
-            auto it = std::find(std::begin(DIRECTIONS), std::end(DIRECTIONS), mouse_tile - tail_end);
-            if (it != std::end(DIRECTIONS))
-            {
-                auto& unit_at_adjacent = map.units.at(mouse_tile.x, mouse_tile.y);
-                if (unit_at_adjacent.health > 0 && unit_at_adjacent.team != own_team)
-                {
-                    return &unit_at_adjacent;
-                }
-            }
-            return nullptr;
-        };
+            continue;
+        }
+
+        result.draw_commands.emplace_back(DamagePreviewCommand {
+            attack_tiles.at(i), glm::vec2(tile_size), forecasts.defender_damage.at(i), forecasts.defender_killed.at(i) != 0 });
+
+        result.draw_commands.emplace_back(DamagePreviewCommand {
+            tail_end, glm::vec2(tile_size), forecasts.attacker_damage.at(i), forecasts.attacker_killed.at(i) != 0 });
+    }
+
+    if (mouse_click)
+    {
+        // Attack tiles only hold enemies the player can see
+        bool has_enemy_to_attack = std::find(attack_tiles.begin(), attack_tiles.end(), mouse_tile) != attack_tiles.end();
 
         if (mouse_tile == tail_end)
         {
-            unit.state = UnitState::USED;
             result.new_state = DefaultCursorState {};
-            std::swap(unit, target_spot);
+            ApplyRecordedAction(result, game_state, UnitAction { state.selected_unit_tile, tail_end });
         }
-        else if (auto* enemy = hasEnemyToAttack(unit.team, game_state.unit_state, mouse_tile, tail_end))
+        else if (has_enemy_to_attack)
         {
-            // Attack unit
-            unit.state = UnitState::USED;
+            // Attack unit, both sides are kept from before and after the fight for the hit effects
+            auto& units = game_state.unit_state.units;
+
+            UnitAttack attack { tail_end, mouse_tile };
+            attack.attacker_before = unit;
+            attack.defender_before = units.at(mouse_tile.x, mouse_tile.y);
+
             result.new_state = DefaultCursorState {};
-            std::swap(unit, target_spot);
+            ApplyRecordedAction(result, game_state, UnitAction { state.selected_unit_tile, tail_end, mouse_tile });
 
-            AttackUnit(target_spot, *enemy);
+            attack.attacker_after = units.at(tail_end.x, tail_end.y);
+            attack.defender_after = units.at(mouse_tile.x, mouse_tile.y);
+            result.attack = attack;
         }
         else
         {
@@ -311,6 +260,37 @@ CursorUpdateResult UpdateCursorInput(Cursor& cursor, GameState& game_state, cons
     return result;
 }
 
+std::optional<glm::uvec2> CancelCursorSelection(Cursor& cursor, GameState& game_state)
+{
+    std::optional<glm::uvec2> selected_tile {};
+
+    if (auto* selected = std::get_if<SelectedCursorState>(&cursor.state))
+    {
+        selected_tile = selected->selected_unit_tile;
+    }
+    else if (auto* confirmation = std::get_if<ConfirmationCursorState>(&cursor.state))
+    {
+        selected_tile = confirmation->selected_unit_tile;
+    }
+
+    if (selected_tile)
+    {
+        auto& unit = game_state.unit_state.units.at(selected_tile->x, selected_tile->y);
+
+        if (unit.state == UnitState::MOVING)
+        {
+            unit.state = UnitState::IDLE;
+        }
+        else
+        {
+            selected_tile.reset();
+        }
+    }
+
+    cursor.state = DefaultCursorState {};
+    return selected_tile;
+}
+
 struct DrawCommandVisitor
 {
     Renderer& renderer;
@@ -331,6 +311,19 @@ struct DrawCommandVisitor
     {
         DrawUnit(renderer, camera, assets, command.map_position, command.tile_size, command.unit, command.colour);
     }
+
+    void operator()(const DamagePreviewCommand& command) const
+    {
+        auto text = unicode::FromUTF8(command.killed ? "KO" : std::format("-{}", command.damage));
+        auto scale = camera.ToScreenRect(SDL_FRect { 0.0f, 0.0f, 1.0f, 1.0f }).w / assets.text_font->GetFontMetrics().resolution * 9.0f;
+
+        glm::vec2 position = {
+            command.tile_pos.x * command.tile_size.x + command.tile_size.x * 0.1f,
+            command.tile_pos.y * command.tile_size.y
+        };
+
+        DrawText(renderer, *assets.text_font, text, camera.ToScreenPoint(position), command.killed ? glm::vec4(1.0f, 0.3f, 0.3f, 1.0f) : colour::WHITE, scale);
+    }
 };
 
 void DrawCursorInput(Renderer& renderer, const GameAssets& assets, const CursorUpdateResult& result, const FrameCamera& camera)
@@ -1,26 +1,13 @@
 #pragma once
 
-#include <game/level.hpp>
-#include <game/unit.hpp>
+#include <game/game_state.hpp>
+#include <game/pathfinding.hpp>
+#include <game/undo.hpp>
 #include <math/types.hpp>
 #include <unordered_map>
 #include <variant>
 #include <vector>
 
-struct GameState
-{
-    Level current_level;
-    UnitMapState unit_state {};
-
-    std::vector<UnitTeam> teams {};
-    uint32_t turn_index = -1;
-};
-
-struct UnitPath
-{
-    std::vector<glm::uvec2> tiles;
-};
-
 struct DefaultCursorState
 {
 };
@@ -55,12 +42,24 @@ struct DrawTileRectCommand
     glm::vec4 colour;
 };
 
-using CursorDrawTileCommand = std::variant<DrawTileRectCommand, UnitDrawCommand>;
+struct DamagePreviewCommand
+{
+    glm::uvec2 tile_pos;
+    glm::vec2 tile_size;
+    int8_t damage;
+    bool killed;
+};
+
+using CursorDrawTileCommand = std::variant<DrawTileRectCommand, UnitDrawCommand, DamagePreviewCommand>;
 
 struct CursorUpdateResult
 {
     CursorStateVariant new_state;
     std::vector<CursorDrawTileCommand> draw_commands {};
+    std::vector<glm::uvec2> changed_tiles {}; // Tiles whose unit was moved, damaged, removed, selected or turned
+    std::optional<UndoRecord> undo_record {}; // Set when a move or attack was confirmed
+    std::optional<UnitAction> action {}; // The confirmed move or attack
+    std::optional<UnitAttack> attack {}; // Set when the action was an attack
 };
 
 struct Cursor
@@ -68,5 +67,9 @@ struct Cursor
     CursorStateVariant state = DefaultCursorState {};
 };
 
+SelectedCursorState CalculateSelectedCursorState(const GameState& game_state, const glm::ivec2& tile);
+// Drops any selection in progress, the selected unit becomes idle again.
+// Returns its tile when it was changed.
+std::optional<glm::uvec2> CancelCursorSelection(Cursor& cursor, GameState& game_state);
 CursorUpdateResult UpdateCursorInput(Cursor& cursor, GameState& game_state, const glm::vec2& mouse_pos, bool mouse_click, DeltaMS dt);
 void DrawCursorInput(Renderer& renderer, const GameAssets& assets, const CursorUpdateResult& result, const FrameCamera& camera);
\ No newline at end of file
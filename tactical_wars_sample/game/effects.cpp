@@ -0,0 +1,220 @@
+#include <game/effects.hpp>
+#include <game/fog.hpp>
+#include <game/text.hpp>
+#include <utility/colours.hpp>
+
+constexpr uint8_t KO_LABEL = 128;
+
+static float GetEffectLifetime(CombatEffectKind kind)
+{
+    switch (kind)
+    {
+    case CombatEffectKind::HIT_FLASH:
+        return 200.0f;
+    case CombatEffectKind::DAMAGE_NUMBER:
+        return 900.0f;
+    case CombatEffectKind::DEATH_FADE:
+        return 600.0f;
+    }
+
+    return 0.0f;
+}
+
+CombatEffects CreateCombatEffects(uint32_t capacity)
+{
+    CombatEffects effects {};
+    effects.kinds.resize(capacity);
+    effects.alive.resize(capacity);
+    effects.ages.resize(capacity);
+    effects.lifetimes.resize(capacity);
+    effects.tiles.resize(capacity);
+    effects.labels.resize(capacity);
+    effects.units.resize(capacity);
+    effects.next_free.resize(capacity);
+
+    auto damage_labels = std::make_shared<std::vector<unicode::String>>();
+
+    for (uint32_t damage = 0; damage < KO_LABEL; ++damage)
+    {
+        damage_labels->emplace_back(unicode::FromUTF8(std::format("-{}", damage)));
+    }
+
+    damage_labels->emplace_back(unicode::FromUTF8("KO"));
+    effects.damage_labels = std::move(damage_labels);
+
+    ClearCombatEffects(effects);
+    return effects;
+}
+
+void ClearCombatEffects(CombatEffects& effects)
+{
+    uint32_t capacity = effects.alive.size();
+
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+        effects.alive[i] = 0;
+        effects.next_free[i] = i + 1 < capacity ? i + 1 : CombatEffects::NO_SLOT;
+    }
+
+    effects.free_head = capacity > 0 ? 0 : CombatEffects::NO_SLOT;
+    effects.slot_end = 0;
+    effects.live_count = 0;
+}
+
+void CopyLiveCombatEffects(const CombatEffects& effects, CombatEffects& copy)
+{
+    uint32_t slot_end = effects.slot_end;
+
+    // Assigning keeps the buffers of the copy, they stop growing once they held the busiest frame
+    copy.kinds.assign(effects.kinds.begin(), effects.kinds.begin() + slot_end);
+    copy.alive.assign(effects.alive.begin(), effects.alive.begin() + slot_end);
+    copy.ages.assign(effects.ages.begin(), effects.ages.begin() + slot_end);
+    copy.lifetimes.assign(effects.lifetimes.begin(), effects.lifetimes.begin() + slot_end);
+    copy.tiles.assign(effects.tiles.begin(), effects.tiles.begin() + slot_end);
+    copy.labels.assign(effects.labels.begin(), effects.labels.begin() + slot_end);
+    copy.units.assign(effects.units.begin(), effects.units.begin() + slot_end);
+
+    copy.next_free.clear();
+    copy.free_head = CombatEffects::NO_SLOT;
+    copy.slot_end = slot_end;
+    copy.live_count = effects.live_count;
+    copy.damage_labels = effects.damage_labels;
+}
+
+bool SpawnCombatEffect(CombatEffects& effects, CombatEffectKind kind, const glm::uvec2& tile, uint8_t label, Unit unit)
+{
+    uint32_t slot = effects.free_head;
+
+    if (slot == CombatEffects::NO_SLOT)
+    {
+        return false;
+    }
+
+    effects.free_head = effects.next_free[slot];
+    effects.slot_end = std::max(effects.slot_end, slot + 1);
+    ++effects.live_count;
+
+    effects.kinds[slot] = kind;
+    effects.alive[slot] = 1;
+    effects.ages[slot] = 0.0f;
+    effects.lifetimes[slot] = GetEffectLifetime(kind);
+    effects.tiles[slot] = tile;
+    effects.labels[slot] = label;
+    effects.units[slot] = unit;
+    return true;
+}
+
+static void SpawnHitEffects(CombatEffects& effects, const glm::uvec2& tile, Unit before, Unit after)
+{
+    bool killed = after.health <= 0;
+    int32_t damage = before.health - std::max<int32_t>(after.health, 0);
+
+    if (!killed && damage <= 0)
+    {
+        return;
+    }
+
+    SpawnCombatEffect(effects, CombatEffectKind::HIT_FLASH, tile);
+    SpawnCombatEffect(effects, CombatEffectKind::DAMAGE_NUMBER, tile, killed ? KO_LABEL : (uint8_t)std::min<int32_t>(damage, KO_LABEL - 1));
+
+    if (killed)
+    {
+        SpawnCombatEffect(effects, CombatEffectKind::DEATH_FADE, tile, 0, before);
+    }
+}
+
+void SpawnAttackEffects(CombatEffects& effects, const UnitAttack& attack)
+{
+    SpawnHitEffects(effects, attack.defender_tile, attack.defender_before, attack.defender_after);
+    SpawnHitEffects(effects, attack.attacker_tile, attack.attacker_before, attack.attacker_after);
+}
+
+void UpdateCombatEffects(CombatEffects& effects, DeltaMS delta)
+{
+    uint32_t slot_end = effects.slot_end;
+    float dt = delta.count();
+    float* ages = effects.ages.data();
+
+    // Free slots age too, it keeps the loop branch free
+    for (uint32_t i = 0; i < slot_end; ++i)
+    {
+        ages[i] += dt;
+    }
+
+    for (uint32_t i = 0; i < slot_end; ++i)
+    {
+        if (effects.alive[i] && ages[i] >= effects.lifetimes[i])
+        {
+            effects.alive[i] = 0;
+            effects.next_free[i] = effects.free_head;
+            effects.free_head = i;
+            --effects.live_count;
+        }
+    }
+
+    // Reset the free list once quiet, so the next burst uses the lowest slots again
+    if (effects.live_count == 0 && slot_end > 0)
+    {
+        ClearCombatEffects(effects);
+    }
+}
+
+void DrawCombatEffects(Renderer& renderer, const GameAssets& assets, const CombatEffects& effects, const glm::vec2& tile_size, const FrameCamera& camera, const FogVisibility* fog)
+{
+    if (effects.live_count == 0)
+    {
+        return;
+    }
+
+    auto visible = [&](uint32_t slot, CombatEffectKind kind)
+    {
+        if (!effects.alive[slot] || effects.kinds[slot] != kind)
+            return false;
+
+        return !fog || IsTileVisible(*fog, effects.tiles[slot]);
+    };
+
+    auto get_fade = [&](uint32_t slot)
+    {
+        return 1.0f - std::min(effects.ages[slot] / effects.lifetimes[slot], 1.0f);
+    };
+
+    for (uint32_t i = 0; i < effects.slot_end; ++i)
+    {
+        if (!visible(i, CombatEffectKind::DEATH_FADE))
+            continue;
+
+        DrawUnit(renderer, camera, assets, effects.tiles[i], tile_size, effects.units[i], glm::vec4(1.0f, 1.0f, 1.0f, get_fade(i)));
+    }
+
+    for (uint32_t i = 0; i < effects.slot_end; ++i)
+    {
+        if (!visible(i, CombatEffectKind::HIT_FLASH))
+            continue;
+
+        auto tile = glm::vec2(effects.tiles[i]);
+        SDL_FRect rect = camera.ToScreenRect(SDL_FRect { tile.x * tile_size.x, tile.y * tile_size.y, tile_size.x, tile_size.y });
+        renderer.RenderFilledRect(rect, glm::vec4(1.0f, 1.0f, 1.0f, 0.6f * get_fade(i)));
+    }
+
+    // Same size as the damage preview, rises half a tile while fading
+    auto scale = camera.ToScreenRect(SDL_FRect { 0.0f, 0.0f, 1.0f, 1.0f }).w / assets.text_font->GetFontMetrics().resolution * 9.0f;
+
+    for (uint32_t i = 0; i < effects.slot_end; ++i)
+    {
+        if (!visible(i, CombatEffectKind::DAMAGE_NUMBER))
+            continue;
+
+        float fade = get_fade(i);
+        auto tile = glm::vec2(effects.tiles[i]);
+        bool killed = effects.labels[i] == KO_LABEL;
+
+        glm::vec2 position = {
+            tile.x * tile_size.x + tile_size.x * 0.1f,
+            tile.y * tile_size.y - tile_size.y * 0.5f * (1.0f - fade)
+        };
+
+        auto colour = killed ? glm::vec4(1.0f, 0.3f, 0.3f, fade) : glm::vec4(1.0f, 1.0f, 1.0f, fade);
+        DrawText(renderer, *assets.text_font, effects.damage_labels->at(effects.labels[i]), camera.ToScreenPoint(position), colour, scale);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <game/unit.hpp>
+
+// Short lived combat feedback: hit flashes, floating damage numbers and fading dead units.
+// Effects live in a fixed number of slots, kept as parallel arrays and handed out through a
+// free list, so spawning never allocates. When every slot is taken new effects are dropped.
+enum class CombatEffectKind : uint8_t
+{
+    HIT_FLASH,
+    DAMAGE_NUMBER,
+    DEATH_FADE
+};
+
+struct CombatEffects
+{
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    std::vector<CombatEffectKind> kinds {};
+    std::vector<uint8_t> alive {};
+    std::vector<float> ages {};
+    std::vector<float> lifetimes {};
+    std::vector<glm::uvec2> tiles {};
+    std::vector<uint8_t> labels {}; // DAMAGE_NUMBER: index into damage_labels
+    std::vector<Unit> units {}; // DEATH_FADE: the unit as it was before the attack
+
+    std::vector<uint32_t> next_free {};
+    uint32_t free_head = NO_SLOT;
+    uint32_t slot_end {}; // No slot past this one was handed out since the pool was last empty
+    uint32_t live_count {};
+
+    std::shared_ptr<const std::vector<unicode::String>> damage_labels {}; // "-0" to "-127" and "KO", built once and shared by copies
+};
+
+CombatEffects CreateCombatEffects(uint32_t capacity = 4096);
+void ClearCombatEffects(CombatEffects& effects);
+// Only the slots below slot_end, for drawing a frame from. The copy has no free slots to spawn into.
+void CopyLiveCombatEffects(const CombatEffects& effects, CombatEffects& copy);
+
+// Returns false when the pool is full
+bool SpawnCombatEffect(CombatEffects& effects, CombatEffectKind kind, const glm::uvec2& tile, uint8_t label = 0, Unit unit = {});
+
+void SpawnAttackEffects(CombatEffects& effects, const UnitAttack& attack);
+
+void UpdateCombatEffects(CombatEffects& effects, DeltaMS delta);
+
+// One pass per effect kind, effects on tiles the fog hides are skipped
+void DrawCombatEffects(Renderer& renderer, const GameAssets& assets, const CombatEffects& effects, const glm::vec2& tile_size, const FrameCamera& camera, const FogVisibility* fog = nullptr);
@@ -0,0 +1,449 @@
+#include <game/flow_field.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <thread>
+
+static constexpr glm::ivec2 DIRECTIONS[4] = {
+    glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1)
+};
+
+using FlowOpenEntry = std::pair<uint32_t, uint32_t>;
+using FlowOpenQueue = std::priority_queue<FlowOpenEntry, std::vector<FlowOpenEntry>, std::greater<FlowOpenEntry>>;
+
+static uint32_t GetFlowIndex(const FlowField& field, const glm::uvec2& tile)
+{
+    return tile.y * field.grid_size.x + tile.x;
+}
+
+static glm::uvec2 GetFlowTile(const FlowField& field, uint32_t index)
+{
+    return { index % field.grid_size.x, index / field.grid_size.x };
+}
+
+static bool IsInsideGrid(const FlowField& field, const glm::ivec2& tile)
+{
+    return tile.x >= 0 && tile.y >= 0 && tile.x < (int)field.grid_size.x && tile.y < (int)field.grid_size.y;
+}
+
+static uint32_t EnterCost(const FlowFieldCache& cache, const FlowField& field, const glm::uvec2& tile)
+{
+    uint32_t cost = cache.terrain_costs.at(tile.x, tile.y);
+
+    if (tile == field.target)
+    {
+        return std::max(cost, 1u);
+    }
+
+    if (cost == 0 || cache.blockers.at(tile.x, tile.y) != 0)
+    {
+        return UNREACHABLE_PATH_COST;
+    }
+
+    return cost;
+}
+
+// Costs only flow from tiles that can be entered, blocked tiles still get a cost to leave them
+static void RunFlowSearch(const FlowFieldCache& cache, FlowField& field, FlowOpenQueue& open, std::vector<uint32_t>* lowered)
+{
+    while (!open.empty())
+    {
+        auto [cost, index] = open.top();
+        open.pop();
+
+        if (cost > field.costs.at(index))
+        {
+            continue;
+        }
+
+        auto tile = GetFlowTile(field, index);
+        auto enter_cost = EnterCost(cache, field, tile);
+
+        if (enter_cost == UNREACHABLE_PATH_COST)
+        {
+            continue;
+        }
+
+        for (auto dir : DIRECTIONS)
+        {
+            auto next = glm::ivec2(tile) + dir;
+
+            if (!IsInsideGrid(field, next))
+                continue;
+            if (cache.terrain_costs.at(next.x, next.y) == 0)
+                continue;
+
+            auto next_index = GetFlowIndex(field, glm::uvec2(next));
+            auto next_cost = cost + enter_cost;
+
+            if (next_cost < field.costs.at(next_index))
+            {
+                field.costs.at(next_index) = next_cost;
+                open.emplace(next_cost, next_index);
+
+                if (lowered)
+                {
+                    lowered->emplace_back(next_index);
+                }
+            }
+        }
+    }
+}
+
+// Cheapest neighbour, ties go to the first direction so a repaired field matches a rebuilt one
+static void UpdateFlowDirection(const FlowFieldCache& cache, FlowField& field, uint32_t index)
+{
+    auto tile = GetFlowTile(field, index);
+    auto& direction = field.directions.at(index);
+    direction = NO_FLOW_DIRECTION;
+
+    if (tile == field.target || field.costs.at(index) == UNREACHABLE_PATH_COST)
+    {
+        return;
+    }
+
+    uint32_t best_cost = UNREACHABLE_PATH_COST;
+
+    for (uint8_t i = 0; i < 4; ++i)
+    {
+        auto next = glm::ivec2(tile) + DIRECTIONS[i];
+
+        if (!IsInsideGrid(field, next))
+            continue;
+
+        auto next_cost = field.costs.at(GetFlowIndex(field, glm::uvec2(next)));
+        auto enter_cost = EnterCost(cache, field, glm::uvec2(next));
+
+        if (next_cost == UNREACHABLE_PATH_COST || enter_cost == UNREACHABLE_PATH_COST)
+            continue;
+
+        if (next_cost + enter_cost < best_cost)
+        {
+            best_cost = next_cost + enter_cost;
+            direction = i;
+        }
+    }
+}
+
+static void BuildFlowField(const FlowFieldCache& cache, FlowField& field)
+{
+    uint32_t tile_count = field.grid_size.x * field.grid_size.y;
+    field.costs.assign(tile_count, UNREACHABLE_PATH_COST);
+    field.directions.assign(tile_count, NO_FLOW_DIRECTION);
+    field.marks.assign(tile_count, 0);
+
+    auto target_index = GetFlowIndex(field, field.target);
+    field.costs.at(target_index) = 0;
+
+    FlowOpenQueue open {};
+    open.emplace(0, target_index);
+    RunFlowSearch(cache, field, open, nullptr);
+
+    for (uint32_t i = 0; i < tile_count; ++i)
+    {
+        UpdateFlowDirection(cache, field, i);
+    }
+
+    field.built = true;
+}
+
+static void RepairFlowField(const FlowFieldCache& cache, FlowField& field)
+{
+    std::vector<uint32_t> affected {};
+
+    auto mark = [&](uint32_t index)
+    {
+        if (field.marks.at(index) == 0)
+        {
+            field.marks.at(index) = 1;
+            affected.emplace_back(index);
+        }
+    };
+
+    for (auto tile : field.pending_changes)
+    {
+        mark(GetFlowIndex(field, tile));
+    }
+
+    // Every tile whose route ran through a changed tile, found by walking the directions backwards
+    for (size_t i = 0; i < affected.size(); ++i)
+    {
+        auto tile = GetFlowTile(field, affected.at(i));
+
+        for (uint8_t dir = 0; dir < 4; ++dir)
+        {
+            auto previous = glm::ivec2(tile) - DIRECTIONS[dir];
+
+            if (IsInsideGrid(field, previous) && field.directions.at(GetFlowIndex(field, glm::uvec2(previous))) == dir)
+            {
+                mark(GetFlowIndex(field, glm::uvec2(previous)));
+            }
+        }
+    }
+
+    auto target_index = GetFlowIndex(field, field.target);
+    FlowOpenQueue open {};
+
+    for (auto index : affected)
+    {
+        if (index != target_index)
+        {
+            field.costs.at(index) = UNREACHABLE_PATH_COST;
+        }
+    }
+
+    // The search restarts from the untouched tiles around the affected ones
+    for (auto index : affected)
+    {
+        if (index == target_index)
+        {
+            open.emplace(0, index);
+            continue;
+        }
+
+        auto tile = GetFlowTile(field, index);
+
+        for (auto dir : DIRECTIONS)
+        {
+            auto next = glm::ivec2(tile) + dir;
+
+            if (!IsInsideGrid(field, next))
+                continue;
+
+            auto next_index = GetFlowIndex(field, glm::uvec2(next));
+
+            if (field.marks.at(next_index) == 0 && field.costs.at(next_index) != UNREACHABLE_PATH_COST)
+            {
+                open.emplace(field.costs.at(next_index), next_index);
+            }
+        }
+    }
+
+    std::vector<uint32_t> lowered {};
+    RunFlowSearch(cache, field, open, &lowered);
+
+    // A direction depends on the costs of the neighbours, so their directions change too
+    auto redirect = [&](uint32_t index)
+    {
+        UpdateFlowDirection(cache, field, index);
+        auto tile = GetFlowTile(field, index);
+
+        for (auto dir : DIRECTIONS)
+        {
+            if (auto next = glm::ivec2(tile) + dir; IsInsideGrid(field, next))
+            {
+                UpdateFlowDirection(cache, field, GetFlowIndex(field, glm::uvec2(next)));
+            }
+        }
+    };
+
+    for (auto index : affected)
+    {
+        redirect(index);
+    }
+
+    for (auto index : lowered)
+    {
+        redirect(index);
+    }
+
+    for (auto index : affected)
+    {
+        field.marks.at(index) = 0;
+    }
+}
+
+static bool NeedsUpdate(const FlowField& field)
+{
+    return !field.built || !field.pending_changes.empty();
+}
+
+static void UpdateFlowField(const FlowFieldCache& cache, FlowField& field)
+{
+    // Past this many changes most of the field is searched again anyway
+    size_t rebuild_threshold = field.grid_size.x * field.grid_size.y / 8;
+
+    if (!field.built || field.pending_changes.size() > rebuild_threshold)
+    {
+        BuildFlowField(cache, field);
+    }
+    else if (!field.pending_changes.empty())
+    {
+        RepairFlowField(cache, field);
+    }
+
+    field.pending_changes.clear();
+}
+
+static void QueueFlowChange(FlowFieldCache& cache, const glm::uvec2& tile)
+{
+    for (auto& [target, field] : cache.fields)
+    {
+        if (field.built)
+        {
+            field.pending_changes.emplace_back(tile);
+        }
+    }
+}
+
+static FlowField& UseFlowField(FlowFieldCache& cache, const glm::uvec2& target)
+{
+    auto [it, inserted] = cache.fields.try_emplace(target);
+    auto& field = it->second;
+
+    if (inserted)
+    {
+        field.target = target;
+        field.grid_size = cache.grid_size;
+    }
+
+    field.last_used = ++cache.use_counter;
+    return field;
+}
+
+// Only drops fields used before oldest_kept
+static void EvictFlowFields(FlowFieldCache& cache, uint64_t oldest_kept)
+{
+    while (cache.fields.size() > cache.max_fields)
+    {
+        auto oldest = std::min_element(cache.fields.begin(), cache.fields.end(), [](const auto& lhs, const auto& rhs)
+            { return lhs.second.last_used < rhs.second.last_used; });
+
+        if (oldest->second.last_used >= oldest_kept)
+        {
+            break;
+        }
+
+        cache.fields.erase(oldest);
+    }
+}
+
+FlowFieldCache CreateFlowFieldCache(const Level& level, uint32_t max_fields)
+{
+    FlowFieldCache cache {};
+    cache.grid_size = { level.map.getMapGridSize().x, level.map.getMapGridSize().y };
+    cache.terrain_costs = tpp::Array2D<uint8_t>(cache.grid_size.x, cache.grid_size.y, 1);
+    cache.blockers = tpp::Array2D<uint8_t>(cache.grid_size.x, cache.grid_size.y, 0);
+    cache.max_fields = std::max(max_fields, 1u);
+
+    for (auto it = level.terrain.begin(); it != level.terrain.end(); ++it)
+    {
+        cache.terrain_costs.at(it.getIndices()) = (*it).move_cost;
+    }
+
+    return cache;
+}
+
+void SetFlowTileCost(FlowFieldCache& cache, const glm::uvec2& tile, uint8_t cost)
+{
+    auto& current = cache.terrain_costs.at(tile.x, tile.y);
+
+    if (current != cost)
+    {
+        current = cost;
+        QueueFlowChange(cache, tile);
+    }
+}
+
+void SetFlowTileBlocked(FlowFieldCache& cache, const glm::uvec2& tile, bool blocked)
+{
+    auto& current = cache.blockers.at(tile.x, tile.y);
+
+    if ((current != 0) != blocked)
+    {
+        current = blocked ? 1 : 0;
+        QueueFlowChange(cache, tile);
+    }
+}
+
+void SyncFlowFieldBlockers(FlowFieldCache& cache, const UnitMapState& unit_map)
+{
+    for (auto it = unit_map.units.begin(); it != unit_map.units.end(); ++it)
+    {
+        SetFlowTileBlocked(cache, { it.getIndices().x, it.getIndices().y }, (*it).health > 0);
+    }
+}
+
+void UpdateFlowFieldBlockers(FlowFieldCache& cache, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_tiles)
+{
+    for (auto tile : changed_tiles)
+    {
+        SetFlowTileBlocked(cache, tile, unit_map.units.at(tile.x, tile.y).health > 0);
+    }
+}
+
+void PrepareFlowFields(FlowFieldCache& cache, const std::vector<glm::uvec2>& targets)
+{
+    uint64_t first_use = cache.use_counter + 1;
+    std::vector<FlowField*> pending {};
+
+    for (auto target : targets)
+    {
+        auto& field = UseFlowField(cache, target);
+
+        if (NeedsUpdate(field) && std::find(pending.begin(), pending.end(), &field) == pending.end())
+        {
+            pending.emplace_back(&field);
+        }
+    }
+
+    EvictFlowFields(cache, first_use);
+
+    // Fields are independent and only read the shared costs, one worker per field at a time
+    uint32_t thread_count = std::min<uint32_t>(cache.thread_count, pending.size());
+
+    if (thread_count <= 1)
+    {
+        for (auto* field : pending)
+        {
+            UpdateFlowField(cache, *field);
+        }
+
+        return;
+    }
+
+    std::atomic<size_t> next_field = 0;
+
+    auto worker = [&]()
+    {
+        for (size_t i = next_field++; i < pending.size(); i = next_field++)
+        {
+            UpdateFlowField(cache, *pending.at(i));
+        }
+    };
+
+    std::vector<std::thread> threads {};
+
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+const FlowField& GetFlowField(FlowFieldCache& cache, const glm::uvec2& target)
+{
+    uint64_t first_use = cache.use_counter + 1;
+    auto& field = UseFlowField(cache, target);
+
+    EvictFlowFields(cache, first_use);
+    UpdateFlowField(cache, field);
+    return field;
+}
+
+std::optional<glm::uvec2> GetFlowStep(const FlowField& field, const glm::uvec2& tile)
+{
+    auto direction = field.directions.at(GetFlowIndex(field, tile));
+
+    if (direction == NO_FLOW_DIRECTION)
+    {
+        return std::nullopt;
+    }
+
+    return glm::uvec2(glm::ivec2(tile) + DIRECTIONS[direction]);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <game/pathfinding.hpp>
+
+// Flow fields for groups of units heading to the same tile.
+// One Dijkstra pass from the target fills an integration field (cost to reach the target from
+// every tile) and a direction field, after which any number of units read their next step in O(1).
+// Fields are cached by target. Terrain and blocker changes are queued on every cached field and
+// repaired in place: only the tiles whose route crossed a changed tile are searched again.
+
+constexpr uint8_t NO_FLOW_DIRECTION = 0xFF;
+
+struct FlowField
+{
+    glm::uvec2 target {};
+    glm::uvec2 grid_size {};
+    std::vector<uint32_t> costs {}; // Per tile, UNREACHABLE_PATH_COST when the target can't be reached
+    std::vector<uint8_t> directions {}; // Per tile, neighbour to step to or NO_FLOW_DIRECTION
+    std::vector<glm::uvec2> pending_changes {}; // Tiles changed since the field was last updated
+    std::vector<uint8_t> marks {}; // Repair scratch, all zero between repairs
+    uint64_t last_used {};
+    bool built = false;
+};
+
+struct FlowFieldCache
+{
+    glm::uvec2 grid_size {};
+    tpp::Array2D<uint8_t> terrain_costs {}; // Cost to enter a tile, 0 means impassable
+    tpp::Array2D<uint8_t> blockers {}; // Units, their tiles can be left but not entered
+
+    std::unordered_map<glm::uvec2, FlowField> fields {};
+    uint32_t max_fields = 64; // Least recently used fields are dropped past this
+    uint32_t thread_count = 1; // Workers used by PrepareFlowFields
+    uint64_t use_counter {};
+};
+
+FlowFieldCache CreateFlowFieldCache(const Level& level, uint32_t max_fields = 64);
+
+void SetFlowTileCost(FlowFieldCache& cache, const glm::uvec2& tile, uint8_t cost);
+void SetFlowTileBlocked(FlowFieldCache& cache, const glm::uvec2& tile, bool blocked);
+// Blocks the tiles of living units, only the tiles that changed are queued
+void SyncFlowFieldBlockers(FlowFieldCache& cache, const UnitMapState& unit_map);
+void UpdateFlowFieldBlockers(FlowFieldCache& cache, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_tiles);
+
+// Builds or repairs the fields of several targets, split over cache.thread_count workers.
+// Fields of older targets may be dropped, so previously returned references are invalidated.
+void PrepareFlowFields(FlowFieldCache& cache, const std::vector<glm::uvec2>& targets);
+const FlowField& GetFlowField(FlowFieldCache& cache, const glm::uvec2& target);
+
+// Next tile towards the target, none on the target itself or when it can't be reached.
+// The target can always be entered, so a field towards an occupied tile leads next to it.
+std::optional<glm::uvec2> GetFlowStep(const FlowField& field, const glm::uvec2& tile);
@@ -0,0 +1,277 @@
+#include <game/fog.hpp>
+
+// Coordinate transforms from the first octant to each of the eight
+constexpr int OCTANTS[8][4] = {
+    { 1, 0, 0, 1 },
+    { 0, 1, 1, 0 },
+    { 0, -1, 1, 0 },
+    { -1, 0, 0, 1 },
+    { -1, 0, 0, -1 },
+    { 0, -1, -1, 0 },
+    { 0, 1, -1, 0 },
+    { 1, 0, 0, -1 },
+};
+
+template <typename Visit>
+static void CastOctant(const FogOfWar& fog, const glm::ivec2& origin, int radius, int row, float start_slope, float end_slope, const int* transform, Visit& visit)
+{
+    if (start_slope < end_slope)
+    {
+        return;
+    }
+
+    float next_start_slope = start_slope;
+
+    for (int distance = row; distance <= radius; ++distance)
+    {
+        bool blocked = false;
+        int dy = -distance;
+
+        for (int dx = -distance; dx <= 0; ++dx)
+        {
+            float left_slope = (dx - 0.5f) / (dy + 0.5f);
+            float right_slope = (dx + 0.5f) / (dy - 0.5f);
+
+            if (start_slope < right_slope)
+                continue;
+
+            if (end_slope > left_slope)
+                break;
+
+            glm::ivec2 cell = origin + glm::ivec2(dx * transform[0] + dy * transform[1], dx * transform[2] + dy * transform[3]);
+            bool inside = cell.x >= 0 && cell.y >= 0 && cell.x < (int)fog.grid_size.x && cell.y < (int)fog.grid_size.y;
+
+            if (inside && dx * dx + dy * dy <= radius * radius)
+            {
+                visit(glm::uvec2(cell));
+            }
+
+            // The map edge stops sight like a wall
+            bool blocks = !inside || fog.sight_blockers.at(cell.x, cell.y);
+
+            if (blocked)
+            {
+                if (blocks)
+                {
+                    next_start_slope = right_slope;
+                    continue;
+                }
+
+                blocked = false;
+                start_slope = next_start_slope;
+            }
+            else if (blocks && distance < radius)
+            {
+                blocked = true;
+                CastOctant(fog, origin, radius, distance + 1, start_slope, left_slope, transform, visit);
+                next_start_slope = right_slope;
+            }
+        }
+
+        if (blocked)
+        {
+            break;
+        }
+    }
+}
+
+// Cells on the octant borders are visited twice. Adding and removing visit the same cells,
+// so the counts stay balanced.
+static void CastSight(FogOfWar& fog, const glm::uvec2& tile, const Unit& unit, int delta)
+{
+    auto [it, inserted] = fog.sightings.try_emplace(unit.team);
+
+    if (inserted)
+    {
+        it->second = tpp::Array2D<uint16_t>(fog.grid_size.x, fog.grid_size.y, 0);
+    }
+
+    auto& sightings = it->second;
+
+    auto visit = [&](const glm::uvec2& cell)
+    {
+        auto& count = sightings.at(cell.x, cell.y);
+        bool was_visible = count > 0;
+        count += delta;
+
+        if (was_visible != (count > 0))
+        {
+            fog.visibility_changes.emplace_back(cell);
+        }
+    };
+
+    visit(tile);
+
+    for (auto& transform : OCTANTS)
+    {
+        CastOctant(fog, glm::ivec2(tile), (int)GetUnitStats(unit.type).sight_range, 1, 1.0f, 0.0f, transform, visit);
+    }
+}
+
+FogOfWar CreateFogOfWar(const Level& level)
+{
+    FogOfWar fog {};
+    fog.grid_size = { level.map.getMapGridSize().x, level.map.getMapGridSize().y };
+    fog.sight_blockers = tpp::Array2D<uint8_t>(fog.grid_size.x, fog.grid_size.y, 0);
+    fog.viewers = tpp::Array2D<Unit>(fog.grid_size.x, fog.grid_size.y, Unit {});
+
+    for (auto it = level.terrain.begin(); it != level.terrain.end(); ++it)
+    {
+        fog.sight_blockers.at(it.getIndices()) = (*it).blocks_sight;
+    }
+
+    return fog;
+}
+
+void ResetFogUnits(FogOfWar& fog, const UnitMapState& unit_map)
+{
+    fog.sightings.clear();
+    fog.viewers = tpp::Array2D<Unit>(fog.grid_size.x, fog.grid_size.y, Unit {});
+
+    for (auto it = unit_map.units.begin(); it != unit_map.units.end(); ++it)
+    {
+        if ((*it).health <= 0)
+            continue;
+
+        glm::uvec2 tile = { it.getIndices().x, it.getIndices().y };
+        fog.viewers.at(tile.x, tile.y) = *it;
+        CastSight(fog, tile, *it, 1);
+    }
+
+    fog.visibility_changes.clear();
+}
+
+void UpdateFogUnits(FogOfWar& fog, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_tiles)
+{
+    for (auto tile : changed_tiles)
+    {
+        auto& before = fog.viewers.at(tile.x, tile.y);
+        auto after = unit_map.units.at(tile.x, tile.y);
+
+        bool before_alive = before.health > 0;
+        bool after_alive = after.health > 0;
+
+        // Damage or state changes keep the same sight area
+        if (before_alive == after_alive && (!after_alive || (before.team == after.team && before.type == after.type)))
+        {
+            before = after;
+            continue;
+        }
+
+        if (before_alive)
+        {
+            CastSight(fog, tile, before, -1);
+        }
+
+        if (after_alive)
+        {
+            CastSight(fog, tile, after, 1);
+        }
+
+        before = after;
+    }
+}
+
+bool UpdateFogTerrain(FogOfWar& fog, const Level& level, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_terrain)
+{
+    bool blockers_changed = false;
+
+    for (auto tile : changed_terrain)
+    {
+        auto& current = fog.sight_blockers.at(tile.x, tile.y);
+        uint8_t blocks_sight = level.terrain.at(tile.x, tile.y).blocks_sight;
+
+        if (current != blocks_sight)
+        {
+            current = blocks_sight;
+            blockers_changed = true;
+        }
+    }
+
+    if (blockers_changed)
+    {
+        ResetFogUnits(fog, unit_map);
+    }
+
+    return blockers_changed;
+}
+
+bool IsTileVisible(const FogOfWar& fog, UnitTeam team, const glm::uvec2& tile)
+{
+    auto it = fog.sightings.find(team);
+    return it != fog.sightings.end() && it->second.at(tile.x, tile.y) > 0;
+}
+
+bool IsUnitHidden(const FogOfWar* fog, const glm::uvec2& tile, const Unit& unit)
+{
+    return fog && unit.team != fog->viewer && !IsTileVisible(*fog, fog->viewer, tile);
+}
+
+void CopyFogVisibility(const FogOfWar& fog, FogVisibility& visibility)
+{
+    if (visibility.grid_size != fog.grid_size)
+    {
+        visibility.grid_size = fog.grid_size;
+        visibility.visible = tpp::Array2D<uint8_t>(fog.grid_size.x, fog.grid_size.y, 0);
+    }
+
+    visibility.viewer = fog.viewer;
+
+    auto it = fog.sightings.find(fog.viewer);
+
+    for (auto cell = visibility.visible.begin(); cell != visibility.visible.end(); ++cell)
+    {
+        *cell = it != fog.sightings.end() && it->second.at(cell.getIndices()) > 0;
+    }
+}
+
+bool IsTileVisible(const FogVisibility& visibility, const glm::uvec2& tile)
+{
+    return visibility.visible.at(tile.x, tile.y) != 0;
+}
+
+bool IsUnitHidden(const FogVisibility* visibility, const glm::uvec2& tile, const Unit& unit)
+{
+    return visibility && unit.team != visibility->viewer && !IsTileVisible(*visibility, tile);
+}
+
+void DrawFog(Renderer& renderer, const FogVisibility& visibility, const glm::vec2& tile_size, const FrameCamera& camera, const glm::uvec2& window_size)
+{
+    constexpr glm::vec4 FOG_COLOUR = { 0.0f, 0.0f, 0.05f, 0.55f };
+
+    auto is_hidden = [&](uint32_t x, uint32_t y)
+    {
+        return visibility.visible.at(x, y) == 0;
+    };
+
+    // Only the cells on screen, hidden runs in a row are merged into one rect
+    glm::vec2 world_min = camera.ToWorld(glm::vec2(0.0f)) / tile_size;
+    glm::vec2 world_max = camera.ToWorld(glm::vec2(window_size)) / tile_size;
+
+    glm::uvec2 first = glm::clamp(glm::ivec2(glm::floor(world_min)), glm::ivec2(0), glm::ivec2(visibility.grid_size));
+    glm::uvec2 last = glm::clamp(glm::ivec2(glm::floor(world_max)) + 1, glm::ivec2(0), glm::ivec2(visibility.grid_size));
+
+    for (uint32_t y = first.y; y < last.y; ++y)
+    {
+        uint32_t x = first.x;
+
+        while (x < last.x)
+        {
+            if (!is_hidden(x, y))
+            {
+                ++x;
+                continue;
+            }
+
+            uint32_t run_start = x;
+
+            while (x < last.x && is_hidden(x, y))
+            {
+                ++x;
+            }
+
+            SDL_FRect rect { run_start * tile_size.x, y * tile_size.y, (x - run_start) * tile_size.x, tile_size.y };
+            renderer.RenderFilledRect(camera.ToScreenRect(rect), FOG_COLOUR);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <game/level.hpp>
+#include <game/unit.hpp>
+
+// Per team fog of war. Every unit lights the cells in its sight range by recursive shadowcasting,
+// and each team keeps a count of sightings per cell instead of a flag. A unit that moves only
+// subtracts its old sight area and adds the new one, the rest of the grid is untouched.
+// Terrain with the "BlocksSight" property stops sight, but is visible itself.
+struct FogOfWar
+{
+    glm::uvec2 grid_size {};
+    tpp::Array2D<uint8_t> sight_blockers {};
+    std::unordered_map<UnitTeam, tpp::Array2D<uint16_t>> sightings {};
+
+    tpp::Array2D<Unit> viewers {}; // Units as they were when their sight was cast
+    UnitTeam viewer = UnitTeam::RED; // Team the map is drawn for
+
+    // Cells some team started or stopped seeing, for readers that follow the changes.
+    // Appended by the updates, cleared by the reader and by ResetFogUnits, after which everything is read again.
+    std::vector<glm::uvec2> visibility_changes {};
+};
+
+// All drawing needs from the fog: which tiles the viewing team sees
+struct FogVisibility
+{
+    glm::uvec2 grid_size {};
+    UnitTeam viewer = UnitTeam::RED;
+    tpp::Array2D<uint8_t> visible {};
+};
+
+FogOfWar CreateFogOfWar(const Level& level);
+// Recasts every unit, needed after loading a save or when the sight blockers changed
+void ResetFogUnits(FogOfWar& fog, const UnitMapState& unit_map);
+void UpdateFogUnits(FogOfWar& fog, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_tiles);
+// Takes the sight blockers of terrain that was edited in place, units are only recast when one changed.
+// Returns true when they were recast.
+bool UpdateFogTerrain(FogOfWar& fog, const Level& level, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_terrain);
+
+bool IsTileVisible(const FogOfWar& fog, UnitTeam team, const glm::uvec2& tile);
+// Enemies of the viewing team outside its sight, always false without fog
+bool IsUnitHidden(const FogOfWar* fog, const glm::uvec2& tile, const Unit& unit);
+
+// Overwrites the mask in place, its buffer is only reallocated when the grid size changed
+void CopyFogVisibility(const FogOfWar& fog, FogVisibility& visibility);
+bool IsTileVisible(const FogVisibility& visibility, const glm::uvec2& tile);
+bool IsUnitHidden(const FogVisibility* visibility, const glm::uvec2& tile, const Unit& unit);
+
+void DrawFog(Renderer& renderer, const FogVisibility& visibility, const glm::vec2& tile_size, const FrameCamera& camera, const glm::uvec2& window_size);
@@ -0,0 +1,423 @@
+#include <game/frame_capture.hpp>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <format>
+
+// PNG
+
+static const std::array<uint32_t, 256> CRC_TABLE = []()
+{
+    std::array<uint32_t, 256> table {};
+
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+
+        for (uint32_t bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+
+        table.at(i) = crc;
+    }
+
+    return table;
+}();
+
+static void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void AppendPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size)
+{
+    AppendBigEndian(out, size);
+    size_t crc_start = out.size();
+
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (size_t i = crc_start; i < out.size(); ++i)
+    {
+        crc = CRC_TABLE.at((crc ^ out[i]) & 0xFF) ^ (crc >> 8);
+    }
+
+    AppendBigEndian(out, crc ^ 0xFFFFFFFFu);
+}
+
+// RGB without compression: the zlib stream only holds stored blocks, so encoding is a copy
+// and the workers keep up with the frame rate. Smaller files are left to the video tools.
+static void EncodePng(const CapturedFrame& frame, const glm::uvec2& size, std::vector<uint8_t>& scanlines, std::vector<uint8_t>& out)
+{
+    constexpr size_t MAX_STORED_BLOCK = 65535;
+
+    size_t row_size = size_t(size.x) * 3 + 1;
+    scanlines.resize(row_size * size.y);
+
+    for (uint32_t y = 0; y < size.y; ++y)
+    {
+        const uint8_t* src = frame.pixels.data() + size_t(y) * size.x * 4;
+        uint8_t* dst = scanlines.data() + y * row_size;
+        *dst++ = 0; // No filter
+
+        for (uint32_t x = 0; x < size.x; ++x, src += 4, dst += 3)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+
+    out.clear();
+
+    const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.insert(out.end(), std::begin(signature), std::end(signature));
+
+    std::vector<uint8_t> header {};
+    AppendBigEndian(header, size.x);
+    AppendBigEndian(header, size.y);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8 bit RGB, deflate, no interlacing
+
+    AppendPngChunk(out, "IHDR", header.data(), header.size());
+
+    // The zlib stream is built in place after the chunk length, the CRC is added once it is complete
+    size_t chunk_start = out.size();
+    out.insert(out.end(), { 0, 0, 0, 0, 'I', 'D', 'A', 'T', 0x78, 0x01 });
+
+    uint32_t adler_a = 1;
+    uint32_t adler_b = 0;
+
+    for (size_t offset = 0; offset < scanlines.size(); offset += MAX_STORED_BLOCK)
+    {
+        size_t block_size = std::min(MAX_STORED_BLOCK, scanlines.size() - offset);
+        bool last = offset + block_size == scanlines.size();
+
+        out.push_back(last ? 1 : 0);
+        out.push_back(block_size);
+        out.push_back(block_size >> 8);
+        out.push_back(~block_size);
+        out.push_back(~block_size >> 8);
+        out.insert(out.end(), scanlines.begin() + offset, scanlines.begin() + offset + block_size);
+
+        // 5552 bytes is the longest run the sums can take before they overflow, as in zlib
+        for (size_t run = offset; run < offset + block_size; run += 5552)
+        {
+            size_t run_end = std::min(run + 5552, offset + block_size);
+
+            for (size_t i = run; i < run_end; ++i)
+            {
+                adler_a += scanlines[i];
+                adler_b += adler_a;
+            }
+
+            adler_a %= 65521;
+            adler_b %= 65521;
+        }
+    }
+
+    AppendBigEndian(out, (adler_b << 16) | adler_a);
+
+    uint32_t data_size = out.size() - chunk_start - 8;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        out[chunk_start + i] = data_size >> (24 - i * 8);
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (size_t i = chunk_start + 4; i < out.size(); ++i)
+    {
+        crc = CRC_TABLE.at((crc ^ out[i]) & 0xFF) ^ (crc >> 8);
+    }
+
+    AppendBigEndian(out, crc ^ 0xFFFFFFFFu);
+    AppendPngChunk(out, "IEND", nullptr, 0);
+}
+
+// Y4M
+
+// Full range BT.601, as declared by C420jpeg. Chroma is the average of each 2x2 block.
+static void ConvertToYuv420(const CapturedFrame& frame, const glm::uvec2& size, std::vector<uint8_t>& out)
+{
+    glm::uvec2 chroma_size = (size + 1u) / 2u;
+    out.resize(size_t(size.x) * size.y + size_t(chroma_size.x) * chroma_size.y * 2);
+
+    uint8_t* luma = out.data();
+    uint8_t* cb = luma + size_t(size.x) * size.y;
+    uint8_t* cr = cb + size_t(chroma_size.x) * chroma_size.y;
+
+    auto pixel = [&](uint32_t x, uint32_t y)
+    { return frame.pixels.data() + (size_t(std::min(y, size.y - 1)) * size.x + std::min(x, size.x - 1)) * 4; };
+
+    for (uint32_t y = 0; y < size.y; ++y)
+    {
+        for (uint32_t x = 0; x < size.x; ++x)
+        {
+            const uint8_t* p = pixel(x, y);
+            luma[size_t(y) * size.x + x] = (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+        }
+    }
+
+    for (uint32_t y = 0; y < chroma_size.y; ++y)
+    {
+        for (uint32_t x = 0; x < chroma_size.x; ++x)
+        {
+            int32_t r = 0, g = 0, b = 0;
+
+            for (auto [dx, dy] : { std::pair { 0u, 0u }, { 1u, 0u }, { 0u, 1u }, { 1u, 1u } })
+            {
+                const uint8_t* p = pixel(x * 2 + dx, y * 2 + dy);
+                r += p[0];
+                g += p[1];
+                b += p[2];
+            }
+
+            // Sums of four samples, so the shift also divides by four
+            cb[size_t(y) * chroma_size.x + x] = std::clamp(((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128, 0, 255);
+            cr[size_t(y) * chroma_size.x + x] = std::clamp(((128 * r - 107 * g - 21 * b + 512) >> 10) + 128, 0, 255);
+        }
+    }
+}
+
+// Workers
+
+static bool WriteFrame(FrameCapture& capture, const CapturedFrame& frame, std::vector<uint8_t>& scratch, std::vector<uint8_t>& encoded)
+{
+    if (capture.config.format == CaptureFormat::Y4M)
+    {
+        // Only one worker writes the video, so frames stay in order
+        ConvertToYuv420(frame, capture.size, encoded);
+
+        capture.y4m_file << "FRAME\n";
+        capture.y4m_file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+        return capture.y4m_file.good();
+    }
+
+    EncodePng(frame, capture.size, scratch, encoded);
+
+    auto path = std::filesystem::path(capture.config.path) / std::format("frame_{:06}.png", frame.frame_number);
+    std::ofstream file { path, std::ios::binary };
+
+    file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    return file.good();
+}
+
+static void RunCaptureWorker(FrameCapture& capture)
+{
+    std::vector<uint8_t> scratch {};
+    std::vector<uint8_t> encoded {};
+
+    while (true)
+    {
+        uint32_t index {};
+
+        {
+            std::unique_lock lock { capture.mutex };
+            capture.wake.wait(lock, [&]()
+                { return !capture.queued_frames.empty() || capture.stop; });
+
+            // Stopping still writes out every queued frame
+            if (capture.queued_frames.empty())
+                return;
+
+            index = capture.queued_frames.front();
+            capture.queued_frames.pop_front();
+        }
+
+        auto& frame = capture.frames.at(index);
+        bool success = ConvertRenderPixels(frame.readback, frame.pixels.data()) && WriteFrame(capture, frame, scratch, encoded);
+        frame.readback.reset();
+
+        {
+            std::scoped_lock lock { capture.mutex };
+            capture.free_frames.push_back(index);
+
+            if (success)
+                capture.written++;
+            else
+                capture.failed++;
+        }
+
+        capture.frame_freed.notify_one();
+    }
+}
+
+std::unique_ptr<FrameCapture> StartFrameCapture(SDL_Renderer* sdl_renderer, const FrameCaptureConfig& config)
+{
+    auto capture = std::make_unique<FrameCapture>();
+    capture->config = config;
+
+    capture->sdl_renderer = sdl_renderer;
+    int width = 0, height = 0;
+
+    if (!capture->sdl_renderer || !SDL_GetCurrentRenderOutputSize(capture->sdl_renderer, &width, &height) || width <= 0 || height <= 0)
+    {
+        return nullptr;
+    }
+
+    capture->size = glm::uvec2(width, height);
+
+    if (config.format == CaptureFormat::Y4M)
+    {
+        capture->y4m_file.open(config.path, std::ios::binary);
+
+        if (!capture->y4m_file)
+        {
+            return nullptr;
+        }
+
+        capture->y4m_file << std::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg\n", width, height, config.fps);
+    }
+    else
+    {
+        std::error_code error {};
+        std::filesystem::create_directories(config.path, error);
+
+        if (!std::filesystem::is_directory(config.path, error))
+        {
+            return nullptr;
+        }
+    }
+
+    uint32_t buffer_count = std::max(config.buffer_count, 1u);
+    capture->frames.resize(buffer_count);
+
+    for (uint32_t i = 0; i < buffer_count; ++i)
+    {
+        capture->frames.at(i).pixels.resize(size_t(width) * height * 4);
+        capture->free_frames.push_back(i);
+    }
+
+    uint32_t worker_count = 1;
+
+    if (config.format == CaptureFormat::PNG_SEQUENCE)
+    {
+        // Leaves a core for the game
+        worker_count = config.worker_count != 0
+            ? config.worker_count
+            : std::clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1;
+    }
+
+    for (uint32_t i = 0; i < worker_count; ++i)
+    {
+        capture->workers.emplace_back(RunCaptureWorker, std::ref(*capture));
+    }
+
+    return capture;
+}
+
+CaptureResult CaptureFrame(FrameCapture& capture)
+{
+    // A resized window can't be written into buffers of the old size, that is an error rather than a drop
+    int width = 0, height = 0;
+
+    if (!SDL_GetCurrentRenderOutputSize(capture.sdl_renderer, &width, &height))
+    {
+        std::scoped_lock lock { capture.mutex };
+        capture.failed++;
+        return CaptureResult::READ_FAILED;
+    }
+
+    if (glm::uvec2(width, height) != capture.size)
+    {
+        capture.size_errors++;
+        capture.last_error_size = glm::uvec2(width, height);
+        return CaptureResult::SIZE_CHANGED;
+    }
+
+    uint32_t index {};
+
+    {
+        std::unique_lock lock { capture.mutex };
+
+        if (capture.config.wait_for_buffer)
+        {
+            capture.frame_freed.wait(lock, [&]()
+                { return !capture.free_frames.empty(); });
+        }
+
+        if (capture.free_frames.empty())
+        {
+            capture.dropped++;
+            return CaptureResult::DROPPED;
+        }
+
+        index = capture.free_frames.back();
+        capture.free_frames.pop_back();
+    }
+
+    auto& frame = capture.frames.at(index);
+
+    // The readback itself waits for the GPU, even the format conversion is left to the workers
+    frame.readback = ReadRenderPixels(capture.sdl_renderer, capture.size);
+    bool success = frame.readback != nullptr;
+
+    {
+        std::scoped_lock lock { capture.mutex };
+
+        if (!success)
+        {
+            capture.free_frames.push_back(index);
+            capture.failed++;
+            return CaptureResult::READ_FAILED;
+        }
+
+        frame.frame_number = capture.captured++;
+        capture.queued_frames.push_back(index);
+    }
+
+    capture.wake.notify_one();
+    return CaptureResult::CAPTURED;
+}
+
+void StopFrameCapture(FrameCapture& capture)
+{
+    {
+        std::scoped_lock lock { capture.mutex };
+        capture.stop = true;
+    }
+
+    capture.wake.notify_all();
+
+    for (auto& worker : capture.workers)
+    {
+        worker.join();
+    }
+
+    capture.workers.clear();
+    capture.y4m_file.close();
+}
+
+std::string FormatCaptureReport(FrameCapture& capture)
+{
+    std::scoped_lock lock { capture.mutex };
+
+    return std::format(
+        "Captured {} frames to {}: {} written, {} failed, {} dropped while every buffer was busy\n",
+        capture.captured,
+        capture.config.path,
+        capture.written,
+        capture.failed,
+        capture.dropped);
+}
+
+std::string FormatCaptureErrors(FrameCapture& capture)
+{
+    if (capture.size_errors == 0)
+        return {};
+
+    return std::format(
+        "Failed to capture {} frames: the window was resized from {}x{} to {}x{}\n",
+        capture.size_errors,
+        capture.size.x,
+        capture.size.y,
+        capture.last_error_size.x,
+        capture.last_error_size.y);
+}
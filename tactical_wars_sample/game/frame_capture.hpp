@@ -0,0 +1,84 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <game/render_target.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records the rendered frames to disk without stalling the frame.
+// The main thread only reads the render target back and queues it with one of a ring of preallocated buffers,
+// converting it into the buffer, encoding and writing happen on worker threads. When every buffer is still waiting to be written
+// the frame is dropped instead of waiting, unless wait_for_buffer is set. Works with the offscreen video driver.
+enum class CaptureFormat : uint8_t
+{
+    PNG_SEQUENCE, // One uncompressed PNG per frame in a directory, encoded by several workers
+    Y4M // Raw 4:2:0 video in a single file, written in order by one worker
+};
+
+struct FrameCaptureConfig
+{
+    std::string path {}; // Directory for PNG_SEQUENCE, file for Y4M
+    CaptureFormat format = CaptureFormat::Y4M;
+    uint32_t fps = 60; // Only stored in the Y4M header, see README for fixed step recording
+    uint32_t buffer_count = 8;
+    uint32_t worker_count = 0; // PNG_SEQUENCE only, 0 picks from the hardware
+    bool wait_for_buffer = false; // Waits for a worker instead of dropping, when nobody watches the frames
+};
+
+enum class CaptureResult : uint8_t
+{
+    CAPTURED,
+    DROPPED, // Every buffer was still waiting to be written
+    SIZE_CHANGED, // The window no longer has the size the capture started with
+    READ_FAILED
+};
+
+struct CapturedFrame
+{
+    RenderPixels readback {}; // In the renderer's format, released by the worker once converted
+    std::vector<uint8_t> pixels {}; // RGBA, allocated once for the capture size
+    uint64_t frame_number {};
+};
+
+struct FrameCapture
+{
+    FrameCaptureConfig config {};
+    SDL_Renderer* sdl_renderer {};
+    glm::uvec2 size {};
+
+    std::vector<CapturedFrame> frames {};
+    std::vector<uint32_t> free_frames {}; // Ready to be captured into
+    std::deque<uint32_t> queued_frames {}; // Waiting for a worker, oldest first
+
+    std::ofstream y4m_file {};
+    std::vector<std::thread> workers {};
+    std::mutex mutex {};
+    std::condition_variable wake {};
+    std::condition_variable frame_freed {};
+    bool stop = false;
+
+    // Main thread only
+    uint64_t captured {};
+    uint64_t dropped {};
+    uint64_t size_errors {};
+    glm::uvec2 last_error_size {};
+
+    // Under the mutex
+    uint64_t written {};
+    uint64_t failed {};
+};
+
+// Null when the render target can't be read or the output can't be created
+std::unique_ptr<FrameCapture> StartFrameCapture(SDL_Renderer* sdl_renderer, const FrameCaptureConfig& config);
+
+// Call after the frame is drawn and before Window::RenderPresent
+CaptureResult CaptureFrame(FrameCapture& capture);
+
+// Writes every queued frame before returning
+void StopFrameCapture(FrameCapture& capture);
+std::string FormatCaptureReport(FrameCapture& capture);
+// Empty when every frame could be read back
+std::string FormatCaptureErrors(FrameCapture& capture);
@@ -0,0 +1,159 @@
+#include <game/frame_pacing.hpp>
+
+#include <cmath>
+#include <fstream>
+
+constexpr size_t MAX_PEEKED_EVENTS = 64;
+constexpr float NS_PER_MS = 1'000'000.0f;
+
+void AddLatencySample(LatencyHistogram& histogram, float ms)
+{
+    auto bucket = std::min(size_t(std::max(ms, 0.0f) / LatencyHistogram::BUCKET_MS), histogram.buckets.size() - 1);
+
+    ++histogram.buckets.at(bucket);
+    ++histogram.count;
+    histogram.max_ms = std::max(histogram.max_ms, ms);
+}
+
+float GetLatencyPercentile(const LatencyHistogram& histogram, float percentile)
+{
+    if (histogram.count == 0)
+    {
+        return 0.0f;
+    }
+
+    auto target = uint32_t(std::ceil(histogram.count * percentile / 100.0f));
+    uint32_t seen = 0;
+
+    for (size_t i = 0; i < histogram.buckets.size(); ++i)
+    {
+        seen += histogram.buckets[i];
+
+        if (seen >= std::max(target, 1u))
+        {
+            return (i + 1) * LatencyHistogram::BUCKET_MS;
+        }
+    }
+
+    return histogram.max_ms;
+}
+
+FramePacer CreateFramePacer(Renderer& renderer, FramePacingMode mode, uint32_t frame_cap)
+{
+    FramePacer pacer {};
+    pacer.mode = mode;
+    pacer.frame_cap = std::max(frame_cap, 1u);
+    pacer.input_timestamps.reserve(MAX_PEEKED_EVENTS * 2);
+    pacer.pipelined_timestamps.reserve(MAX_PEEKED_EVENTS * 2);
+
+    if (mode == FramePacingMode::LOW_LATENCY)
+    {
+        pacer.frame_period_ms = 1000.0f / pacer.frame_cap;
+    }
+
+    renderer.SetVSync(mode != FramePacingMode::LOW_LATENCY);
+    return pacer;
+}
+
+// Peeks without removing, Window::ProcessEvents still handles the events
+static void PeekEventTimestamps(uint32_t event_type, std::vector<uint64_t>& out)
+{
+    SDL_Event events[MAX_PEEKED_EVENTS];
+    int count = SDL_PeepEvents(events, MAX_PEEKED_EVENTS, SDL_PEEKEVENT, event_type, event_type);
+
+    for (int i = 0; i < count; ++i)
+    {
+        out.emplace_back(events[i].common.timestamp);
+    }
+}
+
+void WaitForInput(FramePacer& pacer)
+{
+    if (pacer.mode != FramePacingMode::VSYNC && pacer.last_present_ns != 0)
+    {
+        // The next present is one period after the last one, leave time for the measured work
+        float lead_ms = pacer.frame_period_ms - pacer.work_ms - pacer.safety_margin_ms;
+
+        if (lead_ms > 0.0f)
+        {
+            uint64_t wake_ns = pacer.last_present_ns + uint64_t(lead_ms * NS_PER_MS);
+            uint64_t now_ns = SDL_GetTicksNS();
+
+            if (wake_ns > now_ns)
+            {
+                SDL_DelayPrecise(wake_ns - now_ns);
+            }
+        }
+    }
+
+    pacer.input_read_ns = SDL_GetTicksNS();
+    pacer.input_timestamps.clear();
+
+    SDL_PumpEvents();
+    PeekEventTimestamps(SDL_EVENT_KEY_DOWN, pacer.input_timestamps);
+    PeekEventTimestamps(SDL_EVENT_MOUSE_BUTTON_DOWN, pacer.input_timestamps);
+}
+
+void OnFrameSubmitted(FramePacer& pacer)
+{
+    // Not up to the present, which blocks until the vblank with vsync
+    float work_ms = (SDL_GetTicksNS() - pacer.input_read_ns) / NS_PER_MS;
+    pacer.work_ms = work_ms > pacer.work_ms ? work_ms : pacer.work_ms * 0.95f + work_ms * 0.05f;
+}
+
+void OnFramePresented(FramePacer& pacer)
+{
+    uint64_t present_ns = SDL_GetTicksNS();
+
+    if (pacer.pipelined)
+    {
+        std::swap(pacer.input_timestamps, pacer.pipelined_timestamps);
+    }
+
+    for (auto timestamp : pacer.input_timestamps)
+    {
+        AddLatencySample(pacer.input_latency, (present_ns - std::min(timestamp, present_ns)) / NS_PER_MS);
+    }
+
+    if (pacer.last_present_ns != 0)
+    {
+        float interval_ms = (present_ns - pacer.last_present_ns) / NS_PER_MS;
+        AddLatencySample(pacer.frame_intervals, interval_ms);
+
+        // Missed vblanks would stretch the refresh period estimate
+        if (pacer.mode != FramePacingMode::LOW_LATENCY && interval_ms < pacer.frame_period_ms * 1.5f)
+        {
+            pacer.frame_period_ms = std::clamp(pacer.frame_period_ms * 0.9f + interval_ms * 0.1f, 4.0f, 50.0f);
+        }
+    }
+
+    pacer.last_present_ns = present_ns;
+}
+
+std::string FormatLatencyReport(const FramePacer& pacer)
+{
+    auto format_histogram = [](const char* name, const LatencyHistogram& histogram)
+    {
+        return std::format("{}: {} samples, p50 {:.2f} ms, p95 {:.2f} ms, p99 {:.2f} ms, max {:.2f} ms\n",
+            name, histogram.count,
+            GetLatencyPercentile(histogram, 50.0f),
+            GetLatencyPercentile(histogram, 95.0f),
+            GetLatencyPercentile(histogram, 99.0f),
+            histogram.max_ms);
+    };
+
+    return format_histogram("Input to present", pacer.input_latency) + format_histogram("Frame interval", pacer.frame_intervals);
+}
+
+bool WriteLatencyHistograms(const FramePacer& pacer, const std::string& path)
+{
+    std::ofstream file { path, std::ios::trunc };
+    file << "bucket_ms,input_to_present,frame_interval\n";
+
+    for (size_t i = 0; i < pacer.input_latency.buckets.size(); ++i)
+    {
+        file << std::format("{:.2f},{},{}\n", (i + 1) * LatencyHistogram::BUCKET_MS, pacer.input_latency.buckets[i], pacer.frame_intervals.buckets[i]);
+    }
+
+    return bool(file);
+}
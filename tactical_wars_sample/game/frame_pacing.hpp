@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <resources/texture.hpp>
+#include <string>
+#include <vector>
+
+// Decides when each frame reads its input. Reading input as late as the frame work allows
+// shortens the time between a click and the frame that shows it. Latency is measured from the
+// SDL timestamp of every key and mouse button press to the return of RenderPresent.
+enum class FramePacingMode : uint8_t
+{
+    VSYNC, // Input is read right after the previous present, as before
+    LATE_INPUT, // Vsync, input is read just early enough to finish the frame before the next vblank
+    LOW_LATENCY // No vsync, frames are capped and input is read just before each capped present
+};
+
+// Fixed buckets, the last one also holds every longer sample
+struct LatencyHistogram
+{
+    static constexpr float BUCKET_MS = 0.25f;
+
+    std::array<uint32_t, 400> buckets {};
+    uint32_t count {};
+    float max_ms {};
+};
+
+void AddLatencySample(LatencyHistogram& histogram, float ms);
+// Upper edge of the bucket holding the percentile, 0 when empty
+float GetLatencyPercentile(const LatencyHistogram& histogram, float percentile);
+
+struct FramePacer
+{
+    FramePacingMode mode = FramePacingMode::VSYNC;
+    uint32_t frame_cap = 240; // LOW_LATENCY only
+
+    float frame_period_ms = 1000.0f / 60.0f; // Measured present interval with vsync
+    float work_ms = 4.0f; // Input read to present, rises at once and decays slowly
+    float safety_margin_ms = 1.0f;
+
+    uint64_t last_present_ns {};
+    uint64_t input_read_ns {};
+    std::vector<uint64_t> input_timestamps {}; // Presses read this frame
+
+    // The input of a frame is presented with the next one when the simulation runs a frame ahead
+    bool pipelined = false;
+    std::vector<uint64_t> pipelined_timestamps {}; // Presses read the frame before
+
+    LatencyHistogram input_latency {};
+    LatencyHistogram frame_intervals {};
+};
+
+// Sets the renderer vsync to match the mode
+FramePacer CreateFramePacer(Renderer& renderer, FramePacingMode mode, uint32_t frame_cap = 240);
+
+// Sleeps until input should be read, then notes the timestamps of the pending presses.
+// Call right before Window::ProcessEvents.
+void WaitForInput(FramePacer& pacer);
+// Call right before Window::RenderPresent, ends the measured frame work
+void OnFrameSubmitted(FramePacer& pacer);
+// Call right after Window::RenderPresent
+void OnFramePresented(FramePacer& pacer);
+
+std::string FormatLatencyReport(const FramePacer& pacer);
+// One row per bucket: upper edge in ms, input latency count, frame interval count
+bool WriteLatencyHistograms(const FramePacer& pacer, const std::string& path);
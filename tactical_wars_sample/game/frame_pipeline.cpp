@@ -0,0 +1,422 @@
+#include <game/frame_pipeline.hpp>
+
+#include <algorithm>
+#include <game/save_game.hpp>
+#include <game/ui.hpp>
+#include <iostream>
+
+void ResetSimulationAnimations(FrameSimulation& simulation, const GameAssets& assets)
+{
+    auto& level = *simulation.game_state.current_level;
+
+    simulation.assets = &assets;
+    simulation.level_animations.clear();
+    simulation.unit_animations.clear();
+
+    for (auto& draw_data : level.tile_set_data)
+    {
+        simulation.level_animations.emplace_back(draw_data.animation_states);
+    }
+
+    for (auto& [team, team_assets] : assets.team_assets)
+    {
+        simulation.unit_animations[team] = team_assets.draw_data.animation_states;
+    }
+
+    simulation.assets_generation++;
+}
+
+static void AddChangedTiles(FrameSimulation& simulation, const std::vector<glm::uvec2>& changed_tiles)
+{
+    if (changed_tiles.empty())
+        return;
+
+    simulation.changed_tiles.insert(simulation.changed_tiles.end(), changed_tiles.begin(), changed_tiles.end());
+    simulation.units_revision++;
+
+    for (auto tile : changed_tiles)
+    {
+        simulation.unit_log.push_back(UnitTileChange { simulation.units_revision, tile });
+    }
+}
+
+static std::vector<UnitTileChange>::iterator FindChangesAfter(std::vector<UnitTileChange>& log, uint64_t revision)
+{
+    return std::upper_bound(log.begin(), log.end(), revision, [](uint64_t value, const UnitTileChange& change)
+        { return value < change.revision; });
+}
+
+// Brings the units and fog of a reused slot up to date, before its units_revision is overwritten
+static void PublishUnitState(FrameSimulation& simulation, RenderSnapshot& snapshot)
+{
+    auto& unit_state = simulation.game_state.unit_state;
+    auto& fog = *simulation.game_state.fog;
+    auto& log = simulation.unit_log;
+
+    if (simulation.units_reset)
+    {
+        log.clear();
+        simulation.unit_log_revision = simulation.units_revision;
+    }
+
+    bool logged = snapshot.units_revision >= simulation.unit_log_revision && snapshot.fog.grid_size == fog.grid_size;
+    snapshot.unit_state.map_tile_size = unit_state.map_tile_size;
+
+    if (!logged)
+    {
+        snapshot.unit_state.units = unit_state.units;
+        CopyFogVisibility(fog, snapshot.fog);
+    }
+    else
+    {
+        // The fog of the slot was drawn for another team, it is read again whole
+        bool same_viewer = snapshot.fog.viewer == fog.viewer;
+
+        if (!same_viewer)
+        {
+            CopyFogVisibility(fog, snapshot.fog);
+        }
+
+        auto newer = FindChangesAfter(log, snapshot.units_revision);
+
+        for (auto it = newer; it != log.end(); ++it)
+        {
+            auto tile = it->tile;
+            snapshot.unit_state.units.at(tile.x, tile.y) = unit_state.units.at(tile.x, tile.y);
+
+            if (same_viewer)
+            {
+                snapshot.fog.visible.at(tile.x, tile.y) = IsTileVisible(fog, fog.viewer, tile);
+            }
+        }
+    }
+
+    if (log.size() > simulation.max_unit_log)
+    {
+        uint64_t revision = log.at(log.size() / 2).revision;
+        auto older = FindChangesAfter(log, revision);
+
+        log.erase(log.begin(), older);
+        simulation.unit_log_revision = revision;
+    }
+}
+
+void StepFrameSimulation(FrameSimulation& simulation, SimulationInput input, RenderSnapshot& snapshot)
+{
+    auto& game_state = simulation.game_state;
+    auto& session = simulation.session;
+    auto& cursor = simulation.cursor;
+    auto& unit_tweens = simulation.unit_tweens;
+    auto& effects = simulation.effects;
+
+    // Saves and undo would change the state behind the peer's back
+    if (session)
+    {
+        input.save_requested = false;
+        input.load_requested = false;
+        input.undo_requested = false;
+        input.redo_requested = false;
+    }
+
+    if (input.save_requested)
+    {
+        auto& pending_save = simulation.pending_save;
+
+        // One save in flight at a time
+        if (!pending_save.valid() || pending_save.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            pending_save = SaveGameAsync(game_state, cursor, simulation.quicksave_path);
+        }
+    }
+
+    if (input.load_requested && LoadGame(simulation.quicksave_path, game_state, cursor))
+    {
+        ResetFogUnits(*game_state.fog, game_state.unit_state);
+        ClearUndoHistory(simulation.undo_history);
+        ClearUnitTweens(unit_tweens, game_state.fog->grid_size);
+        ClearCombatEffects(effects);
+        simulation.units_reset = true;
+        simulation.units_revision++;
+    }
+
+    if (input.undo_requested || input.redo_requested)
+    {
+        if (auto deselected_tile = CancelCursorSelection(cursor, game_state))
+        {
+            AddChangedTiles(simulation, { deselected_tile.value() });
+        }
+
+        auto changed_tiles = input.undo_requested
+            ? Undo(simulation.undo_history, game_state)
+            : Redo(simulation.undo_history, game_state);
+
+        if (changed_tiles)
+        {
+            UpdateFogUnits(*game_state.fog, game_state.unit_state, changed_tiles.value());
+            ClearUnitTweens(unit_tweens, game_state.fog->grid_size);
+            ClearCombatEffects(effects);
+            AddChangedTiles(simulation, changed_tiles.value());
+        }
+    }
+
+    if (session)
+    {
+        auto update = UpdateLockstep(session.value(), game_state, false);
+
+        UpdateFogUnits(*game_state.fog, game_state.unit_state, update.changed_tiles);
+
+        for (auto& path : update.moved_paths)
+        {
+            AddUnitTween(unit_tweens, path);
+        }
+
+        for (auto& attack : update.attacks)
+        {
+            SpawnAttackEffects(effects, attack);
+        }
+
+        AddChangedTiles(simulation, update.changed_tiles);
+
+        if (update.turn_ended)
+        {
+            AddChangedTiles(simulation, AdvanceTurn(game_state));
+        }
+
+        if (session->desynced || session->disconnected)
+        {
+            // Keeps playing the current state as a local hot seat match
+            std::cerr << (session->desynced ? "Multiplayer session desynced\n" : "Multiplayer peer disconnected\n");
+            session.reset();
+        }
+    }
+
+    // Only the team of this instance is played with the mouse
+    bool local_turn = !session || IsLocalTurn(session.value(), game_state);
+
+    if (input.next_round && local_turn && session)
+    {
+        if (auto deselected_tile = CancelCursorSelection(cursor, game_state))
+        {
+            AddChangedTiles(simulation, { deselected_tile.value() });
+        }
+
+        SendLockstepEndTurn(session.value(), game_state);
+        AddChangedTiles(simulation, AdvanceTurn(game_state));
+    }
+    else if (input.next_round && local_turn)
+    {
+        uint32_t turn_before = game_state.turn_index;
+        auto reset_tiles = AdvanceTurn(game_state);
+
+        PushUndoRecord(simulation.undo_history, MakeTurnUndoRecord(game_state, reset_tiles, turn_before));
+        AddChangedTiles(simulation, reset_tiles);
+    }
+
+    if (input.camera_jump)
+    {
+        simulation.camera.translation = input.camera_jump.value();
+    }
+
+    simulation.camera.zoom = input.camera_zoom;
+    simulation.camera.translation += input.movement * input.deltatime.count();
+    auto frame_camera = simulation.camera.MakeFrameCamera();
+
+    // Hot seat, the map is seen through the eyes of the team playing
+    game_state.fog->viewer = session ? session->local_team : GetCurrentTeam(game_state);
+
+    auto cursor_commands = UpdateCursorInput(
+        cursor,
+        game_state,
+        frame_camera.ToWorld(input.mouse_pos),
+        input.mouse_click && local_turn,
+        input.deltatime);
+
+    UpdateFogUnits(*game_state.fog, game_state.unit_state, cursor_commands.changed_tiles);
+
+    AddChangedTiles(simulation, cursor_commands.changed_tiles);
+
+    if (cursor_commands.attack)
+    {
+        SpawnAttackEffects(effects, cursor_commands.attack.value());
+    }
+
+    if (cursor_commands.undo_record)
+    {
+        PushUndoRecord(simulation.undo_history, cursor_commands.undo_record.value());
+    }
+
+    if (session && cursor_commands.action)
+    {
+        SendLockstepAction(session.value(), game_state, cursor_commands.action.value());
+    }
+
+    UpdateUnitTweens(unit_tweens, input.deltatime);
+    UpdateCombatEffects(effects, input.deltatime);
+
+    auto& tilesets = game_state.current_level->map.getTileSets();
+
+    for (size_t i = 0; i < simulation.level_animations.size(); ++i)
+    {
+        UpdateAnimationStates(tilesets.at(i), simulation.level_animations.at(i), input.deltatime);
+    }
+
+    for (auto& [team, animation_states] : simulation.unit_animations)
+    {
+        UpdateAnimationStates(simulation.assets->team_assets.at(team).tileset, animation_states, input.deltatime);
+    }
+
+    if (simulation.round_text_turn != game_state.turn_index)
+    {
+        simulation.round_text_turn = game_state.turn_index;
+        simulation.round_text = FormatRoundText(game_state);
+    }
+
+    // The minimap also redraws the tiles whose enemies came into or out of sight
+    AddChangedTiles(simulation, game_state.fog->visibility_changes);
+    game_state.fog->visibility_changes.clear();
+
+    // Assigned over the previous contents of the slot, so its buffers are reused
+    snapshot.frame_index = ++simulation.frame_index;
+    snapshot.deltatime = input.deltatime;
+    snapshot.camera = frame_camera;
+
+    PublishUnitState(simulation, snapshot);
+    snapshot.unit_tweens = unit_tweens;
+    CopyLiveCombatEffects(effects, snapshot.effects);
+    snapshot.cursor_overlay.draw_commands = std::move(cursor_commands.draw_commands);
+
+    snapshot.level_animations = simulation.level_animations;
+    snapshot.unit_animations = simulation.unit_animations;
+    snapshot.assets_generation = simulation.assets_generation;
+    snapshot.round_text = simulation.round_text;
+
+    snapshot.units_revision = simulation.units_revision;
+    snapshot.previous_units_revision = simulation.published_units_revision;
+    snapshot.changed_tiles.assign(simulation.changed_tiles.begin(), simulation.changed_tiles.end());
+    snapshot.units_reset = simulation.units_reset;
+
+    simulation.published_units_revision = simulation.units_revision;
+    simulation.changed_tiles.clear();
+    simulation.units_reset = false;
+}
+
+void ApplySnapshotAnimations(const RenderSnapshot& snapshot, const FrameSimulation& simulation, Level& level, GameAssets& assets)
+{
+    // Taken before the assets were reloaded
+    if (snapshot.assets_generation != simulation.assets_generation)
+        return;
+
+    for (size_t i = 0; i < snapshot.level_animations.size(); ++i)
+    {
+        level.tile_set_data.at(i).animation_states = snapshot.level_animations.at(i);
+    }
+
+    for (auto& [team, animation_states] : snapshot.unit_animations)
+    {
+        assets.team_assets.at(team).draw_data.animation_states = animation_states;
+    }
+}
+
+static void PublishSnapshot(FramePipeline& pipeline)
+{
+    uint32_t previous = pipeline.ready_slot.exchange(pipeline.write_slot | FramePipeline::FRESH_SNAPSHOT, std::memory_order_acq_rel);
+    pipeline.write_slot = previous & FramePipeline::SLOT_MASK;
+}
+
+static void RunSimulationThread(FramePipeline& pipeline)
+{
+    while (true)
+    {
+        SimulationInput input {};
+
+        {
+            std::unique_lock lock { pipeline.mutex };
+            pipeline.wake.wait(lock, [&]()
+                { return pipeline.pending_input || pipeline.stop; });
+
+            if (!pipeline.pending_input)
+                return;
+
+            input = pipeline.pending_input.value();
+            pipeline.pending_input.reset();
+            pipeline.stepping = true;
+        }
+
+        StepFrameSimulation(*pipeline.simulation, input, pipeline.snapshots.at(pipeline.write_slot));
+        PublishSnapshot(pipeline);
+
+        {
+            std::scoped_lock lock { pipeline.mutex };
+            pipeline.stepping = false;
+        }
+
+        pipeline.wake.notify_all();
+    }
+}
+
+std::unique_ptr<FramePipeline> StartFramePipeline(FrameSimulation& simulation, bool threaded)
+{
+    auto pipeline = std::make_unique<FramePipeline>();
+    pipeline->simulation = &simulation;
+    pipeline->threaded = threaded;
+
+    if (threaded)
+    {
+        pipeline->thread = std::thread(RunSimulationThread, std::ref(*pipeline));
+    }
+
+    return pipeline;
+}
+
+void SubmitSimulationInput(FramePipeline& pipeline, const SimulationInput& input)
+{
+    if (!pipeline.threaded)
+    {
+        StepFrameSimulation(*pipeline.simulation, input, pipeline.snapshots.at(pipeline.write_slot));
+        PublishSnapshot(pipeline);
+        return;
+    }
+
+    {
+        std::unique_lock lock { pipeline.mutex };
+        pipeline.wake.wait(lock, [&]()
+            { return !pipeline.pending_input && !pipeline.stepping; });
+
+        pipeline.pending_input = input;
+    }
+
+    pipeline.wake.notify_all();
+}
+
+void WaitForSimulation(FramePipeline& pipeline)
+{
+    std::unique_lock lock { pipeline.mutex };
+    pipeline.wake.wait(lock, [&]()
+        { return !pipeline.pending_input && !pipeline.stepping; });
+}
+
+const RenderSnapshot* AcquireRenderSnapshot(FramePipeline& pipeline)
+{
+    if (pipeline.ready_slot.load(std::memory_order_acquire) & FramePipeline::FRESH_SNAPSHOT)
+    {
+        uint32_t ready = pipeline.ready_slot.exchange(pipeline.read_slot, std::memory_order_acq_rel);
+        pipeline.read_slot = ready & FramePipeline::SLOT_MASK;
+        pipeline.has_snapshot = true;
+    }
+
+    return pipeline.has_snapshot ? &pipeline.snapshots.at(pipeline.read_slot) : nullptr;
+}
+
+void StopFramePipeline(FramePipeline& pipeline)
+{
+    if (!pipeline.thread.joinable())
+        return;
+
+    {
+        std::scoped_lock lock { pipeline.mutex };
+        pipeline.stop = true;
+    }
+
+    pipeline.wake.notify_all();
+    pipeline.thread.join();
+}
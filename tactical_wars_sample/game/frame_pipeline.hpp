@@ -0,0 +1,141 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <game/cursor.hpp>
+#include <game/effects.hpp>
+#include <game/lockstep.hpp>
+#include <game/tween.hpp>
+#include <game/undo.hpp>
+#include <mutex>
+#include <thread>
+
+// Runs the game simulation on its own thread, one frame ahead of the renderer.
+// The simulation steps the game state from the input of a frame and publishes an immutable
+// snapshot of everything that is drawn, while the main thread draws the previous snapshot.
+// Every SDL call stays on the main thread. Snapshots go through a triple buffer,
+// so publishing and drawing never wait on each other.
+
+// Input the main thread read for one frame
+struct SimulationInput
+{
+    DeltaMS deltatime {};
+    glm::vec2 mouse_pos {};
+    glm::vec2 movement {};
+    float camera_zoom = 1.0f;
+    std::optional<glm::vec2> camera_jump {}; // The minimap was clicked, the click is not passed on
+
+    bool mouse_click = false;
+    bool next_round = false;
+    bool save_requested = false;
+    bool load_requested = false;
+    bool undo_requested = false;
+    bool redo_requested = false;
+};
+
+// Everything drawn for one frame, never written while the main thread holds it
+struct RenderSnapshot
+{
+    uint64_t frame_index {};
+    DeltaMS deltatime {};
+    FrameCamera camera {};
+
+    UnitMapState unit_state {};
+    UnitTweens unit_tweens {};
+    CombatEffects effects {}; // Only the live slots, see CopyLiveCombatEffects
+    FogVisibility fog {};
+    CursorUpdateResult cursor_overlay {}; // Only the draw commands
+
+    std::vector<AnimationStates> level_animations {}; // Per level tileset
+    std::unordered_map<UnitTeam, AnimationStates> unit_animations {};
+    uint64_t assets_generation {};
+
+    uint64_t units_revision {}; // Changes whenever a unit moved, died or a save was loaded
+    // The tiles whose unit or visibility changed since the snapshot published before this one, at previous_units_revision.
+    // A skipped snapshot or units_reset means every tile has to be read again.
+    uint64_t previous_units_revision {};
+    std::vector<glm::uvec2> changed_tiles {};
+    bool units_reset = false;
+
+    std::string round_text {};
+};
+
+// A tile whose unit or visibility changed, at the units_revision it changed in
+struct UnitTileChange
+{
+    uint64_t revision {};
+    glm::uvec2 tile {};
+};
+
+// Game state owned by the simulation thread.
+// The main thread only touches it after WaitForSimulation, to reload assets.
+struct FrameSimulation
+{
+    GameState game_state {};
+    PersistentCamera camera {};
+    Cursor cursor {};
+    UndoHistory undo_history {};
+    std::optional<LockstepSession> session {};
+    UnitTweens unit_tweens {};
+    CombatEffects effects {};
+
+    std::string quicksave_path {};
+    std::future<bool> pending_save {};
+
+    // Animations advance here, the renderer copies them into its own tilesets
+    const GameAssets* assets {};
+    std::vector<AnimationStates> level_animations {};
+    std::unordered_map<UnitTeam, AnimationStates> unit_animations {};
+    uint64_t assets_generation {}; // Bumped on every reset, older snapshots no longer match the tilesets
+
+    uint64_t frame_index {};
+    uint64_t units_revision {};
+    uint64_t published_units_revision {};
+    std::vector<glm::uvec2> changed_tiles {}; // Since the last snapshot
+    bool units_reset = false; // A save was loaded since the last snapshot
+    // Every change after unit_log_revision, oldest first. A snapshot slot is reused three frames later,
+    // so it only takes the tiles logged since it was last written instead of the whole grid.
+    std::vector<UnitTileChange> unit_log {};
+    uint64_t unit_log_revision {};
+    uint32_t max_unit_log = 4096; // The older half is dropped past this, slots older than that copy everything
+    uint32_t round_text_turn = UINT32_MAX;
+    std::string round_text {};
+};
+
+// Takes the animation states of the level and unit tilesets, call again after they are reloaded
+void ResetSimulationAnimations(FrameSimulation& simulation, const GameAssets& assets);
+void StepFrameSimulation(FrameSimulation& simulation, SimulationInput input, RenderSnapshot& snapshot);
+// Copies the animation frames of the snapshot into the tilesets that are drawn, if they still match
+void ApplySnapshotAnimations(const RenderSnapshot& snapshot, const FrameSimulation& simulation, Level& level, GameAssets& assets);
+
+struct FramePipeline
+{
+    static constexpr uint32_t SLOT_MASK = 0x3;
+    static constexpr uint32_t FRESH_SNAPSHOT = 0x4; // The ready slot was published after the last acquire
+
+    FrameSimulation* simulation {};
+    bool threaded = true; // Otherwise every step runs inside SubmitSimulationInput
+
+    std::array<RenderSnapshot, 3> snapshots {};
+    uint32_t write_slot = 0; // Simulation thread only
+    uint32_t read_slot = 1; // Main thread only
+    std::atomic<uint32_t> ready_slot { 2 };
+    bool has_snapshot = false;
+
+    std::thread thread {};
+    std::mutex mutex {};
+    std::condition_variable wake {};
+    std::optional<SimulationInput> pending_input {};
+    bool stepping = false;
+    bool stop = false;
+};
+
+std::unique_ptr<FramePipeline> StartFramePipeline(FrameSimulation& simulation, bool threaded = true);
+// Waits for the previous step first, the simulation never runs more than a frame ahead
+void SubmitSimulationInput(FramePipeline& pipeline, const SimulationInput& input);
+// Blocks until no step is running
+void WaitForSimulation(FramePipeline& pipeline);
+// Latest published snapshot, null before the first step finished
+const RenderSnapshot* AcquireRenderSnapshot(FramePipeline& pipeline);
+void StopFramePipeline(FramePipeline& pipeline);
@@ -17,6 +17,15 @@ struct GameInput
         input.OnKeyPress(SDLK_D).connect([&](bool pressed)
             { movement.x += pressed ? 1.0f : -1.0f; });
 
+        input.OnKeyPress(SDLK_F5).connect([&](bool pressed)
+            { save_requested |= pressed; });
+        input.OnKeyPress(SDLK_F9).connect([&](bool pressed)
+            { load_requested |= pressed; });
+        input.OnKeyPress(SDLK_Z).connect([&](bool pressed)
+            { undo_requested |= pressed; });
+        input.OnKeyPress(SDLK_Y).connect([&](bool pressed)
+            { redo_requested |= pressed; });
+
         input.OnMouseMove().connect([&](const glm::vec2& pos)
             { mouse_pos = pos; });
         input.OnButtonClick(SDL_BUTTON_LEFT).connect([&](bool pressed)
@@ -36,4 +45,9 @@ struct GameInput
     glm::vec2 mouse_pos {};
     glm::vec2 movement {};
     float camera_zoom = 3.0f;
+
+    bool save_requested = false;
+    bool load_requested = false;
+    bool undo_requested = false;
+    bool redo_requested = false;
 };
\ No newline at end of file
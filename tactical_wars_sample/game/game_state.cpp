@@ -0,0 +1,27 @@
+#include <game/game_state.hpp>
+
+UnitTeam GetCurrentTeam(const GameState& game_state)
+{
+    return game_state.teams.at(game_state.turn_index % game_state.teams.size());
+}
+
+std::vector<glm::uvec2> AdvanceTurn(GameState& game_state)
+{
+    ++game_state.turn_index;
+
+    std::vector<glm::uvec2> reset_tiles {};
+    auto& units = game_state.unit_state.units;
+
+    for (auto it = units.begin(); it != units.end(); ++it)
+    {
+        auto& unit = *it;
+
+        if (unit.health > 0 && unit.state == UnitState::USED)
+        {
+            unit.state = UnitState::IDLE;
+            reset_tiles.emplace_back(it.getIndices().x, it.getIndices().y);
+        }
+    }
+
+    return reset_tiles;
+}
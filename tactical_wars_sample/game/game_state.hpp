@@ -0,0 +1,24 @@
+#pragma once
+
+#include <game/fog.hpp>
+#include <game/level.hpp>
+#include <game/unit.hpp>
+#include <memory>
+#include <random>
+#include <vector>
+
+struct GameState
+{
+    std::shared_ptr<Level> current_level; // Shared, headless matches reuse the same level
+    UnitMapState unit_state {};
+
+    std::vector<UnitTeam> teams {};
+    uint32_t turn_index = -1;
+
+    std::mt19937_64 rng {}; // Match randomness, kept in save games
+    std::shared_ptr<FogOfWar> fog {}; // Null when playing without fog of war
+};
+
+UnitTeam GetCurrentTeam(const GameState& game_state);
+// Returns the tiles of the used units that became idle again
+std::vector<glm::uvec2> AdvanceTurn(GameState& game_state);
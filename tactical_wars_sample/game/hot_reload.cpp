@@ -0,0 +1,157 @@
+#include <game/hot_reload.hpp>
+
+#include <algorithm>
+#include <filesystem>
+
+static bool IsSamePath(const std::string& lhs, const std::string& rhs)
+{
+    return std::filesystem::path(lhs).lexically_normal() == std::filesystem::path(rhs).lexically_normal();
+}
+
+AssetReloadResult ReloadChangedAssets(
+    Renderer& renderer,
+    ResourceCache& cache,
+    const std::vector<std::string>& changed_files,
+    GameState& game_state,
+    GameAssets& assets,
+    Minimap& minimap,
+    PathGraph* path_graph,
+    FlowFieldCache* flow_fields)
+{
+    AssetReloadResult reload_result {};
+    bool reload_level = false;
+    bool images_changed = false;
+    std::vector<UnitTeam> reload_teams {};
+
+    auto add_team = [&](UnitTeam team)
+    {
+        if (std::find(reload_teams.begin(), reload_teams.end(), team) == reload_teams.end())
+        {
+            reload_teams.emplace_back(team);
+        }
+    };
+
+    for (auto& file : changed_files)
+    {
+        auto extension = std::filesystem::path(file).extension();
+        bool is_team_tileset = false;
+
+        for (auto& [team, team_assets] : assets.team_assets)
+        {
+            if (IsSamePath(file, team_assets.tsx_path))
+            {
+                is_team_tileset = true;
+                add_team(team);
+            }
+        }
+
+        if (extension == ".png")
+        {
+            images_changed = true;
+            reload_level = true;
+        }
+        else if (extension == ".tsx" && !is_team_tileset)
+        {
+            reload_level = true;
+        }
+        else if (extension == ".tmx" && IsSamePath(file, game_state.current_level->map_path))
+        {
+            reload_level = true;
+        }
+    }
+
+    // Unit tilesets are small, any image change reloads them rather than tracking their sources
+    if (images_changed)
+    {
+        for (auto& [team, team_assets] : assets.team_assets)
+        {
+            add_team(team);
+        }
+    }
+
+    for (auto team : reload_teams)
+    {
+        auto& team_assets = assets.team_assets.at(team);
+
+        // A tileset that fails to parse keeps the current one until the next change
+        if (auto reloaded = LoadUnitTeamAssets(renderer, cache, team_assets.tsx_path, team_assets.draw_data.cpu_pixels != nullptr))
+        {
+            team_assets = std::move(reloaded.value());
+            reload_result.reloaded_teams.emplace_back(team);
+        }
+    }
+
+    if (!reload_level)
+    {
+        return reload_result;
+    }
+
+    auto& level = *game_state.current_level;
+    auto& result = reload_result.level;
+    result = ReloadLevel(renderer, cache, level);
+
+    if (!result.reloaded)
+    {
+        return reload_result;
+    }
+
+    game_state.unit_state.map_tile_size = { level.map.getMapTileSize().x, level.map.getMapTileSize().y };
+
+    if (result.grid_size_changed)
+    {
+        ResizeUnitMapState(game_state.unit_state, level);
+        minimap = CreateMinimap(minimap.sdl_renderer, level);
+        ResetMinimapUnits(minimap, game_state.unit_state);
+
+        if (game_state.fog)
+        {
+            *game_state.fog = CreateFogOfWar(level);
+            ResetFogUnits(*game_state.fog, game_state.unit_state);
+        }
+
+        // The new graph and fields start without blockers, the units are kept
+        if (path_graph)
+        {
+            *path_graph = BuildPathGraph(level, path_graph->cluster_size);
+            SyncPathGraphBlockers(*path_graph, game_state.unit_state);
+        }
+
+        if (flow_fields)
+        {
+            *flow_fields = CreateFlowFieldCache(level, flow_fields->max_fields);
+            SyncFlowFieldBlockers(*flow_fields, game_state.unit_state);
+        }
+
+        reload_result.units_recast = true;
+        return reload_result;
+    }
+
+    // Only the edited terrain is passed on, the graph clusters and flow fields are repaired lazily
+    if (game_state.fog)
+    {
+        reload_result.units_recast = UpdateFogTerrain(*game_state.fog, level, game_state.unit_state, result.changed_terrain);
+    }
+
+    for (auto tile : result.changed_terrain)
+    {
+        uint8_t move_cost = level.terrain.at(tile.x, tile.y).move_cost;
+
+        if (path_graph)
+            SetPathTileCost(*path_graph, tile, move_cost);
+
+        if (flow_fields)
+            SetFlowTileCost(*flow_fields, tile, move_cost);
+    }
+
+    // A rebuilt tileset can colour any tile, otherwise only the edited tiles are baked again
+    if (!result.rebuilt_tilesets.empty())
+    {
+        RebuildMinimapTerrain(minimap, level);
+    }
+    else
+    {
+        UpdateMinimapTerrain(minimap, level, result.changed_tiles);
+    }
+
+    return reload_result;
+}
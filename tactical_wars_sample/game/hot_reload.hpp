@@ -0,0 +1,26 @@
+#pragma once
+#include <game/cursor.hpp>
+#include <game/flow_field.hpp>
+#include <game/minimap.hpp>
+
+// Applies the files reported by an AssetWatcher to the running game.
+// Only what changed is rebuilt; camera, units and turn state are kept.
+// Terrain edits are passed on to the fog and to the path graph and flow fields when given.
+struct AssetReloadResult
+{
+    LevelReloadResult level {}; // level.reloaded is false when the map was untouched or failed to load
+    std::vector<UnitTeam> reloaded_teams {};
+    bool units_recast = false; // The fog or the unit map was rebuilt, every tile has to be read again
+};
+
+// Reports what was reloaded, so callers only redo the state that depends on it.
+// A grid size change in result.level invalidates any tile selection.
+AssetReloadResult ReloadChangedAssets(
+    Renderer& renderer,
+    ResourceCache& cache,
+    const std::vector<std::string>& changed_files,
+    GameState& game_state,
+    GameAssets& assets,
+    Minimap& minimap,
+    PathGraph* path_graph = nullptr,
+    FlowFieldCache* flow_fields = nullptr);
@@ -1,66 +1,373 @@
 #include <game/level.hpp>
 
-Level LoadLevel(Renderer& renderer, const std::string& map_path)
+#include <algorithm>
+
+static_assert(sizeof(TerrainProperties) == 4);
+
+static TerrainProperties ReadTerrainProperties(const tpp::TileSet& set, uint32_t id)
+{
+    TerrainProperties terrain {};
+
+    if (auto* props = set.getTileProperties(id))
+    {
+        terrain.move_cost = (uint8_t)std::clamp(props->get<int>("MoveCost").value_or(1), 1, 255);
+        terrain.defence = (uint8_t)std::clamp(props->get<int>("Defence").value_or(0), 0, 100);
+        terrain.blocks_sight = props->get<bool>("BlocksSight").value_or(false);
+
+        if (props->get<bool>("Obstacle").value_or(false))
+        {
+            terrain.move_cost = 0;
+        }
+    }
+
+    return terrain;
+}
+
+// Properties are parsed once per tile id, never per cell
+static void BuildTerrainTable(const tpp::TileMap& map, std::vector<TerrainProperties>& table, std::vector<uint32_t>& offsets)
+{
+    table.assign(1, TerrainProperties {});
+    offsets.clear();
+
+    for (auto& set : map.getTileSets())
+    {
+        offsets.emplace_back(table.size());
+
+        for (uint32_t id = 0; id < set.getTileCount(); ++id)
+        {
+            table.emplace_back(ReadTerrainProperties(set, id));
+        }
+    }
+}
+
+static uint32_t GetTerrainIndex(const std::vector<uint32_t>& offsets, tpp::TileID tile)
+{
+    return tile.isValid() ? offsets[tile.getTileset()] + tile.getId() : 0;
+}
+
+// A single pass over the tile ids, each cell is one load from the table
+static void GatherTerrain(const std::vector<TerrainProperties>& table, const std::vector<uint32_t>& offsets, const tpp::TileLayer& layer, tpp::Array2D<TerrainProperties>& terrain)
+{
+    auto out = terrain.begin();
+
+    for (auto tile_id : layer.tile_ids)
+    {
+        *out = table[GetTerrainIndex(offsets, tile_id)];
+        ++out;
+    }
+}
+
+static bool IsSameTile(tpp::TileID lhs, tpp::TileID rhs)
+{
+    if (!lhs.isValid() || !rhs.isValid())
+    {
+        return lhs.isValid() == rhs.isValid();
+    }
+
+    return lhs.getTileset() == rhs.getTileset() && lhs.getId() == rhs.getId();
+}
+
+static uint32_t CalculateVisibleLayers(const Level& level, const glm::uvec2& tile_pos)
+{
+    auto& layers = level.map.getTileLayers();
+    uint32_t mask = 0;
+
+    // Top to bottom, stopping at the first tile that covers the whole cell
+    for (size_t l = std::min<size_t>(layers.size(), MAX_MASKED_LAYERS); l-- > 0;)
+    {
+        auto tile_id = layers.at(l).tile_ids.at(tile_pos.x, tile_pos.y);
+
+        if (!tile_id.isValid())
+            continue;
+
+        auto alpha = GetTileAlpha(level.map.getTileSets().at(tile_id.getTileset()), level.tile_set_data.at(tile_id.getTileset()), tile_id.getId());
+
+        if (alpha == TileAlpha::FULLY_TRANSPARENT)
+            continue;
+
+        mask |= 1u << l;
+
+        if (alpha == TileAlpha::FULLY_OPAQUE)
+            break;
+    }
+
+    return mask;
+}
+
+static uint64_t HashLevelContent(const tpp::TileMap& map)
+{
+    // FNV-1a over whole values, the tile layers are large
+    uint64_t hash = 14695981039346656037ull;
+
+    auto add = [&](uint64_t value)
+    {
+        hash = (hash ^ value) * 1099511628211ull;
+    };
+
+    add(map.getMapGridSize().x);
+    add(map.getMapGridSize().y);
+
+    for (auto& layer : map.getTileLayers())
+    {
+        for (auto tile_id : layer.tile_ids)
+        {
+            add(tile_id.isValid() ? (uint64_t(tile_id.getTileset()) << 32 | tile_id.getId()) : UINT64_MAX);
+        }
+    }
+
+    return hash;
+}
+
+Level LoadLevelData(const std::string& map_path)
 {
     Level level {};
+    level.map_path = map_path;
     level.map = tpp::TileMap::fromTMX(map_path).value();
+    level.content_hash = HashLevelContent(level.map);
+
+    auto map_size = level.map.getMapGridSize();
+    level.terrain = tpp::Array2D<TerrainProperties>(map_size.x, map_size.y, TerrainProperties {});
+
+    auto* layer = level.map.findTileLayer("Terrain");
+    assert(layer);
+
+    BuildTerrainTable(level.map, level.terrain_table, level.terrain_table_offsets);
+    GatherTerrain(level.terrain_table, level.terrain_table_offsets, *layer, level.terrain);
+
+    return level;
+}
+
+Level LoadLevel(Renderer& renderer, ResourceCache& cache, const std::string& map_path, bool keep_cpu_pixels)
+{
+    return FinishLevelLoad(renderer, cache, LoadLevelData(map_path), keep_cpu_pixels);
+}
+
+std::future<Level> PreloadLevelData(const std::string& map_path)
+{
+    return std::async(std::launch::async, [map_path]()
+        { return LoadLevelData(map_path); });
+}
+
+Level FinishLevelLoad(Renderer& renderer, ResourceCache& cache, Level level, bool keep_cpu_pixels)
+{
+    level.keep_cpu_pixels = keep_cpu_pixels;
 
     for (auto& tileset : level.map.getTileSets())
     {
-        level.tile_set_data.emplace_back(CreateTileSetDrawData(renderer, tileset));
+        level.tile_set_data.emplace_back(CreateTileSetDrawData(renderer, cache, tileset, keep_cpu_pixels));
     }
 
+    BuildTileVisibility(level);
+
+    return level;
+}
+
+void BuildTileVisibility(Level& level)
+{
     auto map_size = level.map.getMapGridSize();
-    level.tile_travel_costs = tpp::Array2D<uint8_t>(map_size.x, map_size.y, 0);
+    level.visible_layers = tpp::Array2D<uint32_t>(map_size.x, map_size.y, 0);
 
-    auto* layer = level.map.findTileLayer("Terrain");
-    assert(layer);
+    for (auto it = level.visible_layers.begin(); it != level.visible_layers.end(); ++it)
+    {
+        *it = CalculateVisibleLayers(level, { it.getIndices().x, it.getIndices().y });
+    }
+}
+
+void UpdateTileVisibility(Level& level, const std::vector<glm::uvec2>& changed_tiles)
+{
+    for (auto tile : changed_tiles)
+    {
+        level.visible_layers.at(tile.x, tile.y) = CalculateVisibleLayers(level, tile);
+    }
+}
+
+LevelReloadResult ReloadLevel(Renderer& renderer, ResourceCache& cache, Level& level)
+{
+    LevelReloadResult result {};
+    auto new_map_result = tpp::TileMap::fromTMX(level.map_path);
+
+    if (!new_map_result)
+    {
+        // Tiled can still be writing the file, keep the current map until the next change
+        return result;
+    }
+
+    auto new_map = std::move(new_map_result.value());
+    auto& old_tilesets = level.map.getTileSets();
+    auto& new_tilesets = new_map.getTileSets();
+
+    // Reuse the spritesheet textures of tilesets whose image did not change
+    std::vector<TileSetDrawData> new_set_data {};
+    bool animations_changed = false;
+
+    // Terrain properties live in the tilesets, so they can change without a layer change
+    std::vector<TerrainProperties> new_terrain_table {};
+    std::vector<uint32_t> new_terrain_offsets {};
+    BuildTerrainTable(new_map, new_terrain_table, new_terrain_offsets);
+
+    bool terrain_table_changed = new_terrain_table != level.terrain_table || new_terrain_offsets != level.terrain_table_offsets;
+
+    for (uint32_t i = 0; i < new_tilesets.size(); ++i)
+    {
+        auto& tileset = new_tilesets.at(i);
+
+        bool reusable = i < old_tilesets.size()
+            && old_tilesets.at(i).getTileCount() == tileset.getTileCount()
+            && level.tile_set_data.at(i).image_hash == HashTileSetImage(tileset);
+
+        if (!reusable)
+        {
+            new_set_data.emplace_back(CreateTileSetDrawData(renderer, cache, tileset, level.keep_cpu_pixels));
+            result.rebuilt_tilesets.emplace_back(i);
+            continue;
+        }
+
+        tileset.getImage().freeData();
+        auto& draw_data = new_set_data.emplace_back(std::move(level.tile_set_data.at(i)));
+
+        if (!HasSameAnimations(old_tilesets.at(i), tileset))
+        {
+            ResetAnimationStates(tileset, draw_data);
+            animations_changed = true;
+        }
+    }
+
+    // Dropped tilesets leave fewer animation tables behind
+    if (new_tilesets.size() < old_tilesets.size())
+    {
+        animations_changed = true;
+    }
+
+    auto old_size = level.map.getMapGridSize();
+    auto new_size = new_map.getMapGridSize();
+    auto& old_layers = level.map.getTileLayers();
+    auto& new_layers = new_map.getTileLayers();
+
+    auto* new_terrain = new_map.findTileLayer("Terrain");
+    assert(new_terrain);
 
-    for (auto it = layer->tile_ids.begin(); it != layer->tile_ids.end(); ++it)
+    result.grid_size_changed = old_size.x != new_size.x || old_size.y != new_size.y || old_layers.size() != new_layers.size();
+
+    auto update_terrain = [&](const glm::uvec2& pos)
+    {
+        auto terrain = new_terrain_table[GetTerrainIndex(new_terrain_offsets, new_terrain->tile_ids.at(pos.x, pos.y))];
+        auto& current = level.terrain.at(pos.x, pos.y);
+
+        if (current != terrain)
+        {
+            current = terrain;
+            result.changed_terrain.emplace_back(pos);
+        }
+    };
+
+    if (result.grid_size_changed)
+    {
+        level.terrain = tpp::Array2D<TerrainProperties>(new_size.x, new_size.y, TerrainProperties {});
+        GatherTerrain(new_terrain_table, new_terrain_offsets, *new_terrain, level.terrain);
+    }
+    else
     {
-        auto& tile = *it;
-        auto& set = level.map.getTileSets().at(tile.getTileset());
+        // Same layout: only cells that differ in some layer are touched
+        std::vector<uint8_t> changed(new_size.x * new_size.y, 0);
+
+        for (size_t l = 0; l < new_layers.size(); ++l)
+        {
+            auto& old_ids = old_layers.at(l).tile_ids;
+            auto& new_ids = new_layers.at(l).tile_ids;
 
-        if (auto* props = set.getTileProperties(tile.getId()))
+            for (auto it = new_ids.begin(); it != new_ids.end(); ++it)
+            {
+                auto pos = it.getIndices();
+
+                if (!IsSameTile(*it, old_ids.at(pos)))
+                {
+                    changed.at(pos.y * new_size.x + pos.x) = 1;
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < changed.size(); ++i)
         {
-            if (auto travel_cost = props->get<bool>("Obstacle"))
+            if (changed.at(i) == 0)
             {
-                level.tile_travel_costs.at(it.getIndices()) = travel_cost.value() ? 1 : 0;
+                continue;
+            }
+
+            glm::uvec2 pos = { i % new_size.x, i / new_size.x };
+            result.changed_tiles.emplace_back(pos);
+            update_terrain(pos);
+        }
+
+        if (terrain_table_changed)
+        {
+            for (uint32_t y = 0; y < new_size.y; ++y)
+            {
+                for (uint32_t x = 0; x < new_size.x; ++x)
+                {
+                    update_terrain({ x, y });
+                }
             }
         }
     }
 
-    return level;
+    level.map = std::move(new_map);
+    level.tile_set_data = std::move(new_set_data);
+    level.terrain_table = std::move(new_terrain_table);
+    level.terrain_table_offsets = std::move(new_terrain_offsets);
+    level.content_hash = HashLevelContent(level.map);
+
+    // Tile alpha classes only change with the tilesets, otherwise only the edited cells are touched
+    if (result.grid_size_changed || !result.rebuilt_tilesets.empty() || animations_changed)
+    {
+        BuildTileVisibility(level);
+    }
+    else
+    {
+        UpdateTileVisibility(level, result.changed_tiles);
+    }
+
+    result.animations_changed = animations_changed || !result.rebuilt_tilesets.empty();
+    result.reloaded = true;
+    return result;
 }
 
-void DrawLevel(Renderer& renderer, Level& level, const FrameCamera& camera, DeltaMS delta)
+void UpdateLevelAnimations(Level& level, DeltaMS delta)
 {
     for (uint32_t i = 0; i < level.tile_set_data.size(); i++)
     {
         UpdateAnimationData(level.map.getTileSets().at(i), level.tile_set_data.at(i), delta);
     }
+}
+
+void DrawLevel(Renderer& renderer, Level& level, const FrameCamera& camera, DeltaMS delta)
+{
+    UpdateLevelAnimations(level, delta);
+
+    auto& layers = level.map.getTileLayers();
 
-    for (auto& layer : level.map.getTileLayers())
+    for (uint32_t l = 0; l < layers.size(); ++l)
     {
+        auto& layer = layers.at(l);
         auto map_tile_size = level.map.getMapTileSize();
 
         for (auto it = layer.tile_ids.begin(); it != layer.tile_ids.end(); ++it)
         {
-            auto tile_id = *it;
+            auto coords = it.getIndices();
 
-            if (!tile_id.isValid())
+            // Also rejects empty cells
+            if (!IsLayerDrawn(level, l, coords.x, coords.y))
             {
                 continue;
             }
 
-            auto coords = it.getIndices();
+            auto tile_id = *it;
 
             auto src_rect = GetTileRect(
                 level.map.getTileSets().at(tile_id.getTileset()),
                 level.tile_set_data.at(tile_id.getTileset()),
                 tile_id.getId());
 
-            auto& texture = level.tile_set_data.at(tile_id.getTileset()).spritesheet_texture;
+            auto& texture = *level.tile_set_data.at(tile_id.getTileset()).spritesheet_texture;
 
             SDL_FRect dst_rect {
                 (float)(coords.x * map_tile_size.x),
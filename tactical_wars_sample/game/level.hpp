@@ -1,13 +1,63 @@
 #pragma once
+#include <future>
 #include <game/tileset_data.hpp>
 #include <math/camera.hpp>
 
+// Terrain rules of one tile id, read once per tileset from the TSX properties
+struct TerrainProperties
+{
+    uint8_t move_cost = 1; // "MoveCost", 0 when the tile is an "Obstacle"
+    uint8_t defence = 0; // "Defence", percent of incoming damage ignored
+    uint8_t blocks_sight = 0; // "BlocksSight"
+    uint8_t padding = 0;
+
+    bool operator==(const TerrainProperties&) const = default;
+};
+
+// Layers past this are always drawn when not empty, and never hide the layers under them
+constexpr uint32_t MAX_MASKED_LAYERS = 32;
+
 struct Level
 {
+    std::string map_path {};
     tpp::TileMap map {};
     std::vector<TileSetDrawData> tile_set_data {};
-    tpp::Array2D<uint8_t> tile_travel_costs {};
+    std::vector<TerrainProperties> terrain_table {}; // Every tile id of every tileset, entry 0 is for empty cells
+    std::vector<uint32_t> terrain_table_offsets {}; // First table entry of each tileset
+    tpp::Array2D<TerrainProperties> terrain {}; // Properties of each "Terrain" layer cell
+    tpp::Array2D<uint32_t> visible_layers {}; // Bit per tile layer that is drawn in each cell, see IsLayerDrawn
+    uint64_t content_hash {}; // Grid and tile layers, identifies the level in save games
+    bool keep_cpu_pixels = false; // Also applies to tilesets rebuilt on reload
 };
 
-Level LoadLevel(Renderer& renderer, const std::string& map_path);
-void DrawLevel(Renderer& renderer, Level& level, const FrameCamera& camera, DeltaMS delta);
\ No newline at end of file
+struct LevelReloadResult
+{
+    bool reloaded = false;
+    bool grid_size_changed = false;
+    bool animations_changed = false; // Tileset animations were rebuilt or reset, their states start over
+    std::vector<uint32_t> rebuilt_tilesets {};
+    std::vector<glm::uvec2> changed_tiles {}; // Cells that differ in any tile layer
+    std::vector<glm::uvec2> changed_terrain {};
+};
+
+Level LoadLevel(Renderer& renderer, ResourceCache& cache, const std::string& map_path, bool keep_cpu_pixels = false);
+Level LoadLevelData(const std::string& map_path); // Map and terrain only, no textures
+// Parses the next map on a worker thread. Textures still have to be created on the render thread
+// with FinishLevelLoad, which reuses any spritesheet the cache already holds.
+std::future<Level> PreloadLevelData(const std::string& map_path);
+Level FinishLevelLoad(Renderer& renderer, ResourceCache& cache, Level level, bool keep_cpu_pixels = false);
+// Layers hidden under a fully opaque tile or holding a fully transparent tile are masked out
+void BuildTileVisibility(Level& level);
+void UpdateTileVisibility(Level& level, const std::vector<glm::uvec2>& changed_tiles);
+
+// False for empty cells and the cells the visibility mask culls
+inline bool IsLayerDrawn(const Level& level, uint32_t layer, uint32_t x, uint32_t y)
+{
+    if (layer >= MAX_MASKED_LAYERS)
+        return level.map.getTileLayers().at(layer).tile_ids.at(x, y).isValid();
+
+    return (level.visible_layers.at(x, y) & (1u << layer)) != 0;
+}
+LevelReloadResult ReloadLevel(Renderer& renderer, ResourceCache& cache, Level& level);
+void UpdateLevelAnimations(Level& level, DeltaMS delta);
+void DrawLevel(Renderer& renderer, Level& level, const FrameCamera& camera, DeltaMS delta);
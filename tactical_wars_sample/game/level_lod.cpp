@@ -0,0 +1,567 @@
+#include <game/level_lod.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+// Texels are premultiplied, so averaging does not bleed the colour of transparent pixels
+
+static bool HasCpuPixels(const Level& level)
+{
+    for (auto& draw_data : level.tile_set_data)
+    {
+        if (!draw_data.cpu_pixels)
+            return false;
+    }
+
+    return true;
+}
+
+struct LodLayerSource
+{
+    const TileSetDrawData* draw_data {};
+    glm::uvec2 start {};
+    glm::uvec2 size {};
+};
+
+static glm::vec4 LoadPremultiplied(const uint8_t* pixel)
+{
+    float alpha = pixel[3] * (1.0f / 255.0f);
+
+    return { pixel[0] * alpha, pixel[1] * alpha, pixel[2] * alpha, pixel[3] };
+}
+
+size_t LevelLodStackHash::operator()(const LevelLodStack& stack) const
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    for (auto layer : stack)
+    {
+        hash = (hash ^ layer) * 1099511628211ull;
+    }
+
+    return size_t(hash);
+}
+
+static void GatherCellStack(const Level& level, uint32_t x, uint32_t y, LevelLodStack& stack)
+{
+    auto& layers = level.map.getTileLayers();
+    stack.clear();
+
+    for (uint32_t l = 0; l < layers.size(); ++l)
+    {
+        // Also rejects empty cells
+        if (!IsLayerDrawn(level, l, x, y))
+            continue;
+
+        auto tile_id = layers.at(l).tile_ids.at(x, y);
+        auto& tileset = level.map.getTileSets().at(tile_id.getTileset());
+        uint32_t frame_id = GetAnimatedTileId(tileset, level.tile_set_data.at(tile_id.getTileset()), tile_id.getId());
+
+        stack.emplace_back(uint64_t(tile_id.getTileset()) << 32 | frame_id);
+    }
+}
+
+static void GetStackSources(const Level& level, const LevelLodStack& stack, std::vector<LodLayerSource>& sources)
+{
+    sources.clear();
+
+    for (auto layer : stack)
+    {
+        uint32_t tileset_index = uint32_t(layer >> 32);
+        auto rect = level.map.getTileSets().at(tileset_index).getTileRect(uint32_t(layer)).value();
+
+        sources.emplace_back(LodLayerSource { &level.tile_set_data.at(tileset_index), { rect.start.x, rect.start.y }, { rect.size.x, rect.size.y } });
+    }
+}
+
+// Every layer of a cell pixel flattened at full resolution, tileset tiles are stretched to the map tile size like DrawLevel does
+static glm::vec4 FlattenPixel(const std::vector<LodLayerSource>& sources, const glm::uvec2& pixel, const glm::uvec2& tile_size)
+{
+    glm::vec4 colour { 0.0f };
+
+    for (auto& source : sources)
+    {
+        auto offset = source.start + pixel * source.size / tile_size;
+        auto src = LoadPremultiplied(source.draw_data->cpu_pixels->data() + (size_t(offset.y) * source.draw_data->image_size.x + offset.x) * 4);
+
+        colour = src + colour * (1.0f - src.w * (1.0f / 255.0f));
+    }
+
+    return colour;
+}
+
+static glm::vec4 SumStack(const Level& level, const LevelLodStack& stack, const glm::uvec2& tile_size)
+{
+    std::vector<LodLayerSource> sources {};
+    GetStackSources(level, stack, sources);
+
+    glm::vec4 sum { 0.0f };
+
+    for (uint32_t py = 0; py < tile_size.y; ++py)
+    {
+        for (uint32_t px = 0; px < tile_size.x; ++px)
+        {
+            sum += FlattenPixel(sources, { px, py }, tile_size);
+        }
+    }
+
+    return sum;
+}
+
+static std::vector<glm::vec4> SumStackPrefixes(const Level& level, const LevelLodStack& stack, const glm::uvec2& tile_size)
+{
+    std::vector<LodLayerSource> sources {};
+    GetStackSources(level, stack, sources);
+
+    uint32_t pitch = tile_size.x + 1;
+    std::vector<glm::vec4> sums(size_t(pitch) * (tile_size.y + 1), glm::vec4(0.0f));
+
+    for (uint32_t py = 0; py < tile_size.y; ++py)
+    {
+        glm::vec4 row_sum { 0.0f };
+
+        for (uint32_t px = 0; px < tile_size.x; ++px)
+        {
+            row_sum += FlattenPixel(sources, { px, py }, tile_size);
+            sums[(py + 1) * pitch + px + 1] = sums[py * pitch + px + 1] + row_sum;
+        }
+    }
+
+    return sums;
+}
+
+// Keeps the prefix sums bounded, so the returned sums are only valid until the next call
+static const std::vector<glm::vec4>& GetPrefixSums(LevelLod& lod, const Level& level, const LevelLodStack& stack, LevelLodStackSums& sums, const glm::uvec2& tile_size)
+{
+    if (sums.prefix_sums.empty())
+    {
+        if (lod.prefix_sum_stacks >= lod.max_prefix_sum_stacks)
+        {
+            for (auto& [other_stack, other_sums] : lod.stack_sums)
+            {
+                other_sums.prefix_sums = {};
+            }
+
+            lod.prefix_sum_stacks = 0;
+        }
+
+        sums.prefix_sums = SumStackPrefixes(level, stack, tile_size);
+        sums.sum = sums.prefix_sums.back();
+        lod.prefix_sum_stacks++;
+    }
+
+    return sums.prefix_sums;
+}
+
+// Box average of the map pixels under each texel of [origin, origin + size) on a level, rounded once.
+// Cells a texel covers whole add their stack sum, the cells its edges cut through add prefix sums.
+static void BakeLevelTexels(LevelLod& lod, const Level& level, uint32_t scale, const glm::uvec2& origin, const glm::uvec2& size, std::vector<glm::u8vec4>& texels)
+{
+    using StackEntry = std::pair<const LevelLodStack, LevelLodStackSums>;
+
+    auto tile_size = glm::uvec2 { level.map.getMapTileSize().x, level.map.getMapTileSize().y };
+
+    auto pixel_start = origin * scale;
+    auto pixel_end = glm::min((origin + size) * scale, lod.map_size);
+    auto cell_start = pixel_start / tile_size;
+    auto cell_count = (pixel_end + tile_size - 1u) / tile_size - cell_start;
+
+    // Texels made of whole cells only need the stack sums
+    bool whole_cells = scale % tile_size.x == 0 && scale % tile_size.y == 0;
+    uint32_t pitch = tile_size.x + 1;
+
+    // Null for cells without a drawn layer
+    std::vector<StackEntry*> cells(size_t(cell_count.x) * cell_count.y);
+    LevelLodStack stack {};
+
+    for (uint32_t y = 0; y < cell_count.y; ++y)
+    {
+        for (uint32_t x = 0; x < cell_count.x; ++x)
+        {
+            GatherCellStack(level, cell_start.x + x, cell_start.y + y, stack);
+
+            if (stack.empty())
+                continue;
+
+            auto [it, inserted] = lod.stack_sums.try_emplace(stack);
+
+            if (inserted && whole_cells)
+            {
+                it->second.sum = SumStack(level, stack, tile_size);
+            }
+            else if (inserted)
+            {
+                GetPrefixSums(lod, level, it->first, it->second, tile_size);
+            }
+
+            cells[y * cell_count.x + x] = &*it;
+        }
+    }
+
+    texels.resize(size_t(size.x) * size.y);
+
+    for (uint32_t ty = 0; ty < size.y; ++ty)
+    {
+        for (uint32_t tx = 0; tx < size.x; ++tx)
+        {
+            // Texels on the right and bottom edges are cropped to the map
+            auto start = (origin + glm::uvec2(tx, ty)) * scale;
+            auto end = glm::min(start + scale, lod.map_size);
+            glm::vec4 sum { 0.0f };
+
+            for (uint32_t cy = start.y / tile_size.y; cy * tile_size.y < end.y; ++cy)
+            {
+                uint32_t y0 = std::max(start.y, cy * tile_size.y) - cy * tile_size.y;
+                uint32_t y1 = std::min(end.y, (cy + 1) * tile_size.y) - cy * tile_size.y;
+
+                for (uint32_t cx = start.x / tile_size.x; cx * tile_size.x < end.x; ++cx)
+                {
+                    auto* cell = cells[(cy - cell_start.y) * cell_count.x + cx - cell_start.x];
+
+                    if (!cell)
+                        continue;
+
+                    uint32_t x0 = std::max(start.x, cx * tile_size.x) - cx * tile_size.x;
+                    uint32_t x1 = std::min(end.x, (cx + 1) * tile_size.x) - cx * tile_size.x;
+
+                    if (x0 == 0 && y0 == 0 && x1 == tile_size.x && y1 == tile_size.y)
+                    {
+                        sum += cell->second.sum;
+                        continue;
+                    }
+
+                    auto& sums = GetPrefixSums(lod, level, cell->first, cell->second, tile_size);
+                    sum += sums[y1 * pitch + x1] - sums[y0 * pitch + x1] - sums[y1 * pitch + x0] + sums[y0 * pitch + x0];
+                }
+            }
+
+            auto area = float((end.x - start.x) * (end.y - start.y));
+            texels[ty * size.x + tx] = glm::u8vec4(glm::clamp(sum / area, 0.0f, 255.0f) + 0.5f);
+        }
+    }
+}
+
+static bool IsCellAnimated(const Level& level, uint32_t x, uint32_t y)
+{
+    auto& layers = level.map.getTileLayers();
+
+    for (uint32_t l = 0; l < layers.size(); ++l)
+    {
+        if (!IsLayerDrawn(level, l, x, y))
+            continue;
+
+        auto tile_id = layers.at(l).tile_ids.at(x, y);
+
+        if (level.tile_set_data.at(tile_id.getTileset()).animation_states.contains(tile_id.getId()))
+            return true;
+    }
+
+    return false;
+}
+
+static bool IsCellBefore(const glm::uvec2& lhs, const glm::uvec2& rhs)
+{
+    return lhs.y != rhs.y ? lhs.y < rhs.y : lhs.x < rhs.x;
+}
+
+// Called for chunks without a texture
+static void BakeLevelLodChunk(Renderer& renderer, LevelLod& lod, const Level& level, LevelLodLevel& lod_level, const glm::uvec2& chunk)
+{
+    auto origin = chunk * lod.chunk_texels;
+    auto chunk_size = glm::min(glm::uvec2(lod.chunk_texels), lod_level.size - origin);
+
+    std::vector<glm::u8vec4> pixels {};
+    BakeLevelTexels(lod, level, lod_level.scale, origin, chunk_size, pixels);
+
+    // Textures take straight alpha
+    for (auto& pixel : pixels)
+    {
+        auto straight = pixel.w > 0 ? glm::min(glm::vec4(pixel) * 255.0f / float(pixel.w) + 0.5f, glm::vec4(255.0f)) : glm::vec4(0.0f);
+        pixel = glm::u8vec4(straight.x, straight.y, straight.z, pixel.w);
+    }
+
+    auto& lod_chunk = lod_level.chunks.at(chunk.y * lod_level.chunk_grid_size.x + chunk.x);
+    lod_chunk.texture = Texture::FromData(renderer, reinterpret_cast<const uint8_t*>(pixels.data()), chunk_size);
+
+    if (lod_chunk.texture)
+    {
+        lod.resident_chunks++;
+    }
+}
+
+static void DropLevelLodChunk(LevelLod& lod, LevelLodChunk& chunk)
+{
+    if (chunk.texture)
+    {
+        chunk.texture.reset();
+        lod.resident_chunks--;
+    }
+}
+
+// Drops the least recently drawn chunks over max_resident_chunks, never the ones in view this frame
+static void DropOldLevelLodChunks(LevelLod& lod)
+{
+    if (lod.resident_chunks <= lod.max_resident_chunks)
+        return;
+
+    std::vector<LevelLodChunk*> candidates {};
+
+    for (auto& lod_level : lod.levels)
+    {
+        for (auto& chunk : lod_level.chunks)
+        {
+            if (chunk.texture && chunk.last_drawn != lod.frame_index)
+                candidates.emplace_back(&chunk);
+        }
+    }
+
+    size_t count = std::min<size_t>(lod.resident_chunks - lod.max_resident_chunks, candidates.size());
+
+    std::nth_element(candidates.begin(), candidates.begin() + count, candidates.end(), [](const LevelLodChunk* lhs, const LevelLodChunk* rhs)
+        { return lhs->last_drawn < rhs->last_drawn; });
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        DropLevelLodChunk(lod, *candidates.at(i));
+    }
+}
+
+std::vector<LevelLodImage> BakeLevelLodImages(const Level& level, uint32_t chunk_texels, uint32_t max_levels)
+{
+    std::vector<LevelLodImage> images {};
+    auto lod = CreateLevelLod(level, chunk_texels, max_levels);
+
+    for (auto& lod_level : lod.levels)
+    {
+        auto& image = images.emplace_back(LevelLodImage { lod_level.scale, lod_level.size });
+        BakeLevelTexels(lod, level, lod_level.scale, glm::uvec2(0), lod_level.size, image.texels);
+    }
+
+    return images;
+}
+
+LevelLod CreateLevelLod(const Level& level, uint32_t chunk_texels, uint32_t max_levels)
+{
+    LevelLod lod {};
+    lod.chunk_texels = std::max(chunk_texels, 1u);
+
+    auto tile_size = glm::uvec2 { level.map.getMapTileSize().x, level.map.getMapTileSize().y };
+    auto grid_size = glm::uvec2 { level.map.getMapGridSize().x, level.map.getMapGridSize().y };
+    lod.map_size = grid_size * tile_size;
+
+    if (!HasCpuPixels(level))
+    {
+        return lod;
+    }
+
+    for (uint32_t y = 0; y < grid_size.y; ++y)
+    {
+        for (uint32_t x = 0; x < grid_size.x; ++x)
+        {
+            if (IsCellAnimated(level, x, y))
+                lod.animated_cells.emplace_back(x, y);
+        }
+    }
+
+    glm::uvec2 size = (lod.map_size + glm::uvec2(1)) / 2u;
+
+    // Stops once a whole level fits in one chunk, coarser levels would not draw fewer quads
+    for (uint32_t scale = 2; lod.levels.size() < max_levels; scale *= 2)
+    {
+        auto& lod_level = lod.levels.emplace_back();
+        lod_level.scale = scale;
+        lod_level.size = size;
+        lod_level.chunk_grid_size = (size + glm::uvec2(lod.chunk_texels - 1)) / lod.chunk_texels;
+        lod_level.chunks.resize(lod_level.chunk_grid_size.x * lod_level.chunk_grid_size.y);
+
+        if (size.x <= lod.chunk_texels && size.y <= lod.chunk_texels)
+        {
+            break;
+        }
+
+        size = (size + glm::uvec2(1)) / 2u;
+    }
+
+    return lod;
+}
+
+void UpdateLevelLod(LevelLod& lod, const Level& level, const std::vector<glm::uvec2>& changed_tiles)
+{
+    if (lod.levels.empty() || changed_tiles.empty())
+    {
+        return;
+    }
+
+    auto tile_size = glm::uvec2 { level.map.getMapTileSize().x, level.map.getMapTileSize().y };
+
+    for (auto& lod_level : lod.levels)
+    {
+        uint32_t chunk_pixels = lod.chunk_texels * lod_level.scale;
+
+        for (auto tile : changed_tiles)
+        {
+            auto chunk_start = tile * tile_size / chunk_pixels;
+            auto chunk_end = ((tile + 1u) * tile_size - 1u) / chunk_pixels;
+
+            for (uint32_t cy = chunk_start.y; cy <= chunk_end.y; ++cy)
+            {
+                for (uint32_t cx = chunk_start.x; cx <= chunk_end.x; ++cx)
+                {
+                    DropLevelLodChunk(lod, lod_level.chunks.at(cy * lod_level.chunk_grid_size.x + cx));
+                }
+            }
+        }
+    }
+
+    auto sorted_tiles = changed_tiles;
+    std::sort(sorted_tiles.begin(), sorted_tiles.end(), IsCellBefore);
+    sorted_tiles.erase(std::unique(sorted_tiles.begin(), sorted_tiles.end()), sorted_tiles.end());
+
+    std::erase_if(lod.animated_cells, [&](const glm::uvec2& cell)
+        { return std::binary_search(sorted_tiles.begin(), sorted_tiles.end(), cell, IsCellBefore); });
+
+    for (auto tile : sorted_tiles)
+    {
+        if (IsCellAnimated(level, tile.x, tile.y))
+            lod.animated_cells.emplace_back(tile);
+    }
+
+    std::sort(lod.animated_cells.begin(), lod.animated_cells.end(), IsCellBefore);
+}
+
+static void DrawAnimatedCells(Renderer& renderer, const LevelLod& lod, const Level& level, const FrameCamera& camera, const glm::uvec2& visible_start, const glm::uvec2& visible_end)
+{
+    auto map_tile_size = level.map.getMapTileSize();
+    auto& layers = level.map.getTileLayers();
+
+    auto first = std::lower_bound(lod.animated_cells.begin(), lod.animated_cells.end(), visible_start.y, [](const glm::uvec2& cell, uint32_t row)
+        { return cell.y < row; });
+
+    for (auto it = first; it != lod.animated_cells.end() && it->y < visible_end.y; ++it)
+    {
+        auto cell = *it;
+
+        if (cell.x < visible_start.x || cell.x >= visible_end.x)
+        {
+            continue;
+        }
+
+        SDL_FRect dst_rect {
+            (float)(cell.x * map_tile_size.x),
+            (float)(cell.y * map_tile_size.y),
+            (float)(map_tile_size.x),
+            (float)(map_tile_size.y),
+        };
+
+        // The whole stack is drawn again, so the layers above the animated tile stay on top
+        for (uint32_t l = 0; l < layers.size(); ++l)
+        {
+            if (!IsLayerDrawn(level, l, cell.x, cell.y))
+                continue;
+
+            auto tile_id = layers.at(l).tile_ids.at(cell.x, cell.y);
+            auto& draw_data = level.tile_set_data.at(tile_id.getTileset());
+            auto src_rect = GetTileRect(level.map.getTileSets().at(tile_id.getTileset()), draw_data, tile_id.getId());
+
+            renderer.RenderTextureRect(*draw_data.spritesheet_texture, camera.ToScreenRect(dst_rect), &src_rect);
+        }
+    }
+}
+
+bool DrawLevelLod(Renderer& renderer, LevelLod& lod, Level& level, const FrameCamera& camera, const glm::uvec2& screen_size, DeltaMS delta)
+{
+    if (lod.levels.empty())
+    {
+        return false;
+    }
+
+    auto map_tile_size = glm::vec2 { level.map.getMapTileSize().x, level.map.getMapTileSize().y };
+    auto tile_rect = camera.ToScreenRect(SDL_FRect { 0.0f, 0.0f, map_tile_size.x, map_tile_size.y });
+    float tile_screen_size = std::max(tile_rect.w, tile_rect.h);
+
+    if (tile_screen_size >= lod.max_tile_screen_size)
+    {
+        return false;
+    }
+
+    // Coarsest level whose texels are no larger than a screen pixel, the last one covers anything smaller
+    float zoom = tile_rect.w / map_tile_size.x;
+    int level_index = (int)std::floor(std::log2(1.0f / zoom)) - 1;
+    auto& lod_level = lod.levels.at(std::clamp(level_index, 0, (int)lod.levels.size() - 1));
+
+    auto world_start = glm::max(camera.ToWorld(glm::vec2(0.0f)), glm::vec2(0.0f));
+    auto world_end = glm::min(camera.ToWorld(glm::vec2(screen_size)), glm::vec2(lod.map_size));
+
+    if (world_end.x <= world_start.x || world_end.y <= world_start.y)
+    {
+        UpdateLevelAnimations(level, delta);
+        return true;
+    }
+
+    float chunk_world_size = float(lod.chunk_texels * lod_level.scale);
+    auto chunk_start = glm::uvec2(world_start / chunk_world_size);
+    auto chunk_end = glm::min(glm::uvec2(world_end / chunk_world_size) + 1u, lod_level.chunk_grid_size);
+
+    // Chunks coming into view are baked first, the frame falls back to DrawLevel until they all are
+    uint32_t bakes = 0;
+    bool complete = true;
+
+    lod.frame_index++;
+
+    for (uint32_t cy = chunk_start.y; cy < chunk_end.y; ++cy)
+    {
+        for (uint32_t cx = chunk_start.x; cx < chunk_end.x; ++cx)
+        {
+            auto& chunk = lod_level.chunks.at(cy * lod_level.chunk_grid_size.x + cx);
+            chunk.last_drawn = lod.frame_index;
+
+            if (!chunk.texture && bakes < lod.max_chunk_bakes)
+            {
+                BakeLevelLodChunk(renderer, lod, level, lod_level, { cx, cy });
+                bakes++;
+            }
+
+            complete &= chunk.texture.has_value();
+        }
+    }
+
+    DropOldLevelLodChunks(lod);
+
+    if (!complete)
+    {
+        return false;
+    }
+
+    UpdateLevelAnimations(level, delta);
+
+    for (uint32_t cy = chunk_start.y; cy < chunk_end.y; ++cy)
+    {
+        for (uint32_t cx = chunk_start.x; cx < chunk_end.x; ++cx)
+        {
+            auto& chunk = lod_level.chunks.at(cy * lod_level.chunk_grid_size.x + cx);
+            auto texel_origin = glm::uvec2(cx, cy) * lod.chunk_texels;
+            auto chunk_size = glm::min(glm::uvec2(lod.chunk_texels), lod_level.size - texel_origin);
+            auto origin = glm::vec2(texel_origin * lod_level.scale);
+
+            // Edge texels can reach past the map, they are cropped to it
+            auto world_size = glm::min(glm::vec2(chunk_size * lod_level.scale), glm::vec2(lod.map_size) - origin);
+            auto texel_size = world_size / float(lod_level.scale);
+
+            SDL_FRect src_rect { 0.0f, 0.0f, texel_size.x, texel_size.y };
+            SDL_FRect dst_rect { origin.x, origin.y, world_size.x, world_size.y };
+
+            renderer.RenderTextureRect(*chunk.texture, camera.ToScreenRect(dst_rect), &src_rect);
+        }
+    }
+
+    if (tile_screen_size >= lod.min_animated_tile_screen_size)
+    {
+        auto visible_start = glm::uvec2(world_start / map_tile_size);
+        auto visible_end = glm::uvec2(world_end / map_tile_size) + 1u;
+
+        DrawAnimatedCells(renderer, lod, level, camera, visible_start, visible_end);
+    }
+
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <game/level.hpp>
+#include <unordered_map>
+
+// Pre-composited, progressively downsampled images of the map for zoomed out views.
+// Level k of the pyramid has one texel per 2^(k + 1) map pixels with every tile layer flattened,
+// and is split into square chunks, so the quads drawn depend on the screen size and not on the map size.
+// Chunks are baked straight from the map and uploaded when they first come into view, and only the
+// least recently drawn ones are kept as textures, so their memory doesn't grow with the map either.
+// Animated tiles are baked in the frame they show when their chunk is baked, they are drawn again over
+// the chunks while the tiles are large enough on screen to see them move.
+// Needs the level tilesets loaded with keep_cpu_pixels.
+
+// Tileset and animation frame of every layer drawn in a cell, back to front. Cells with equal stacks look the same.
+using LevelLodStack = std::vector<uint64_t>;
+
+struct LevelLodStackHash
+{
+    size_t operator()(const LevelLodStack& stack) const;
+};
+
+struct LevelLodStackSums
+{
+    glm::vec4 sum {}; // Every pixel of the flattened cell, premultiplied
+    // (tile_size.x + 1) * (tile_size.y + 1) running sums, for the texels whose edges cut through the cell
+    std::vector<glm::vec4> prefix_sums {};
+};
+
+struct LevelLodChunk
+{
+    std::optional<Texture> texture {}; // Empty until the chunk is in view, or after it was dropped
+    uint64_t last_drawn {}; // LevelLod::frame_index it was last in view
+};
+
+struct LevelLodLevel
+{
+    uint32_t scale {}; // Map pixels per texel
+    glm::uvec2 size {}; // Texels
+    glm::uvec2 chunk_grid_size {};
+    std::vector<LevelLodChunk> chunks {}; // Row major
+};
+
+struct LevelLod
+{
+    glm::uvec2 map_size {}; // Pixels
+    uint32_t chunk_texels {};
+    std::vector<LevelLodLevel> levels {}; // Finest first
+    std::vector<glm::uvec2> animated_cells {}; // Sorted by row, cells with an animated tile in a visible layer
+    // Every stack flattened so far. Their prefix sums are all dropped once more than max_prefix_sum_stacks hold them.
+    std::unordered_map<LevelLodStack, LevelLodStackSums, LevelLodStackHash> stack_sums {};
+    uint32_t prefix_sum_stacks {};
+    uint32_t max_prefix_sum_stacks = 1024; // 17 MiB with 32 pixel tiles
+
+    uint64_t frame_index {};
+    uint32_t resident_chunks {}; // Chunks that hold a texture
+    uint32_t max_resident_chunks = 128; // 32 MiB of 256 texel chunks, the oldest ones out of view are dropped first
+    uint32_t max_chunk_bakes = 4; // Per frame, DrawLevel draws the frames that need more
+
+    float max_tile_screen_size = 24.0f; // The pyramid replaces the tile quads below this
+    float min_animated_tile_screen_size = 12.0f; // Animated cells are drawn over the pyramid above this
+};
+
+// One level of the pyramid before it is split into chunks
+struct LevelLodImage
+{
+    uint32_t scale {}; // Map pixels per texel
+    glm::uvec2 size {}; // Texels
+    std::vector<glm::u8vec4> texels {}; // Row major, premultiplied alpha
+};
+
+// Every level baked whole, finest first, the way the chunks are baked. Empty when a tileset has no CPU pixels.
+std::vector<LevelLodImage> BakeLevelLodImages(const Level& level, uint32_t chunk_texels = 256, uint32_t max_levels = 6);
+
+// Lays out the pyramid, nothing is baked until it is drawn. No levels when a tileset has no CPU pixels.
+// Create it again when the grid size, the tilesets or their animations changed.
+LevelLod CreateLevelLod(const Level& level, uint32_t chunk_texels = 256, uint32_t max_levels = 6);
+// Drops the chunks covering tiles edited in place, they are baked again when seen
+void UpdateLevelLod(LevelLod& lod, const Level& level, const std::vector<glm::uvec2>& changed_tiles);
+
+// Draws the level from the pyramid when its tiles are small enough on screen and the chunks in view
+// could be baked within max_chunk_bakes. Returns false otherwise, DrawLevel should be used instead.
+bool DrawLevelLod(Renderer& renderer, LevelLod& lod, Level& level, const FrameCamera& camera, const glm::uvec2& screen_size, DeltaMS delta);
@@ -0,0 +1,555 @@
+#include <game/lockstep.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define LOCKSTEP_SOCKETS
+using SocketHandle = SOCKET;
+#elif defined(__unix__) || defined(__APPLE__)
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define LOCKSTEP_SOCKETS
+using SocketHandle = int;
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static_assert(std::is_trivially_copyable_v<LockstepMessage>);
+static_assert(sizeof(LockstepMessage) == 48, "Lockstep messages are sent as raw bytes, keep the padding explicit");
+
+// The joining side can start before the host is listening
+constexpr uint32_t JOIN_ATTEMPTS = 50;
+constexpr auto JOIN_RETRY_DELAY = std::chrono::milliseconds(100);
+constexpr auto ACCEPT_POLL_INTERVAL = std::chrono::milliseconds(16);
+
+#ifdef LOCKSTEP_SOCKETS
+
+static bool InitSockets()
+{
+#if defined(_WIN32)
+    static const bool initialised = []()
+    {
+        WSADATA data {};
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+
+    return initialised;
+#else
+    return true;
+#endif
+}
+
+static bool IsValidSocket(SocketHandle socket)
+{
+#if defined(_WIN32)
+    return socket != INVALID_SOCKET;
+#else
+    return socket >= 0;
+#endif
+}
+
+static void CloseSocket(SocketHandle socket)
+{
+#if defined(_WIN32)
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+// Waits for the listener to have a peer, polling so the caller can give up
+static bool WaitForPeer(SocketHandle listener, const LockstepWaitCallback& keep_waiting)
+{
+    while (true)
+    {
+        fd_set readable {};
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+
+        timeval timeout {};
+        timeout.tv_usec = std::chrono::duration_cast<std::chrono::microseconds>(ACCEPT_POLL_INTERVAL).count();
+
+        int ready = select((int)listener + 1, &readable, nullptr, nullptr, keep_waiting ? &timeout : nullptr);
+
+        if (ready != 0)
+        {
+            return ready > 0;
+        }
+
+        if (!keep_waiting())
+        {
+            return false;
+        }
+    }
+}
+
+// Messages are tiny and latency bound, Nagle would hold them back
+static void SetNoDelay(SocketHandle socket)
+{
+    int enabled = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+}
+
+#endif
+
+LockstepConnection::LockstepConnection(intptr_t socket)
+    : socket(socket)
+{
+}
+
+LockstepConnection::~LockstepConnection()
+{
+#ifdef LOCKSTEP_SOCKETS
+    CloseSocket(static_cast<SocketHandle>(socket));
+#endif
+}
+
+std::unique_ptr<LockstepConnection> LockstepConnection::Host(uint16_t port, const LockstepWaitCallback& keep_waiting)
+{
+#ifdef LOCKSTEP_SOCKETS
+    if (!InitSockets())
+    {
+        return nullptr;
+    }
+
+    SocketHandle listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+    if (!IsValidSocket(listener))
+    {
+        return nullptr;
+    }
+
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    bool listening = bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 && listen(listener, 1) == 0;
+    bool connected = listening && WaitForPeer(listener, keep_waiting);
+    SocketHandle peer = connected ? accept(listener, nullptr, nullptr) : listener;
+    CloseSocket(listener);
+
+    if (!connected || !IsValidSocket(peer))
+    {
+        return nullptr;
+    }
+
+    SetNoDelay(peer);
+    return std::unique_ptr<LockstepConnection>(new LockstepConnection(static_cast<intptr_t>(peer)));
+#else
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<LockstepConnection> LockstepConnection::Join(const std::string& address, uint16_t port, const LockstepWaitCallback& keep_waiting)
+{
+#ifdef LOCKSTEP_SOCKETS
+    if (!InitSockets())
+    {
+        return nullptr;
+    }
+
+    addrinfo hints {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    addrinfo* results = nullptr;
+
+    if (getaddrinfo(address.c_str(), std::to_string(port).c_str(), &hints, &results) != 0)
+    {
+        return nullptr;
+    }
+
+    for (uint32_t attempt = 0; attempt < JOIN_ATTEMPTS; ++attempt)
+    {
+        SocketHandle peer = ::socket(results->ai_family, results->ai_socktype, results->ai_protocol);
+
+        if (IsValidSocket(peer) && connect(peer, results->ai_addr, (int)results->ai_addrlen) == 0)
+        {
+            freeaddrinfo(results);
+            SetNoDelay(peer);
+            return std::unique_ptr<LockstepConnection>(new LockstepConnection(static_cast<intptr_t>(peer)));
+        }
+
+        if (IsValidSocket(peer))
+        {
+            CloseSocket(peer);
+        }
+
+        if (keep_waiting && !keep_waiting())
+            break;
+
+        std::this_thread::sleep_for(JOIN_RETRY_DELAY);
+    }
+
+    freeaddrinfo(results);
+    return nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+bool LockstepConnection::Send(const LockstepMessage& message)
+{
+#ifdef LOCKSTEP_SOCKETS
+    uint8_t bytes[sizeof(LockstepMessage)] {};
+    std::memcpy(bytes, &message, sizeof(message));
+
+    for (size_t sent = 0; sent < sizeof(bytes);)
+    {
+        auto result = send(static_cast<SocketHandle>(socket), reinterpret_cast<const char*>(bytes + sent), (int)(sizeof(bytes) - sent), MSG_NOSIGNAL);
+
+        if (result <= 0)
+        {
+            return false;
+        }
+
+        sent += result;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LockstepConnection::Receive(std::vector<LockstepMessage>& messages, bool wait)
+{
+#ifdef LOCKSTEP_SOCKETS
+    auto handle = static_cast<SocketHandle>(socket);
+    size_t first_message = messages.size();
+
+    auto take_messages = [&]()
+    {
+        size_t offset = 0;
+
+        for (; offset + sizeof(LockstepMessage) <= pending.size(); offset += sizeof(LockstepMessage))
+        {
+            auto& message = messages.emplace_back();
+            std::memcpy(&message, pending.data() + offset, sizeof(LockstepMessage));
+        }
+
+        pending.erase(pending.begin(), pending.begin() + offset);
+    };
+
+    take_messages();
+
+    while (true)
+    {
+        fd_set readable {};
+        FD_ZERO(&readable);
+        FD_SET(handle, &readable);
+
+        timeval no_timeout {};
+        bool block = wait && messages.size() == first_message;
+
+        int ready = select((int)handle + 1, &readable, nullptr, nullptr, block ? nullptr : &no_timeout);
+
+        if (ready < 0)
+        {
+            return false;
+        }
+
+        if (ready == 0)
+        {
+            return true;
+        }
+
+        char buffer[1024];
+        auto received = recv(handle, buffer, sizeof(buffer), 0);
+
+        if (received <= 0)
+        {
+            return false;
+        }
+
+        pending.insert(pending.end(), buffer, buffer + received);
+        take_messages();
+    }
+#else
+    return false;
+#endif
+}
+
+static LockstepMessage MakeMessage(LockstepMessageKind kind, const GameState& game_state)
+{
+    LockstepMessage message {};
+    message.kind = kind;
+    message.turn_index = game_state.turn_index;
+    return message;
+}
+
+static std::optional<LockstepSession> StartSession(std::unique_ptr<LockstepConnection> connection, UnitTeam local_team, const GameState& game_state)
+{
+    if (!connection)
+    {
+        return std::nullopt;
+    }
+
+    auto hello = MakeMessage(LockstepMessageKind::HELLO, game_state);
+    hello.checksum = ChecksumGameState(game_state);
+
+    std::vector<LockstepMessage> received {};
+
+    if (!connection->Send(hello) || !connection->Receive(received, true))
+    {
+        return std::nullopt;
+    }
+
+    // Same protocol, level, starting units and turn
+    auto& peer_hello = received.front();
+
+    if (peer_hello.kind != LockstepMessageKind::HELLO || peer_hello.version != LOCKSTEP_VERSION || peer_hello.checksum != hello.checksum)
+    {
+        return std::nullopt;
+    }
+
+    LockstepSession session {};
+    session.connection = std::move(connection);
+    session.local_team = local_team;
+    session.queued.assign(received.begin() + 1, received.end());
+    return session;
+}
+
+std::optional<LockstepSession> HostLockstep(uint16_t port, const GameState& game_state, const LockstepWaitCallback& keep_waiting)
+{
+    return StartSession(LockstepConnection::Host(port, keep_waiting), UnitTeam::RED, game_state);
+}
+
+std::optional<LockstepSession> JoinLockstep(const std::string& address, uint16_t port, const GameState& game_state, const LockstepWaitCallback& keep_waiting)
+{
+    return StartSession(LockstepConnection::Join(address, port, keep_waiting), UnitTeam::BLUE, game_state);
+}
+
+uint64_t ChecksumGameState(const GameState& game_state)
+{
+    // FNV-1a over whole values
+    uint64_t hash = 14695981039346656037ull;
+
+    auto add = [&](uint64_t value)
+    {
+        hash = (hash ^ value) * 1099511628211ull;
+    };
+
+    add(game_state.current_level->content_hash);
+    add(game_state.turn_index);
+
+    for (auto team : game_state.teams)
+    {
+        add(static_cast<uint64_t>(team));
+    }
+
+    auto& units = game_state.unit_state.units;
+
+    for (auto it = units.begin(); it != units.end(); ++it)
+    {
+        auto unit = *it;
+
+        if (unit.health <= 0)
+            continue;
+
+        // A selected unit is still idle for the other peer
+        auto state = unit.state == UnitState::MOVING ? UnitState::IDLE : unit.state;
+
+        add(uint64_t(it.getIndices().x) | uint64_t(it.getIndices().y) << 32);
+        add(uint64_t(unit.team) | uint64_t(unit.type) << 8 | uint64_t(state) << 16 | uint64_t(uint8_t(unit.health)) << 24);
+    }
+
+    return hash;
+}
+
+bool IsLocalTurn(const LockstepSession& session, const GameState& game_state)
+{
+    return GetCurrentTeam(game_state) == session.local_team;
+}
+
+void SendLockstepAction(LockstepSession& session, const GameState& game_state, const UnitAction& action)
+{
+    auto message = MakeMessage(LockstepMessageKind::ACTION, game_state);
+    message.unit_x = action.unit_tile.x;
+    message.unit_y = action.unit_tile.y;
+    message.move_x = action.move_tile.x;
+    message.move_y = action.move_tile.y;
+
+    if (action.attack_tile)
+    {
+        message.has_attack = 1;
+        message.attack_x = action.attack_tile->x;
+        message.attack_y = action.attack_tile->y;
+    }
+
+    session.disconnected |= !session.connection->Send(message);
+}
+
+void SendLockstepEndTurn(LockstepSession& session, const GameState& game_state)
+{
+    auto message = MakeMessage(LockstepMessageKind::END_TURN, game_state);
+    message.checksum = ChecksumGameState(game_state);
+
+    session.disconnected |= !session.connection->Send(message);
+}
+
+static constexpr glm::ivec2 DIRECTIONS[4] = {
+    glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1)
+};
+
+// Guards the local simulation against actions the cursor could not have made:
+// the destination has to be in the move range and the target next to it
+static bool IsLegalRemoteAction(const GameState& game_state, const UnitAction& action, const std::unordered_map<glm::uvec2, UnitPath>& move_tiles)
+{
+    auto grid_size = game_state.current_level->map.getMapGridSize();
+    auto& units = game_state.unit_state.units;
+
+    auto in_bounds = [&](const glm::ivec2& tile)
+    {
+        return tile.x >= 0 && tile.y >= 0 && tile.x < (int)grid_size.x && tile.y < (int)grid_size.y;
+    };
+
+    auto unit = units.at(action.unit_tile.x, action.unit_tile.y);
+
+    if (unit.health <= 0 || unit.team != GetCurrentTeam(game_state) || unit.state != UnitState::IDLE)
+    {
+        return false;
+    }
+
+    // Friendly units can be passed through but not stopped on
+    if (!move_tiles.contains(action.move_tile))
+    {
+        return false;
+    }
+
+    if (action.move_tile != action.unit_tile && units.at(action.move_tile.x, action.move_tile.y).health > 0)
+    {
+        return false;
+    }
+
+    if (!action.attack_tile)
+    {
+        return true;
+    }
+
+    // Fog is local, the sender may see enemies this side doesn't
+    for (auto dir : DIRECTIONS)
+    {
+        auto adjacent_tile = glm::ivec2(action.move_tile) + dir;
+
+        if (!in_bounds(adjacent_tile) || glm::uvec2(adjacent_tile) != action.attack_tile.value())
+            continue;
+
+        auto target = units.at(adjacent_tile.x, adjacent_tile.y);
+        return target.health > 0 && target.team != unit.team;
+    }
+
+    return false;
+}
+
+static void ApplyRemoteMessage(LockstepSession& session, GameState& game_state, const LockstepMessage& message, LockstepUpdate& update)
+{
+    bool remote_turn = !IsLocalTurn(session, game_state) && message.turn_index == game_state.turn_index;
+
+    if (message.kind == LockstepMessageKind::ACTION && remote_turn)
+    {
+        UnitAction action { { message.unit_x, message.unit_y }, { message.move_x, message.move_y } };
+
+        if (message.has_attack)
+        {
+            action.attack_tile = glm::uvec2 { message.attack_x, message.attack_y };
+        }
+
+        auto grid_size = game_state.current_level->map.getMapGridSize();
+        bool unit_in_bounds = action.unit_tile.x < grid_size.x && action.unit_tile.y < grid_size.y;
+
+        // Only the destination is sent, the route is found again before the unit leaves
+        auto move_tiles = unit_in_bounds
+            ? FindMoveTiles(*game_state.current_level, game_state.unit_state, action.unit_tile)
+            : std::unordered_map<glm::uvec2, UnitPath> {};
+
+        if (unit_in_bounds && IsLegalRemoteAction(game_state, action, move_tiles))
+        {
+            // Facing is set by the cursor on the sending side
+            auto& unit = game_state.unit_state.units.at(action.unit_tile.x, action.unit_tile.y);
+
+            if (action.move_tile.x != action.unit_tile.x)
+            {
+                unit.facingRight = action.move_tile.x > action.unit_tile.x;
+            }
+
+            update.moved_paths.emplace_back(move_tiles.at(action.move_tile));
+
+            auto& units = game_state.unit_state.units;
+            std::optional<UnitAttack> attack {};
+
+            if (action.attack_tile)
+            {
+                attack = UnitAttack { action.move_tile, action.attack_tile.value() };
+                attack->attacker_before = unit;
+                attack->defender_before = units.at(attack->defender_tile.x, attack->defender_tile.y);
+            }
+
+            auto changed = ApplyUnitAction(*game_state.current_level, game_state.unit_state, action);
+            update.changed_tiles.insert(update.changed_tiles.end(), changed.begin(), changed.end());
+
+            if (attack)
+            {
+                attack->attacker_after = units.at(attack->attacker_tile.x, attack->attacker_tile.y);
+                attack->defender_after = units.at(attack->defender_tile.x, attack->defender_tile.y);
+                update.attacks.emplace_back(attack.value());
+            }
+
+            return;
+        }
+    }
+    else if (message.kind == LockstepMessageKind::END_TURN && remote_turn)
+    {
+        if (message.checksum == ChecksumGameState(game_state))
+        {
+            update.turn_ended = true;
+            return;
+        }
+    }
+
+    session.desynced = true;
+}
+
+LockstepUpdate UpdateLockstep(LockstepSession& session, GameState& game_state, bool wait)
+{
+    LockstepUpdate update {};
+
+    if (session.desynced || !session.connection)
+    {
+        return update;
+    }
+
+    if (!session.disconnected)
+    {
+        session.disconnected = !session.connection->Receive(session.queued, wait && session.queued.empty());
+    }
+
+    // Later messages belong to the next turn, they wait until the caller advanced it
+    size_t processed = 0;
+
+    while (processed < session.queued.size() && !update.turn_ended && !session.desynced)
+    {
+        ApplyRemoteMessage(session, game_state, session.queued.at(processed), update);
+        ++processed;
+    }
+
+    session.queued.erase(session.queued.begin(), session.queued.begin() + processed);
+    return update;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <game/game_state.hpp>
+#include <functional>
+#include <game/pathfinding.hpp>
+#include <memory>
+#include <optional>
+#include <string>
+
+// Lockstep multiplayer between two instances over TCP. Peers only exchange the actions
+// confirmed with the cursor and the turn ends, each side simulates the match itself.
+// Every turn end carries a checksum of the sender's game state, so a desync is caught on
+// the turn it happens. The host plays red and the joining peer blue.
+
+constexpr uint16_t LOCKSTEP_DEFAULT_PORT = 27960;
+constexpr uint32_t LOCKSTEP_VERSION = 1;
+
+enum class LockstepMessageKind : uint8_t
+{
+    HELLO, // Sent once by both sides after connecting
+    ACTION,
+    END_TURN
+};
+
+// Fixed size, native byte order like save games
+struct LockstepMessage
+{
+    LockstepMessageKind kind = LockstepMessageKind::HELLO;
+    uint8_t has_attack {};
+    uint8_t padding[2] {};
+    uint32_t version = LOCKSTEP_VERSION;
+    uint32_t turn_index {};
+
+    uint32_t unit_x {};
+    uint32_t unit_y {};
+    uint32_t move_x {};
+    uint32_t move_y {};
+    uint32_t attack_x {};
+    uint32_t attack_y {};
+
+    uint64_t checksum {}; // HELLO: starting state, END_TURN: state the turn ended with
+};
+
+// Called every few milliseconds while waiting for the peer to connect, returning false gives up.
+// Lets a window keep handling its events.
+using LockstepWaitCallback = std::function<bool()>;
+
+// Blocking TCP stream, closed on destruction. Backed by BSD sockets or Winsock,
+// on other platforms connecting always fails.
+class LockstepConnection
+{
+public:
+    // Waits for one peer to connect
+    static std::unique_ptr<LockstepConnection> Host(uint16_t port, const LockstepWaitCallback& keep_waiting = {});
+    static std::unique_ptr<LockstepConnection> Join(const std::string& address, uint16_t port, const LockstepWaitCallback& keep_waiting = {});
+
+    ~LockstepConnection();
+
+    LockstepConnection(const LockstepConnection&) = delete;
+    LockstepConnection& operator=(const LockstepConnection&) = delete;
+
+    bool Send(const LockstepMessage& message);
+
+    // Appends the whole messages received so far, with wait set blocks until there is one.
+    // Returns false once the peer is gone.
+    bool Receive(std::vector<LockstepMessage>& messages, bool wait);
+
+private:
+    explicit LockstepConnection(intptr_t socket);
+
+    intptr_t socket = -1;
+    std::vector<uint8_t> pending {};
+};
+
+struct LockstepSession
+{
+    std::unique_ptr<LockstepConnection> connection {};
+    UnitTeam local_team = UnitTeam::RED;
+    std::vector<LockstepMessage> queued {};
+
+    bool desynced = false;
+    bool disconnected = false;
+};
+
+struct LockstepUpdate
+{
+    std::vector<glm::uvec2> changed_tiles {};
+    std::vector<UnitPath> moved_paths {}; // Routes of the remote moves, for animating them
+    std::vector<UnitAttack> attacks {}; // Remote attacks, for their hit effects
+    bool turn_ended = false; // The remote team finished its turn, advance it like a local turn end
+};
+
+// Block until the peer is connected and both sides start from the same state
+std::optional<LockstepSession> HostLockstep(uint16_t port, const GameState& game_state, const LockstepWaitCallback& keep_waiting = {});
+std::optional<LockstepSession> JoinLockstep(const std::string& address, uint16_t port, const GameState& game_state, const LockstepWaitCallback& keep_waiting = {});
+
+// Level, turn and units. Facing and selection are local presentation and left out.
+uint64_t ChecksumGameState(const GameState& game_state);
+bool IsLocalTurn(const LockstepSession& session, const GameState& game_state);
+
+void SendLockstepAction(LockstepSession& session, const GameState& game_state, const UnitAction& action);
+// Call before advancing the turn
+void SendLockstepEndTurn(LockstepSession& session, const GameState& game_state);
+
+// Applies the remote actions received so far, stopping after a turn end.
+// An illegal action or a checksum mismatch marks the session as desynced.
+LockstepUpdate UpdateLockstep(LockstepSession& session, GameState& game_state, bool wait);
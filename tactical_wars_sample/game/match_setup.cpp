@@ -0,0 +1,76 @@
+#include <game/match_setup.hpp>
+
+#include <algorithm>
+#include <random>
+
+static Unit MakeStartingUnit(UnitTeam team)
+{
+    Unit unit {};
+    unit.team = team;
+    unit.health = 100;
+    unit.facingRight = team == UnitTeam::RED;
+    return unit;
+}
+
+StartingLayout DefaultStartingLayout()
+{
+    StartingLayout layout {};
+
+    auto red_unit = MakeStartingUnit(UnitTeam::RED);
+    layout.placements.emplace_back(UnitPlacement { { 5, 3 }, red_unit });
+    layout.placements.emplace_back(UnitPlacement { { 5, 4 }, red_unit });
+    layout.placements.emplace_back(UnitPlacement { { 4, 4 }, red_unit });
+
+    auto blue_unit = MakeStartingUnit(UnitTeam::BLUE);
+    layout.placements.emplace_back(UnitPlacement { { 9, 2 }, blue_unit });
+    layout.placements.emplace_back(UnitPlacement { { 11, 1 }, blue_unit });
+    layout.placements.emplace_back(UnitPlacement { { 10, 1 }, blue_unit });
+
+    return layout;
+}
+
+StartingLayout RandomStartingLayout(const Level& level, uint32_t units_per_team, uint64_t seed)
+{
+    StartingLayout layout {};
+    std::mt19937_64 rng { seed };
+
+    auto grid_size = level.map.getMapGridSize();
+    uint32_t zone_width = std::max(1u, grid_size.x / 3);
+
+    auto place_team = [&](UnitTeam team, uint32_t zone_start)
+    {
+        std::vector<glm::uvec2> candidates {};
+
+        for (uint32_t y = 0; y < grid_size.y; ++y)
+        {
+            for (uint32_t x = zone_start; x < zone_start + zone_width; ++x)
+            {
+                if (level.terrain.at(x, y).move_cost != 0)
+                {
+                    candidates.emplace_back(x, y);
+                }
+            }
+        }
+
+        std::shuffle(candidates.begin(), candidates.end(), rng);
+        candidates.resize(std::min<size_t>(candidates.size(), units_per_team));
+
+        for (auto tile : candidates)
+        {
+            layout.placements.emplace_back(UnitPlacement { tile, MakeStartingUnit(team) });
+        }
+    };
+
+    place_team(UnitTeam::RED, 0);
+    place_team(UnitTeam::BLUE, grid_size.x - zone_width);
+
+    return layout;
+}
+
+void ApplyStartingLayout(UnitMapState& unit_map, const StartingLayout& layout)
+{
+    for (auto& placement : layout.placements)
+    {
+        unit_map.units.at(placement.tile.x, placement.tile.y) = placement.unit;
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <game/level.hpp>
+#include <game/unit.hpp>
+
+struct UnitPlacement
+{
+    glm::uvec2 tile {};
+    Unit unit {};
+};
+
+struct StartingLayout
+{
+    std::vector<UnitPlacement> placements {};
+};
+
+// The hand placed layout of the sample map
+StartingLayout DefaultStartingLayout();
+
+// Red deploys on the left third of the map and blue on the right third, on walkable tiles
+StartingLayout RandomStartingLayout(const Level& level, uint32_t units_per_team, uint64_t seed);
+
+void ApplyStartingLayout(UnitMapState& unit_map, const StartingLayout& layout);
@@ -0,0 +1,260 @@
+#include <game/minimap.hpp>
+#include <utility/colours.hpp>
+
+static glm::vec4 GetTeamColour(UnitTeam team)
+{
+    switch (team)
+    {
+    case UnitTeam::RED:
+        return glm::vec4 { 0.9f, 0.2f, 0.2f, 1.0f };
+    case UnitTeam::BLUE:
+        return glm::vec4 { 0.2f, 0.4f, 0.9f, 1.0f };
+    }
+
+    return glm::vec4 { 1.0f };
+}
+
+static glm::u8vec4 GetTeamTexel(UnitTeam team)
+{
+    return glm::u8vec4(GetTeamColour(team) * 255.0f + 0.5f);
+}
+
+static glm::u8vec4 FlattenTile(const Level& level, uint32_t x, uint32_t y)
+{
+    glm::u8vec4 texel { 0, 0, 0, 255 };
+
+    // Back to front
+    for (auto& layer : level.map.getTileLayers())
+    {
+        auto tile_id = layer.tile_ids.at(x, y);
+
+        if (!tile_id.isValid())
+        {
+            continue;
+        }
+
+        auto src = level.tile_set_data.at(tile_id.getTileset()).tile_colours.at(tile_id.getId());
+
+        uint32_t alpha = src.w;
+        texel.x = (src.x * alpha + texel.x * (255 - alpha)) / 255;
+        texel.y = (src.y * alpha + texel.y * (255 - alpha)) / 255;
+        texel.z = (src.z * alpha + texel.z * (255 - alpha)) / 255;
+    }
+
+    return texel;
+}
+
+static void WriteTexel(Minimap& minimap, const glm::uvec2& tile)
+{
+    size_t index = tile.y * minimap.grid_size.x + tile.x;
+    auto it = minimap.occupied_tiles.find(tile);
+
+    minimap.pixels.at(index) = it != minimap.occupied_tiles.end() && it->second.shown
+        ? GetTeamTexel(it->second.team)
+        : minimap.terrain_pixels.at(index);
+
+    if (minimap.dirty_start == minimap.dirty_end)
+    {
+        minimap.dirty_start = tile;
+        minimap.dirty_end = tile + 1u;
+    }
+    else
+    {
+        minimap.dirty_start = glm::min(minimap.dirty_start, tile);
+        minimap.dirty_end = glm::max(minimap.dirty_end, tile + 1u);
+    }
+}
+
+static void MarkAllTexelsDirty(Minimap& minimap)
+{
+    minimap.dirty_start = glm::uvec2(0);
+    minimap.dirty_end = minimap.grid_size;
+}
+
+static bool IsUnitShown(const FogVisibility* fog, const glm::uvec2& tile, UnitTeam team)
+{
+    return !fog || team == fog->viewer || IsTileVisible(*fog, tile);
+}
+
+Minimap CreateMinimap(SDL_Renderer* sdl_renderer, const Level& level)
+{
+    Minimap minimap {};
+    minimap.grid_size = { level.map.getMapGridSize().x, level.map.getMapGridSize().y };
+    minimap.tile_size = { level.map.getMapTileSize().x, level.map.getMapTileSize().y };
+
+    minimap.sdl_renderer = sdl_renderer;
+    minimap.texture = CreateStreamingTexture(sdl_renderer, minimap.grid_size, SDL_PIXELFORMAT_RGBA32);
+
+    RebuildMinimapTerrain(minimap, level);
+    return minimap;
+}
+
+void UpdateMinimapTerrain(Minimap& minimap, const Level& level, const std::vector<glm::uvec2>& changed_tiles)
+{
+    for (auto tile : changed_tiles)
+    {
+        minimap.terrain_pixels.at(tile.y * minimap.grid_size.x + tile.x) = FlattenTile(level, tile.x, tile.y);
+        WriteTexel(minimap, tile);
+    }
+}
+
+void RebuildMinimapTerrain(Minimap& minimap, const Level& level)
+{
+    minimap.terrain_pixels.resize(minimap.grid_size.x * minimap.grid_size.y);
+
+    for (uint32_t y = 0; y < minimap.grid_size.y; ++y)
+    {
+        for (uint32_t x = 0; x < minimap.grid_size.x; ++x)
+        {
+            minimap.terrain_pixels.at(y * minimap.grid_size.x + x) = FlattenTile(level, x, y);
+        }
+    }
+
+    minimap.pixels = minimap.terrain_pixels;
+
+    for (auto& [tile, unit] : minimap.occupied_tiles)
+    {
+        if (unit.shown)
+        {
+            minimap.pixels.at(tile.y * minimap.grid_size.x + tile.x) = GetTeamTexel(unit.team);
+        }
+    }
+
+    MarkAllTexelsDirty(minimap);
+}
+
+void ResetMinimapUnits(Minimap& minimap, const UnitMapState& unit_map, const FogVisibility* fog)
+{
+    minimap.occupied_tiles.clear();
+    minimap.viewer = fog ? std::optional(fog->viewer) : std::nullopt;
+
+    for (auto it = unit_map.units.begin(); it != unit_map.units.end(); ++it)
+    {
+        glm::uvec2 tile = { it.getIndices().x, it.getIndices().y };
+
+        if ((*it).health > 0)
+        {
+            minimap.occupied_tiles[tile] = MinimapUnit { (*it).team, IsUnitShown(fog, tile, (*it).team) };
+        }
+    }
+
+    minimap.pixels = minimap.terrain_pixels;
+
+    for (auto& [tile, unit] : minimap.occupied_tiles)
+    {
+        if (unit.shown)
+        {
+            minimap.pixels.at(tile.y * minimap.grid_size.x + tile.x) = GetTeamTexel(unit.team);
+        }
+    }
+
+    MarkAllTexelsDirty(minimap);
+}
+
+void UpdateMinimapTiles(Minimap& minimap, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_tiles, const FogVisibility* fog)
+{
+    for (auto tile : changed_tiles)
+    {
+        auto& unit = unit_map.units.at(tile.x, tile.y);
+
+        if (unit.health > 0)
+        {
+            minimap.occupied_tiles[tile] = MinimapUnit { unit.team, IsUnitShown(fog, tile, unit.team) };
+        }
+        else
+        {
+            minimap.occupied_tiles.erase(tile);
+        }
+
+        WriteTexel(minimap, tile);
+    }
+}
+
+// Only the units depend on the viewing team, the terrain texels stay as they are
+static void UpdateMinimapViewer(Minimap& minimap, const FogVisibility* fog)
+{
+    auto viewer = fog ? std::optional(fog->viewer) : std::nullopt;
+
+    if (viewer == minimap.viewer)
+        return;
+
+    minimap.viewer = viewer;
+
+    for (auto& [tile, unit] : minimap.occupied_tiles)
+    {
+        bool shown = IsUnitShown(fog, tile, unit.team);
+
+        if (shown != unit.shown)
+        {
+            unit.shown = shown;
+            WriteTexel(minimap, tile);
+        }
+    }
+}
+
+SDL_FRect GetMinimapRect(const Minimap& minimap, const glm::uvec2& window_size)
+{
+    // Bottom left corner, longest side fixed to the max size
+    float scale = minimap.max_screen_size / (float)std::max(minimap.grid_size.x, minimap.grid_size.y);
+    glm::vec2 size = glm::vec2(minimap.grid_size) * scale;
+
+    return SDL_FRect {
+        minimap.screen_margin,
+        (float)window_size.y - size.y - minimap.screen_margin,
+        size.x,
+        size.y
+    };
+}
+
+std::optional<glm::vec2> MinimapToWorld(const Minimap& minimap, const glm::uvec2& window_size, const glm::vec2& screen_pos)
+{
+    auto rect = GetMinimapRect(minimap, window_size);
+
+    if (screen_pos.x < rect.x || screen_pos.y < rect.y || screen_pos.x >= rect.x + rect.w || screen_pos.y >= rect.y + rect.h)
+    {
+        return std::nullopt;
+    }
+
+    glm::vec2 normalized = (screen_pos - glm::vec2(rect.x, rect.y)) / glm::vec2(rect.w, rect.h);
+    return normalized * glm::vec2(minimap.grid_size * minimap.tile_size);
+}
+
+void DrawMinimap(Renderer& renderer, Minimap& minimap, const glm::uvec2& window_size, const FrameCamera& camera, const FogVisibility* fog)
+{
+    UpdateMinimapViewer(minimap, fog);
+
+    if (minimap.texture && minimap.dirty_start != minimap.dirty_end)
+    {
+        // One upload of the box around the texels written since the last frame, a move and its sight stay close together
+        glm::uvec2 size = minimap.dirty_end - minimap.dirty_start;
+        SDL_Rect dirty_rect { int(minimap.dirty_start.x), int(minimap.dirty_start.y), int(size.x), int(size.y) };
+        const auto* first_texel = minimap.pixels.data() + minimap.dirty_start.y * minimap.grid_size.x + minimap.dirty_start.x;
+
+        SDL_UpdateTexture(minimap.texture.get(), &dirty_rect, first_texel, minimap.grid_size.x * sizeof(glm::u8vec4));
+        minimap.dirty_end = minimap.dirty_start;
+    }
+
+    auto rect = GetMinimapRect(minimap, window_size);
+
+    if (minimap.texture)
+    {
+        SDL_RenderTexture(minimap.sdl_renderer, minimap.texture.get(), nullptr, &rect);
+    }
+
+    // Camera viewport
+    glm::vec2 world_size = glm::vec2(minimap.grid_size * minimap.tile_size);
+    glm::vec2 view_start = camera.ToWorld(glm::vec2(0.0f)) / world_size;
+    glm::vec2 view_end = camera.ToWorld(glm::vec2(window_size)) / world_size;
+
+    view_start = glm::clamp(view_start, glm::vec2(0.0f), glm::vec2(1.0f));
+    view_end = glm::clamp(view_end, glm::vec2(0.0f), glm::vec2(1.0f));
+
+    SDL_FRect view_rect {
+        rect.x + view_start.x * rect.w,
+        rect.y + view_start.y * rect.h,
+        (view_end.x - view_start.x) * rect.w,
+        (view_end.y - view_start.y) * rect.h
+    };
+
+    renderer.RenderRect(view_rect, colour::WHITE);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <game/fog.hpp>
+#include <game/level.hpp>
+#include <game/render_target.hpp>
+#include <game/unit.hpp>
+#include <optional>
+
+// One texel per map tile, in a streaming texture. The terrain is baked once at load and the
+// units are written over it, only the texels of tiles that changed are rewritten and uploaded.
+struct MinimapUnit
+{
+    UnitTeam team {};
+    bool shown = true; // False while the fog hides it from the viewing team
+};
+
+struct Minimap
+{
+    glm::uvec2 grid_size {};
+    glm::uvec2 tile_size {};
+
+    SDL_Renderer* sdl_renderer {};
+    StreamingTexture texture {};
+    std::vector<glm::u8vec4> terrain_pixels {}; // Flattened tile layers
+    std::vector<glm::u8vec4> pixels {}; // Terrain with the shown units, as uploaded
+    glm::uvec2 dirty_start {}; // Texels written since the last upload, empty when start == end
+    glm::uvec2 dirty_end {};
+
+    std::unordered_map<glm::uvec2, MinimapUnit> occupied_tiles {};
+    std::optional<UnitTeam> viewer {}; // Empty when drawn without fog
+
+    float max_screen_size = 240.0f;
+    float screen_margin = 16.0f;
+};
+
+Minimap CreateMinimap(SDL_Renderer* sdl_renderer, const Level& level);
+// Bakes the terrain again for edited tiles, or for every tile after a tileset changed
+void UpdateMinimapTerrain(Minimap& minimap, const Level& level, const std::vector<glm::uvec2>& changed_tiles);
+void RebuildMinimapTerrain(Minimap& minimap, const Level& level);
+
+// Enemies the fog hides are left out, as on the map
+void ResetMinimapUnits(Minimap& minimap, const UnitMapState& unit_map, const FogVisibility* fog = nullptr);
+// For tiles whose unit or visibility changed
+void UpdateMinimapTiles(Minimap& minimap, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_tiles, const FogVisibility* fog = nullptr);
+
+SDL_FRect GetMinimapRect(const Minimap& minimap, const glm::uvec2& window_size);
+std::optional<glm::vec2> MinimapToWorld(const Minimap& minimap, const glm::uvec2& window_size, const glm::vec2& screen_pos);
+
+// Uploads the texels written since the last frame. A different viewing team only rewrites the unit texels.
+void DrawMinimap(Renderer& renderer, Minimap& minimap, const glm::uvec2& window_size, const FrameCamera& camera, const FogVisibility* fog = nullptr);
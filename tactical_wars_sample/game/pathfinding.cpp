@@ -0,0 +1,825 @@
+#include <game/pathfinding.hpp>
+
+#include <algorithm>
+#include <queue>
+#include <tuple>
+#include <unordered_set>
+
+// Runs of walkable border tiles longer than this get an entrance at both ends
+static constexpr uint32_t MAX_SINGLE_ENTRANCE_WIDTH = 6;
+
+static constexpr glm::ivec2 DIRECTIONS[4] = {
+    glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1)
+};
+
+using OpenEntry = std::pair<uint32_t, uint32_t>;
+using OpenQueue = std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>>;
+
+// Abstract search entries sort by estimate first, then prefer the deeper node on ties
+using AbstractOpenEntry = std::pair<uint64_t, uint32_t>;
+using AbstractOpenQueue = std::priority_queue<AbstractOpenEntry, std::vector<AbstractOpenEntry>, std::greater<AbstractOpenEntry>>;
+
+static uint64_t AbstractPriority(uint32_t estimate, uint32_t cost)
+{
+    return (uint64_t(estimate) << 32) | (UNREACHABLE_PATH_COST - cost);
+}
+
+static bool IsWalkable(const PathGraph& graph, const glm::uvec2& tile)
+{
+    return graph.terrain_costs.at(tile.x, tile.y) != 0 && graph.blockers.at(tile.x, tile.y) == 0;
+}
+
+static uint32_t EnterCost(const PathGraph& graph, const glm::uvec2& tile)
+{
+    return graph.terrain_costs.at(tile.x, tile.y);
+}
+
+static uint32_t ManhattanDistance(const glm::uvec2& a, const glm::uvec2& b)
+{
+    auto d = glm::abs(glm::ivec2(a) - glm::ivec2(b));
+    return d.x + d.y;
+}
+
+static uint32_t GetClusterIndex(const PathGraph& graph, const glm::uvec2& tile)
+{
+    auto cluster = tile / graph.cluster_size;
+    return cluster.y * graph.cluster_grid_size.x + cluster.x;
+}
+
+// Dijkstra restricted to the bounds of a single cluster
+struct LocalSearch
+{
+    glm::uvec2 origin {};
+    glm::uvec2 size {};
+    std::vector<uint32_t> cost {};
+    std::vector<uint32_t> parent {};
+
+    uint32_t Index(const glm::uvec2& tile) const { return (tile.y - origin.y) * size.x + (tile.x - origin.x); }
+    glm::uvec2 Tile(uint32_t index) const { return origin + glm::uvec2(index % size.x, index / size.x); }
+
+    uint32_t CostTo(const glm::uvec2& tile) const { return cost.at(Index(tile)); }
+};
+
+// The goal of a query can always be entered, even when a unit stands on it
+static void RunLocalSearch(const PathGraph& graph, const PathCluster& cluster, const glm::uvec2& source, LocalSearch& search, const glm::uvec2* goal = nullptr)
+{
+    search.origin = cluster.origin;
+    search.size = cluster.size;
+    search.cost.assign(cluster.size.x * cluster.size.y, UNREACHABLE_PATH_COST);
+    search.parent.assign(cluster.size.x * cluster.size.y, INVALID_PATH_NODE);
+
+    OpenQueue open {};
+    search.cost.at(search.Index(source)) = 0;
+    open.emplace(0, search.Index(source));
+
+    auto bounds_end = glm::ivec2(cluster.origin + cluster.size);
+
+    while (!open.empty())
+    {
+        auto [cost, index] = open.top();
+        open.pop();
+
+        if (cost > search.cost.at(index))
+        {
+            continue;
+        }
+
+        auto tile = glm::ivec2(search.Tile(index));
+
+        for (auto dir : DIRECTIONS)
+        {
+            auto next = tile + dir;
+
+            if (next.x < (int)cluster.origin.x || next.y < (int)cluster.origin.y || next.x >= bounds_end.x || next.y >= bounds_end.y)
+                continue;
+            if (!IsWalkable(graph, glm::uvec2(next)) && !(goal && glm::uvec2(next) == *goal && EnterCost(graph, *goal) != 0))
+                continue;
+
+            auto next_index = search.Index(glm::uvec2(next));
+            auto next_cost = cost + EnterCost(graph, glm::uvec2(next));
+
+            if (next_cost < search.cost.at(next_index))
+            {
+                search.cost.at(next_index) = next_cost;
+                search.parent.at(next_index) = index;
+                open.emplace(next_cost, next_index);
+            }
+        }
+    }
+}
+
+static void AppendLocalPath(const LocalSearch& search, const glm::uvec2& target, UnitPath& out)
+{
+    std::vector<glm::uvec2> reversed {};
+
+    for (auto index = search.Index(target); search.parent.at(index) != INVALID_PATH_NODE; index = search.parent.at(index))
+    {
+        reversed.emplace_back(search.Tile(index));
+    }
+
+    out.tiles.insert(out.tiles.end(), reversed.rbegin(), reversed.rend());
+}
+
+static uint32_t AllocateNode(PathGraph& graph, const glm::uvec2& tile, uint32_t cluster)
+{
+    uint32_t id {};
+
+    if (!graph.free_nodes.empty())
+    {
+        id = graph.free_nodes.back();
+        graph.free_nodes.pop_back();
+    }
+    else
+    {
+        id = graph.nodes.size();
+        graph.nodes.emplace_back();
+    }
+
+    auto& node = graph.nodes.at(id);
+    node.tile = tile;
+    node.cluster = cluster;
+    node.partner = INVALID_PATH_NODE;
+    node.edges.clear();
+
+    graph.clusters.at(cluster).nodes.emplace_back(id);
+    return id;
+}
+
+static void ClearBorder(PathGraph& graph, uint32_t border)
+{
+    for (auto id : graph.borders.at(border))
+    {
+        auto& node = graph.nodes.at(id);
+        std::erase(graph.clusters.at(node.cluster).nodes, id);
+
+        node = PathGraphNode {};
+        graph.free_nodes.emplace_back(id);
+    }
+
+    graph.borders.at(border).clear();
+}
+
+// Border 0 of a cluster is shared with its east neighbour, border 1 with its south neighbour
+static void BuildBorder(PathGraph& graph, uint32_t border)
+{
+    uint32_t cluster_index = border / 2;
+    bool vertical = (border % 2) == 0;
+
+    auto cluster_pos = glm::uvec2(cluster_index % graph.cluster_grid_size.x, cluster_index / graph.cluster_grid_size.x);
+    auto neighbour_pos = cluster_pos + (vertical ? glm::uvec2(1, 0) : glm::uvec2(0, 1));
+
+    if (neighbour_pos.x >= graph.cluster_grid_size.x || neighbour_pos.y >= graph.cluster_grid_size.y)
+    {
+        return;
+    }
+
+    uint32_t neighbour_index = neighbour_pos.y * graph.cluster_grid_size.x + neighbour_pos.x;
+    const auto& cluster = graph.clusters.at(cluster_index);
+
+    uint32_t length = vertical ? cluster.size.y : cluster.size.x;
+    auto near_start = vertical
+        ? glm::uvec2(cluster.origin.x + cluster.size.x - 1, cluster.origin.y)
+        : glm::uvec2(cluster.origin.x, cluster.origin.y + cluster.size.y - 1);
+    auto step = vertical ? glm::uvec2(0, 1) : glm::uvec2(1, 0);
+    auto across = vertical ? glm::uvec2(1, 0) : glm::uvec2(0, 1);
+
+    auto add_transition = [&](uint32_t offset)
+    {
+        auto near_tile = near_start + step * offset;
+        auto far_tile = near_tile + across;
+
+        auto near_id = AllocateNode(graph, near_tile, cluster_index);
+        auto far_id = AllocateNode(graph, far_tile, neighbour_index);
+
+        graph.nodes.at(near_id).partner = far_id;
+        graph.nodes.at(far_id).partner = near_id;
+
+        graph.borders.at(border).emplace_back(near_id);
+        graph.borders.at(border).emplace_back(far_id);
+    };
+
+    uint32_t run_start = 0;
+    uint32_t run_length = 0;
+
+    for (uint32_t i = 0; i <= length; ++i)
+    {
+        bool open = i < length
+            && IsWalkable(graph, near_start + step * i)
+            && IsWalkable(graph, near_start + step * i + across);
+
+        if (open)
+        {
+            if (run_length == 0)
+            {
+                run_start = i;
+            }
+
+            ++run_length;
+            continue;
+        }
+
+        if (run_length == 0)
+        {
+            continue;
+        }
+
+        if (run_length < MAX_SINGLE_ENTRANCE_WIDTH)
+        {
+            add_transition(run_start + run_length / 2);
+        }
+        else
+        {
+            add_transition(run_start);
+            add_transition(run_start + run_length - 1);
+        }
+
+        run_length = 0;
+    }
+}
+
+static void BuildIntraEdges(PathGraph& graph, uint32_t cluster_index, LocalSearch& search)
+{
+    auto& cluster = graph.clusters.at(cluster_index);
+
+    for (auto id : cluster.nodes)
+    {
+        auto& node = graph.nodes.at(id);
+        node.edges.clear();
+
+        RunLocalSearch(graph, cluster, node.tile, search);
+
+        for (auto other_id : cluster.nodes)
+        {
+            if (other_id == id)
+            {
+                continue;
+            }
+
+            auto cost = search.CostTo(graph.nodes.at(other_id).tile);
+
+            if (cost != UNREACHABLE_PATH_COST)
+            {
+                node.edges.emplace_back(PathGraphEdge { other_id, cost });
+            }
+        }
+    }
+}
+
+static void MarkClusterDirty(PathGraph& graph, const glm::uvec2& tile)
+{
+    auto index = GetClusterIndex(graph, tile);
+    auto& cluster = graph.clusters.at(index);
+
+    if (!cluster.dirty)
+    {
+        cluster.dirty = true;
+        graph.dirty_clusters.emplace_back(index);
+    }
+}
+
+static bool IsStaleStamp(const PathGraph& graph, uint32_t id)
+{
+    return graph.search_stamp.at(id) != graph.current_stamp;
+}
+
+static void TouchSearchNode(PathGraph& graph, uint32_t id)
+{
+    if (IsStaleStamp(graph, id))
+    {
+        graph.search_stamp.at(id) = graph.current_stamp;
+        graph.search_cost.at(id) = UNREACHABLE_PATH_COST;
+        graph.search_parent.at(id) = INVALID_PATH_NODE;
+        graph.search_query_edges.at(id) = INVALID_PATH_NODE;
+    }
+}
+
+
+PathGraph BuildPathGraph(const Level& level, uint32_t cluster_size)
+{
+    assert(cluster_size > 0);
+
+    PathGraph graph {};
+    graph.cluster_size = cluster_size;
+    graph.grid_size = { level.map.getMapGridSize().x, level.map.getMapGridSize().y };
+    graph.cluster_grid_size = (graph.grid_size + glm::uvec2(cluster_size - 1)) / cluster_size;
+
+    graph.terrain_costs = tpp::Array2D<uint8_t>(graph.grid_size.x, graph.grid_size.y, 1);
+    graph.blockers = tpp::Array2D<uint8_t>(graph.grid_size.x, graph.grid_size.y, 0);
+
+    for (auto it = level.terrain.begin(); it != level.terrain.end(); ++it)
+    {
+        graph.terrain_costs.at(it.getIndices()) = (*it).move_cost;
+    }
+
+    uint32_t cluster_count = graph.cluster_grid_size.x * graph.cluster_grid_size.y;
+    graph.clusters.resize(cluster_count);
+    graph.borders.resize(cluster_count * 2);
+
+    for (uint32_t i = 0; i < cluster_count; ++i)
+    {
+        auto& cluster = graph.clusters.at(i);
+        cluster.origin = glm::uvec2(i % graph.cluster_grid_size.x, i / graph.cluster_grid_size.x) * cluster_size;
+        cluster.size = glm::min(glm::uvec2(cluster_size), graph.grid_size - cluster.origin);
+        cluster.dirty = true;
+
+        graph.dirty_clusters.emplace_back(i);
+    }
+
+    RepairPathGraph(graph);
+    return graph;
+}
+
+void SetPathTileCost(PathGraph& graph, const glm::uvec2& tile, uint8_t cost)
+{
+    auto& current = graph.terrain_costs.at(tile.x, tile.y);
+
+    if (current != cost)
+    {
+        current = cost;
+        MarkClusterDirty(graph, tile);
+    }
+}
+
+void SetPathTileBlocked(PathGraph& graph, const glm::uvec2& tile, bool blocked)
+{
+    auto& current = graph.blockers.at(tile.x, tile.y);
+
+    if ((current != 0) != blocked)
+    {
+        current = blocked ? 1 : 0;
+        MarkClusterDirty(graph, tile);
+    }
+}
+
+void SyncPathGraphBlockers(PathGraph& graph, const UnitMapState& unit_map)
+{
+    for (auto it = unit_map.units.begin(); it != unit_map.units.end(); ++it)
+    {
+        SetPathTileBlocked(graph, { it.getIndices().x, it.getIndices().y }, (*it).health > 0);
+    }
+}
+
+void UpdatePathGraphBlockers(PathGraph& graph, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_tiles)
+{
+    for (auto tile : changed_tiles)
+    {
+        SetPathTileBlocked(graph, tile, unit_map.units.at(tile.x, tile.y).health > 0);
+    }
+}
+
+void RepairPathGraph(PathGraph& graph)
+{
+    if (graph.dirty_clusters.empty())
+    {
+        return;
+    }
+
+    std::vector<uint32_t> borders {};
+    std::vector<uint32_t> clusters {};
+
+    auto add_unique = [](std::vector<uint32_t>& list, uint32_t value)
+    {
+        if (std::find(list.begin(), list.end(), value) == list.end())
+        {
+            list.emplace_back(value);
+        }
+    };
+
+    for (auto index : graph.dirty_clusters)
+    {
+        auto pos = glm::uvec2(index % graph.cluster_grid_size.x, index / graph.cluster_grid_size.x);
+
+        add_unique(borders, index * 2);
+        add_unique(borders, index * 2 + 1);
+        add_unique(clusters, index);
+
+        // Entrances on shared borders also belong to the neighbours
+        if (pos.x > 0)
+        {
+            add_unique(borders, (index - 1) * 2);
+            add_unique(clusters, index - 1);
+        }
+        if (pos.y > 0)
+        {
+            add_unique(borders, (index - graph.cluster_grid_size.x) * 2 + 1);
+            add_unique(clusters, index - graph.cluster_grid_size.x);
+        }
+        if (pos.x + 1 < graph.cluster_grid_size.x)
+        {
+            add_unique(clusters, index + 1);
+        }
+        if (pos.y + 1 < graph.cluster_grid_size.y)
+        {
+            add_unique(clusters, index + graph.cluster_grid_size.x);
+        }
+
+        graph.clusters.at(index).dirty = false;
+    }
+
+    graph.dirty_clusters.clear();
+
+    for (auto border : borders)
+    {
+        ClearBorder(graph, border);
+        BuildBorder(graph, border);
+    }
+
+    LocalSearch search {};
+
+    for (auto cluster : clusters)
+    {
+        BuildIntraEdges(graph, cluster, search);
+    }
+}
+
+// Start, goal and the tiles next to them in other clusters are inserted as temporary nodes
+// after the real ones, for a single query. The units standing on start and goal don't block
+// their own query, without touching the blockers or the clusters of the graph.
+struct QueryNodes
+{
+    uint32_t first_id {};
+    std::vector<glm::uvec2> tiles {};
+    std::vector<std::vector<PathGraphEdge>> edges {}; // Out of each temporary node
+    std::vector<std::vector<PathGraphEdge>> entrance_edges {}; // Out of real nodes, see search_query_edges
+
+    bool IsTemporary(uint32_t id) const { return id >= first_id; }
+
+    uint32_t Add(const glm::uvec2& tile)
+    {
+        tiles.emplace_back(tile);
+        edges.emplace_back();
+        return first_id + tiles.size() - 1;
+    }
+};
+
+static void AddEntranceEdge(PathGraph& graph, QueryNodes& query, uint32_t entrance, const PathGraphEdge& edge)
+{
+    TouchSearchNode(graph, entrance);
+    auto& list = graph.search_query_edges.at(entrance);
+
+    if (list == INVALID_PATH_NODE)
+    {
+        list = query.entrance_edges.size();
+        query.entrance_edges.emplace_back();
+    }
+
+    query.entrance_edges.at(list).emplace_back(edge);
+}
+
+std::optional<AbstractPath> FindAbstractPath(PathGraph& graph, const glm::uvec2& start, const glm::uvec2& goal)
+{
+    RepairPathGraph(graph);
+
+    if (EnterCost(graph, goal) == 0)
+    {
+        return std::nullopt;
+    }
+
+    if (start == goal)
+    {
+        return AbstractPath { { start }, 0 };
+    }
+
+    QueryNodes query {};
+    query.first_id = graph.nodes.size();
+
+    const uint32_t start_id = query.Add(start);
+    const uint32_t goal_id = query.Add(goal);
+
+    // Tiles next to start or goal across a cluster border, which may have no entrance because of their units
+    auto add_crossings = [&](const glm::uvec2& tile, std::vector<uint32_t>& crossings)
+    {
+        for (auto dir : DIRECTIONS)
+        {
+            auto next = glm::ivec2(tile) + dir;
+
+            if (next.x < 0 || next.y < 0 || next.x >= (int)graph.grid_size.x || next.y >= (int)graph.grid_size.y)
+                continue;
+            if (GetClusterIndex(graph, glm::uvec2(next)) == GetClusterIndex(graph, tile) || !IsWalkable(graph, glm::uvec2(next)))
+                continue;
+
+            crossings.emplace_back(query.Add(glm::uvec2(next)));
+        }
+    };
+
+    std::vector<uint32_t> start_side { start_id };
+    std::vector<uint32_t> goal_side { goal_id };
+    add_crossings(goal, goal_side);
+    add_crossings(start, start_side);
+
+    graph.search_cost.resize(query.first_id + query.tiles.size());
+    graph.search_parent.resize(graph.search_cost.size());
+    graph.search_query_edges.resize(graph.search_cost.size());
+    graph.search_stamp.resize(graph.search_cost.size(), 0);
+    ++graph.current_stamp;
+
+    auto node_tile = [&](uint32_t id)
+    {
+        return query.IsTemporary(id) ? query.tiles.at(id - query.first_id) : graph.nodes.at(id).tile;
+    };
+
+    LocalSearch search {};
+
+    // Searching from the goal side gives the reversed costs, entering costs are corrected per node
+    for (auto id : goal_side)
+    {
+        auto tile = node_tile(id);
+        const auto& cluster = graph.clusters.at(GetClusterIndex(graph, tile));
+
+        RunLocalSearch(graph, cluster, tile, search);
+
+        for (auto entrance : cluster.nodes)
+        {
+            auto entrance_tile = graph.nodes.at(entrance).tile;
+
+            if (auto cost = search.CostTo(entrance_tile); cost != UNREACHABLE_PATH_COST)
+            {
+                AddEntranceEdge(graph, query, entrance, PathGraphEdge { id, cost + EnterCost(graph, tile) - EnterCost(graph, entrance_tile) });
+            }
+        }
+
+        if (id != goal_id)
+        {
+            query.edges.at(id - query.first_id).emplace_back(PathGraphEdge { goal_id, EnterCost(graph, goal) });
+        }
+    }
+
+    for (auto id : start_side)
+    {
+        auto tile = node_tile(id);
+        const auto& cluster = graph.clusters.at(GetClusterIndex(graph, tile));
+        auto& edges = query.edges.at(id - query.first_id);
+
+        RunLocalSearch(graph, cluster, tile, search, &goal);
+
+        for (auto entrance : cluster.nodes)
+        {
+            if (auto cost = search.CostTo(graph.nodes.at(entrance).tile); cost != UNREACHABLE_PATH_COST)
+            {
+                edges.emplace_back(PathGraphEdge { entrance, cost });
+            }
+        }
+
+        for (auto target : goal_side)
+        {
+            auto target_tile = node_tile(target);
+
+            if (GetClusterIndex(graph, target_tile) != GetClusterIndex(graph, tile))
+                continue;
+
+            if (auto cost = search.CostTo(target_tile); cost != UNREACHABLE_PATH_COST)
+            {
+                edges.emplace_back(PathGraphEdge { target, cost });
+            }
+        }
+
+        if (id == start_id)
+        {
+            for (auto crossing = start_side.begin() + 1; crossing != start_side.end(); ++crossing)
+            {
+                edges.emplace_back(PathGraphEdge { *crossing, EnterCost(graph, node_tile(*crossing)) });
+            }
+
+            if (ManhattanDistance(start, goal) == 1)
+            {
+                edges.emplace_back(PathGraphEdge { goal_id, EnterCost(graph, goal) });
+            }
+        }
+    }
+
+    for (uint32_t id = query.first_id; id < graph.search_cost.size(); ++id)
+    {
+        TouchSearchNode(graph, id);
+    }
+
+    graph.search_cost.at(start_id) = 0;
+
+    AbstractOpenQueue open {};
+    open.emplace(AbstractPriority(ManhattanDistance(start, goal), 0), start_id);
+
+    auto relax = [&](uint32_t from, uint32_t to, uint32_t edge_cost)
+    {
+        TouchSearchNode(graph, to);
+        auto cost = graph.search_cost.at(from) + edge_cost;
+
+        if (cost < graph.search_cost.at(to))
+        {
+            graph.search_cost.at(to) = cost;
+            graph.search_parent.at(to) = from;
+            open.emplace(AbstractPriority(cost + ManhattanDistance(node_tile(to), goal), cost), to);
+        }
+    };
+
+    while (!open.empty())
+    {
+        auto [priority, id] = open.top();
+        open.pop();
+
+        if (id == goal_id)
+        {
+            break;
+        }
+
+        if (UNREACHABLE_PATH_COST - uint32_t(priority) != graph.search_cost.at(id))
+        {
+            continue;
+        }
+
+        if (query.IsTemporary(id))
+        {
+            for (auto edge : query.edges.at(id - query.first_id))
+            {
+                relax(id, edge.target, edge.cost);
+            }
+            continue;
+        }
+
+        const auto& node = graph.nodes.at(id);
+
+        for (auto edge : node.edges)
+        {
+            relax(id, edge.target, edge.cost);
+        }
+
+        if (node.partner != INVALID_PATH_NODE)
+        {
+            relax(id, node.partner, EnterCost(graph, graph.nodes.at(node.partner).tile));
+        }
+
+        if (auto list = graph.search_query_edges.at(id); list != INVALID_PATH_NODE)
+        {
+            for (auto edge : query.entrance_edges.at(list))
+            {
+                relax(id, edge.target, edge.cost);
+            }
+        }
+    }
+
+    if (graph.search_cost.at(goal_id) == UNREACHABLE_PATH_COST)
+    {
+        return std::nullopt;
+    }
+
+    AbstractPath path {};
+    path.cost = graph.search_cost.at(goal_id);
+
+    for (auto id = goal_id; id != INVALID_PATH_NODE; id = graph.search_parent.at(id))
+    {
+        auto tile = node_tile(id);
+
+        // Entrances on both sides of a cluster corner can share a tile
+        if (path.waypoints.empty() || path.waypoints.back() != tile)
+        {
+            path.waypoints.emplace_back(tile);
+        }
+    }
+
+    std::reverse(path.waypoints.begin(), path.waypoints.end());
+    return path;
+}
+
+UnitPath RefinePath(const PathGraph& graph, const AbstractPath& path, size_t first_waypoint, size_t max_segments)
+{
+    UnitPath refined {};
+
+    if (first_waypoint >= path.waypoints.size())
+    {
+        return refined;
+    }
+
+    refined.tiles.emplace_back(path.waypoints.at(first_waypoint));
+
+    LocalSearch search {};
+    size_t last_waypoint = std::min(path.waypoints.size() - 1, first_waypoint + std::min(max_segments, path.waypoints.size()));
+
+    for (size_t i = first_waypoint; i < last_waypoint; ++i)
+    {
+        auto from = path.waypoints.at(i);
+        auto to = path.waypoints.at(i + 1);
+
+        if (GetClusterIndex(graph, from) != GetClusterIndex(graph, to))
+        {
+            // Border crossing between two entrance nodes
+            refined.tiles.emplace_back(to);
+            continue;
+        }
+
+        RunLocalSearch(graph, graph.clusters.at(GetClusterIndex(graph, from)), from, search, &path.waypoints.back());
+        AppendLocalPath(search, to, refined);
+    }
+
+    return refined;
+}
+
+std::optional<UnitPath> FindLongPath(PathGraph& graph, const glm::uvec2& start, const glm::uvec2& goal)
+{
+    if (auto path = FindAbstractPath(graph, start, goal))
+    {
+        return RefinePath(graph, path.value());
+    }
+
+    return std::nullopt;
+}
+
+std::unordered_map<glm::uvec2, UnitPath> FindMoveTiles(const Level& level, const UnitMapState& unit_map, const glm::uvec2& tile)
+{
+    auto unit = unit_map.units.at(tile.x, tile.y);
+    return FindMoveTiles(level, unit_map, tile, GetUnitStats(unit.type).movement_range);
+}
+
+std::unordered_map<glm::uvec2, UnitPath> FindMoveTiles(const Level& level, const UnitMapState& unit_map, const glm::uvec2& tile, uint32_t movement_range)
+{
+    std::unordered_map<glm::uvec2, UnitPath> move_tiles {};
+
+    // Flood fill to find available paths, cheapest first since tiles can cost more than one point
+    {
+        auto unit = unit_map.units.at(tile.x, tile.y);
+
+        std::vector<UnitPath> found_paths {};
+        std::unordered_set<glm::ivec2> visited {};
+
+        struct TraversalStep
+        {
+            UnitPath current_path {};
+            uint32_t remaining_range {};
+            uint32_t order {}; // Ties resolve in insertion order, like the breadth first search did
+        };
+
+        auto compare_steps = [](const TraversalStep& lhs, const TraversalStep& rhs)
+        {
+            return std::tie(lhs.remaining_range, rhs.order) < std::tie(rhs.remaining_range, lhs.order);
+        };
+
+        std::priority_queue<TraversalStep, std::vector<TraversalStep>, decltype(compare_steps)> steps { compare_steps };
+        uint32_t step_count = 0;
+
+        TraversalStep first;
+        first.current_path.tiles.emplace_back(tile);
+        first.remaining_range = movement_range;
+        first.order = step_count++;
+
+        steps.emplace(first);
+
+        auto is_outside_level = [](const Level& level, const glm::ivec2& tile_pos)
+        {
+            auto level_size = level.map.getMapGridSize();
+            return tile_pos.x < 0 || tile_pos.x >= (int)level_size.x || tile_pos.y < 0 || tile_pos.y >= (int)level_size.y;
+        };
+
+        auto is_enemy_occupied = [](const UnitMapState& all_units, const glm::ivec2& tile_pos, Unit own_unit)
+        {
+            auto unit = all_units.units.at(tile_pos.x, tile_pos.y);
+            if (unit.health > 0)
+            {
+                return own_unit.team != unit.team;
+            }
+            return false;
+        };
+
+        while (!steps.empty())
+        {
+            auto next = steps.top();
+            steps.pop();
+
+            auto tail = next.current_path.tiles.back();
+
+            if (visited.contains(tail))
+            {
+                continue;
+            }
+
+            visited.emplace(tail);
+            auto success = move_tiles.emplace(tail, next.current_path);
+            assert(success.second); // Ensure we don't overwrite existing paths
+
+            glm::ivec2 dirs[4] = {
+                glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1)
+            };
+
+            for (auto dir : dirs)
+            {
+                auto next_pos = glm::ivec2(tail) + dir;
+
+                if (is_outside_level(level, next_pos))
+                    continue;
+
+                uint32_t move_cost = level.terrain.at(next_pos.x, next_pos.y).move_cost;
+
+                if (move_cost == 0 || move_cost > next.remaining_range)
+                    continue;
+                if (is_enemy_occupied(unit_map, next_pos, unit))
+                    continue;
+
+                TraversalStep new_step {};
+                new_step.current_path = next.current_path;
+                new_step.current_path.tiles.emplace_back(next_pos);
+                new_step.remaining_range = next.remaining_range - move_cost;
+                new_step.order = step_count++;
+
+                steps.emplace(new_step);
+            }
+        }
+    }
+
+    return move_tiles;
+}
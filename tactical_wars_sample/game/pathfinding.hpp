@@ -0,0 +1,92 @@
+#pragma once
+#include <game/level.hpp>
+#include <game/unit.hpp>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Hierarchical pathfinding (HPA*) over the level travel costs.
+// The map is split into square clusters, entrances are placed along cluster borders
+// and connected with precomputed intra-cluster costs. Long queries search this small
+// abstract graph and only refine the tile path for the segments that are requested.
+
+constexpr uint32_t INVALID_PATH_NODE = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t UNREACHABLE_PATH_COST = std::numeric_limits<uint32_t>::max();
+
+struct UnitPath
+{
+    std::vector<glm::uvec2> tiles;
+};
+
+struct PathGraphEdge
+{
+    uint32_t target {};
+    uint32_t cost {};
+};
+
+struct PathGraphNode
+{
+    glm::uvec2 tile {};
+    uint32_t cluster = INVALID_PATH_NODE;
+    uint32_t partner = INVALID_PATH_NODE; // Entrance node on the other side of the border
+    std::vector<PathGraphEdge> edges {}; // Intra-cluster edges
+};
+
+struct PathCluster
+{
+    glm::uvec2 origin {};
+    glm::uvec2 size {};
+    std::vector<uint32_t> nodes {};
+    bool dirty = false;
+};
+
+struct PathGraph
+{
+    uint32_t cluster_size {};
+    glm::uvec2 grid_size {};
+    glm::uvec2 cluster_grid_size {};
+
+    tpp::Array2D<uint8_t> terrain_costs {}; // Cost to enter a tile, 0 means impassable
+    tpp::Array2D<uint8_t> blockers {}; // Dynamic blockers (units) per tile
+
+    std::vector<PathCluster> clusters {};
+    std::vector<std::vector<uint32_t>> borders {}; // Two per cluster: east and south
+    std::vector<PathGraphNode> nodes {};
+    std::vector<uint32_t> free_nodes {};
+    std::vector<uint32_t> dirty_clusters {};
+
+    // Abstract search scratch, reused between queries
+    std::vector<uint32_t> search_cost {};
+    std::vector<uint32_t> search_parent {};
+    std::vector<uint32_t> search_query_edges {}; // Edges into the temporary nodes of a query, per node
+    std::vector<uint32_t> search_stamp {};
+    uint32_t current_stamp = 0;
+};
+
+struct AbstractPath
+{
+    std::vector<glm::uvec2> waypoints {};
+    uint32_t cost {};
+};
+
+// Tiles reachable this turn within the unit movement range, with the path to each of them
+std::unordered_map<glm::uvec2, UnitPath> FindMoveTiles(const Level& level, const UnitMapState& unit_map, const glm::uvec2& tile);
+std::unordered_map<glm::uvec2, UnitPath> FindMoveTiles(const Level& level, const UnitMapState& unit_map, const glm::uvec2& tile, uint32_t movement_range);
+
+PathGraph BuildPathGraph(const Level& level, uint32_t cluster_size = 16);
+
+// Terrain and blocker changes only mark the touched cluster dirty,
+// the abstract graph is repaired lazily on the next query.
+// Blocked tiles can be left but not entered, except for the goal of a query.
+void SetPathTileCost(PathGraph& graph, const glm::uvec2& tile, uint8_t cost);
+void SetPathTileBlocked(PathGraph& graph, const glm::uvec2& tile, bool blocked);
+// Blocks the tiles of living units, only the clusters of tiles that changed are repaired
+void SyncPathGraphBlockers(PathGraph& graph, const UnitMapState& unit_map);
+// Same for only the tiles whose units changed, without scanning the map
+void UpdatePathGraphBlockers(PathGraph& graph, const UnitMapState& unit_map, const std::vector<glm::uvec2>& changed_tiles);
+void RepairPathGraph(PathGraph& graph);
+
+std::optional<AbstractPath> FindAbstractPath(PathGraph& graph, const glm::uvec2& start, const glm::uvec2& goal);
+UnitPath RefinePath(const PathGraph& graph, const AbstractPath& path, size_t first_waypoint = 0, size_t max_segments = SIZE_MAX);
+std::optional<UnitPath> FindLongPath(PathGraph& graph, const glm::uvec2& start, const glm::uvec2& goal);
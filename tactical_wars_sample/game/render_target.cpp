@@ -0,0 +1,91 @@
+#include <game/render_target.hpp>
+
+SDL_Renderer* FindWindowRenderer(const std::string& title)
+{
+    SDL_Renderer* sdl_renderer = nullptr;
+    int window_count = 0;
+
+    if (SDL_Window** windows = SDL_GetWindows(&window_count))
+    {
+        for (int i = 0; i < window_count && !sdl_renderer; ++i)
+        {
+            if (title == SDL_GetWindowTitle(windows[i]))
+            {
+                sdl_renderer = SDL_GetRenderer(windows[i]);
+            }
+        }
+
+        SDL_free(windows);
+    }
+
+    return sdl_renderer;
+}
+
+RenderPixels ReadRenderPixels(SDL_Renderer* sdl_renderer, const glm::uvec2& size)
+{
+    RenderPixels pixels { SDL_RenderReadPixels(sdl_renderer, nullptr) };
+
+    if (!pixels || uint32_t(pixels->w) != size.x || uint32_t(pixels->h) != size.y)
+    {
+        return nullptr;
+    }
+
+    return pixels;
+}
+
+bool ConvertRenderPixels(const RenderPixels& pixels, uint8_t* rgba_pixels)
+{
+    return pixels
+        && SDL_ConvertPixels(pixels->w, pixels->h, pixels->format, pixels->pixels, pixels->pitch, SDL_PIXELFORMAT_RGBA32, rgba_pixels, pixels->w * 4);
+}
+
+RenderTarget CreateRenderTarget(SDL_Renderer* sdl_renderer, const glm::uvec2& size)
+{
+    if (!sdl_renderer || size.x == 0 || size.y == 0)
+    {
+        return nullptr;
+    }
+
+    RenderTarget target { SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, size.x, size.y) };
+
+    if (target)
+    {
+        // Drawing blended quads over transparent texels leaves colours multiplied by their alpha
+        SDL_SetTextureBlendMode(target.get(), SDL_BLENDMODE_BLEND_PREMULTIPLIED);
+    }
+
+    return target;
+}
+
+SDL_Texture* BeginRenderTarget(SDL_Renderer* sdl_renderer, const RenderTarget& target)
+{
+    SDL_Texture* previous_target = SDL_GetRenderTarget(sdl_renderer);
+
+    SDL_SetRenderTarget(sdl_renderer, target.get());
+    SDL_SetRenderDrawColor(sdl_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(sdl_renderer);
+
+    return previous_target;
+}
+
+void EndRenderTarget(SDL_Renderer* sdl_renderer, SDL_Texture* previous_target)
+{
+    SDL_SetRenderTarget(sdl_renderer, previous_target);
+}
+
+StreamingTexture CreateStreamingTexture(SDL_Renderer* sdl_renderer, const glm::uvec2& size, SDL_PixelFormat format)
+{
+    if (!sdl_renderer || size.x == 0 || size.y == 0)
+    {
+        return nullptr;
+    }
+
+    StreamingTexture texture { SDL_CreateTexture(sdl_renderer, format, SDL_TEXTUREACCESS_STREAMING, size.x, size.y) };
+
+    if (texture)
+    {
+        SDL_SetTextureScaleMode(texture.get(), SDL_SCALEMODE_NEAREST);
+    }
+
+    return texture;
+}
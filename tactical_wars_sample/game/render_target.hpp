@@ -0,0 +1,42 @@
+#pragma once
+#include <memory>
+#include <resources/texture.hpp>
+#include <string>
+
+// Plain SDL for what Renderer doesn't wrap: reading the frame back and drawing into textures.
+// Renderer draws to whatever target is set on the SDL renderer of the window.
+
+// SDL renderer of the window with this title, null when there is none.
+// Looked up once when the window is created and passed to everything that draws with plain SDL.
+SDL_Renderer* FindWindowRenderer(const std::string& title);
+
+struct SdlSurfaceDeleter
+{
+    void operator()(SDL_Surface* surface) const { SDL_DestroySurface(surface); }
+};
+
+// The render target as SDL read it back, in the format of the renderer
+using RenderPixels = std::unique_ptr<SDL_Surface, SdlSurfaceDeleter>;
+
+// Reads the current render target without converting it, null when the target isn't size pixels large
+RenderPixels ReadRenderPixels(SDL_Renderer* sdl_renderer, const glm::uvec2& size);
+// Converts to RGBA, safe on any thread so the readback is all that waits on the main thread
+bool ConvertRenderPixels(const RenderPixels& pixels, uint8_t* rgba_pixels);
+
+struct SdlTextureDeleter
+{
+    void operator()(SDL_Texture* texture) const { SDL_DestroyTexture(texture); }
+};
+
+// Premultiplied alpha, it starts transparent and is drawn over the frame
+using RenderTarget = std::unique_ptr<SDL_Texture, SdlTextureDeleter>;
+// Written from the CPU with SDL_UpdateTexture, created once per size instead of once per upload
+using StreamingTexture = std::unique_ptr<SDL_Texture, SdlTextureDeleter>;
+
+RenderTarget CreateRenderTarget(SDL_Renderer* sdl_renderer, const glm::uvec2& size);
+// Redirects drawing into the target and clears it, returns the previous target for EndRenderTarget
+SDL_Texture* BeginRenderTarget(SDL_Renderer* sdl_renderer, const RenderTarget& target);
+void EndRenderTarget(SDL_Renderer* sdl_renderer, SDL_Texture* previous_target);
+
+// Sampled with nearest filtering, null when the renderer can't create it
+StreamingTexture CreateStreamingTexture(SDL_Renderer* sdl_renderer, const glm::uvec2& size, SDL_PixelFormat format);
@@ -0,0 +1,159 @@
+#include <game/resource_cache.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+
+static std::string MakePathKey(std::string_view kind, const std::string& path)
+{
+    std::error_code error {};
+    auto canonical = std::filesystem::weakly_canonical(path, error);
+    return std::format("{}:{}", kind, error ? path : canonical.string());
+}
+
+static std::string MakeImageKey(std::string_view kind, uint64_t image_hash)
+{
+    return std::format("{}:{:016x}", kind, image_hash);
+}
+
+static size_t& GetResidentBytes(ResourceCache& cache, ResourcePool pool)
+{
+    return pool == ResourcePool::GPU ? cache.gpu_resident_bytes : cache.cpu_resident_bytes;
+}
+
+static size_t GetTextureBytes(const Texture& texture)
+{
+    auto size = texture.GetSize();
+    return size_t(size.x) * size.y * 4;
+}
+
+template <typename T>
+static std::shared_ptr<T> FindResource(ResourceCache& cache, const std::string& key)
+{
+    auto it = cache.entries.find(key);
+
+    if (it == cache.entries.end())
+    {
+        return nullptr;
+    }
+
+    it->second.last_use = ++cache.use_counter;
+    return std::static_pointer_cast<T>(it->second.resource);
+}
+
+template <typename T>
+static std::shared_ptr<T> InsertResource(ResourceCache& cache, const std::string& key, std::shared_ptr<T> resource, ResourcePool pool, size_t size_bytes)
+{
+    if (!resource)
+    {
+        return nullptr;
+    }
+
+    auto& entry = cache.entries[key];
+    entry.resource = std::const_pointer_cast<std::remove_const_t<T>>(resource);
+    entry.pool = pool;
+    entry.size_bytes = size_bytes;
+    entry.last_use = ++cache.use_counter;
+
+    GetResidentBytes(cache, pool) += size_bytes;
+    TrimResourceCache(cache);
+    return resource;
+}
+
+std::shared_ptr<Texture> LoadCachedTexture(ResourceCache& cache, Renderer& renderer, const std::string& path)
+{
+    auto key = MakePathKey("texture", path);
+
+    if (auto texture = FindResource<Texture>(cache, key))
+    {
+        return texture;
+    }
+
+    auto texture = Texture::SharedFromFile(renderer, path);
+    return InsertResource(cache, key, texture, ResourcePool::GPU, texture ? GetTextureBytes(*texture) : 0);
+}
+
+std::shared_ptr<Font> LoadCachedFont(ResourceCache& cache, Renderer& renderer, const std::string& path, const FontLoadInfo& info)
+{
+    // Codepoint ranges change the atlas, so they are part of the key
+    auto key = MakePathKey("font", path);
+
+    for (auto& [first, last] : info.codepoint_ranges)
+    {
+        key += std::format(":{}-{}", first, last);
+    }
+
+    if (auto font = FindResource<Font>(cache, key))
+    {
+        return font;
+    }
+
+    // The glyph atlas is all the GPU memory a font holds
+    auto font = Font::SharedFromFile(renderer, path, info);
+    return InsertResource(cache, key, font, ResourcePool::GPU, font ? GetTextureBytes(font->GetAtlas().GetTexture()) : 0);
+}
+
+std::shared_ptr<Texture> AcquireImageTexture(ResourceCache& cache, Renderer& renderer, uint64_t image_hash, const uint8_t* pixels, const glm::uvec2& size)
+{
+    auto key = MakeImageKey("texture", image_hash);
+
+    if (auto texture = FindResource<Texture>(cache, key))
+    {
+        return texture;
+    }
+
+    auto texture = std::make_shared<Texture>(Texture::FromData(renderer, pixels, size).value());
+    return InsertResource(cache, key, texture, ResourcePool::GPU, size_t(size.x) * size.y * 4);
+}
+
+std::shared_ptr<const std::vector<uint8_t>> AcquireImagePixels(ResourceCache& cache, uint64_t image_hash, const uint8_t* pixels, const glm::uvec2& size)
+{
+    auto key = MakeImageKey("pixels", image_hash);
+
+    if (auto data = FindResource<const std::vector<uint8_t>>(cache, key))
+    {
+        return data;
+    }
+
+    size_t byte_count = size_t(size.x) * size.y * 4;
+    auto data = std::make_shared<const std::vector<uint8_t>>(pixels, pixels + byte_count);
+    return InsertResource(cache, key, data, ResourcePool::CPU, byte_count);
+}
+
+void TrimResourceCache(ResourceCache& cache)
+{
+    auto over_budget = [&](ResourcePool pool)
+    {
+        return pool == ResourcePool::GPU
+            ? cache.gpu_resident_bytes > cache.gpu_budget_bytes
+            : cache.cpu_resident_bytes > cache.cpu_budget_bytes;
+    };
+
+    if (!over_budget(ResourcePool::GPU) && !over_budget(ResourcePool::CPU))
+    {
+        return;
+    }
+
+    // Only entries without outside handles can go
+    std::vector<decltype(cache.entries)::iterator> candidates {};
+
+    for (auto it = cache.entries.begin(); it != cache.entries.end(); ++it)
+    {
+        if (it->second.resource.use_count() == 1 && over_budget(it->second.pool))
+        {
+            candidates.emplace_back(it);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](auto lhs, auto rhs)
+        { return lhs->second.last_use < rhs->second.last_use; });
+
+    for (auto it : candidates)
+    {
+        if (!over_budget(it->second.pool))
+            continue;
+
+        GetResidentBytes(cache, it->second.pool) -= it->second.size_bytes;
+        cache.entries.erase(it);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <memory>
+#include <resources/font.hpp>
+#include <resources/texture.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shared resources keyed by canonical file path or by image content hash.
+// Handles are shared pointers: while any handle is alive the entry stays resident. Entries nobody
+// holds are kept for reuse, for example across level switches, and evicted least recently used
+// first once their memory pool goes over budget.
+
+enum class ResourcePool : uint8_t
+{
+    GPU,
+    CPU
+};
+
+struct ResourceCacheEntry
+{
+    std::shared_ptr<void> resource {};
+    ResourcePool pool = ResourcePool::GPU;
+    size_t size_bytes {}; // RGBA texels of textures and font atlases, bytes of CPU images
+    uint64_t last_use {};
+};
+
+struct ResourceCache
+{
+    std::unordered_map<std::string, ResourceCacheEntry> entries {};
+
+    size_t gpu_budget_bytes = size_t(256) << 20;
+    size_t cpu_budget_bytes = size_t(256) << 20;
+    size_t gpu_resident_bytes {};
+    size_t cpu_resident_bytes {};
+
+    uint64_t use_counter {};
+};
+
+std::shared_ptr<Texture> LoadCachedTexture(ResourceCache& cache, Renderer& renderer, const std::string& path);
+std::shared_ptr<Font> LoadCachedFont(ResourceCache& cache, Renderer& renderer, const std::string& path, const FontLoadInfo& info);
+
+// RGBA images, the pixels are only read when the hash is not resident yet
+std::shared_ptr<Texture> AcquireImageTexture(ResourceCache& cache, Renderer& renderer, uint64_t image_hash, const uint8_t* pixels, const glm::uvec2& size);
+std::shared_ptr<const std::vector<uint8_t>> AcquireImagePixels(ResourceCache& cache, uint64_t image_hash, const uint8_t* pixels, const glm::uvec2& size);
+
+// Evicts unreferenced entries, least recently used first, until both pools fit their budgets
+void TrimResourceCache(ResourceCache& cache);
@@ -0,0 +1,316 @@
+#include <game/save_game.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+static_assert(std::is_trivially_copyable_v<SaveHeader>);
+static_assert(std::is_trivially_copyable_v<SaveUnit>);
+static_assert(std::is_trivially_copyable_v<SaveTile>);
+
+// No implicit padding, every byte written comes from a field
+static_assert(sizeof(SaveHeader) == 64);
+static_assert(sizeof(Unit) == 5 && sizeof(SaveUnit) == 16);
+static_assert(sizeof(SaveTile) == 8);
+
+constexpr size_t SAVE_ALIGNMENT = 8;
+
+// Byte offsets of every section, derived from the header counts alone
+struct SaveLayout
+{
+    size_t teams {};
+    size_t units {};
+    size_t cursor_path {};
+    size_t rng_state {};
+    size_t map_path {};
+    size_t total {};
+};
+
+static SaveLayout CalculateSaveLayout(const SaveHeader& header)
+{
+    SaveLayout layout {};
+    size_t offset = sizeof(SaveHeader);
+
+    auto add_section = [&](size_t bytes)
+    {
+        offset = (offset + SAVE_ALIGNMENT - 1) & ~(SAVE_ALIGNMENT - 1);
+        size_t start = offset;
+        offset += bytes;
+        return start;
+    };
+
+    layout.teams = add_section(size_t(header.team_count) * sizeof(UnitTeam));
+    layout.units = add_section(size_t(header.unit_count) * sizeof(SaveUnit));
+    layout.cursor_path = add_section(size_t(header.cursor_path_size) * sizeof(SaveTile));
+    layout.rng_state = add_section(header.rng_state_size);
+    layout.map_path = add_section(header.map_path_size);
+    layout.total = offset;
+    return layout;
+}
+
+template <typename T>
+static std::span<const T> ViewSection(std::span<const uint8_t> data, size_t offset, uint32_t count)
+{
+    return { reinterpret_cast<const T*>(data.data() + offset), count };
+}
+
+std::vector<uint8_t> SerializeGame(const GameState& game_state, const Cursor& cursor)
+{
+    auto& level = *game_state.current_level;
+    auto& units = game_state.unit_state.units;
+
+    std::ostringstream rng_stream {};
+    rng_stream << game_state.rng;
+    std::string rng_state = rng_stream.str();
+
+    SaveHeader header {};
+    std::memcpy(header.magic, SAVE_MAGIC, sizeof(SAVE_MAGIC));
+    header.version = SAVE_VERSION;
+    header.level_hash = level.content_hash;
+    header.grid_width = level.map.getMapGridSize().x;
+    header.grid_height = level.map.getMapGridSize().y;
+    header.turn_index = game_state.turn_index;
+    header.team_count = game_state.teams.size();
+    header.rng_state_size = rng_state.size();
+    header.map_path_size = level.map_path.size();
+
+    for (auto& unit : units)
+    {
+        header.unit_count += unit.health > 0;
+    }
+
+    const UnitPath* cursor_path = nullptr;
+
+    if (auto* selected = std::get_if<SelectedCursorState>(&cursor.state))
+    {
+        header.cursor_kind = SaveCursorKind::SELECTED;
+        header.cursor_tile_x = selected->selected_unit_tile.x;
+        header.cursor_tile_y = selected->selected_unit_tile.y;
+    }
+    else if (auto* confirmation = std::get_if<ConfirmationCursorState>(&cursor.state))
+    {
+        header.cursor_kind = SaveCursorKind::CONFIRMATION;
+        header.cursor_tile_x = confirmation->selected_unit_tile.x;
+        header.cursor_tile_y = confirmation->selected_unit_tile.y;
+        header.cursor_interpolation = confirmation->interpolation;
+        header.cursor_path_size = confirmation->selected_path.tiles.size();
+        cursor_path = &confirmation->selected_path;
+    }
+
+    auto layout = CalculateSaveLayout(header);
+    std::vector<uint8_t> data(layout.total, 0);
+
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + layout.teams, game_state.teams.data(), game_state.teams.size() * sizeof(UnitTeam));
+    std::memcpy(data.data() + layout.rng_state, rng_state.data(), rng_state.size());
+    std::memcpy(data.data() + layout.map_path, level.map_path.data(), level.map_path.size());
+
+    auto* unit_out = data.data() + layout.units;
+
+    for (auto it = units.begin(); it != units.end(); ++it)
+    {
+        if ((*it).health <= 0)
+            continue;
+
+        SaveUnit saved { it.getIndices().x, it.getIndices().y, *it };
+        std::memcpy(unit_out, &saved, sizeof(saved));
+        unit_out += sizeof(saved);
+    }
+
+    if (cursor_path)
+    {
+        auto* tile_out = data.data() + layout.cursor_path;
+
+        for (auto tile : cursor_path->tiles)
+        {
+            SaveTile saved { tile.x, tile.y };
+            std::memcpy(tile_out, &saved, sizeof(saved));
+            tile_out += sizeof(saved);
+        }
+    }
+
+    return data;
+}
+
+std::future<bool> SaveGameAsync(const GameState& game_state, const Cursor& cursor, const std::string& path)
+{
+    auto data = SerializeGame(game_state, cursor);
+
+    return std::async(std::launch::async, [data = std::move(data), path]()
+        {
+            std::error_code error {};
+            auto directory = std::filesystem::path(path).parent_path();
+
+            if (!directory.empty())
+            {
+                std::filesystem::create_directories(directory, error);
+            }
+
+            // Renamed over the old save once complete, a crash never leaves a half written file
+            auto temp_path = path + ".tmp";
+
+            {
+                std::ofstream file { temp_path, std::ios::binary | std::ios::trunc };
+                file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+                if (!file)
+                {
+                    return false;
+                }
+            }
+
+            std::filesystem::rename(temp_path, path, error);
+            return !error;
+        });
+}
+
+std::optional<SaveView> ViewSaveData(std::span<const uint8_t> data)
+{
+    if (data.size() < sizeof(SaveHeader) || reinterpret_cast<uintptr_t>(data.data()) % SAVE_ALIGNMENT != 0)
+    {
+        return std::nullopt;
+    }
+
+    auto* header = reinterpret_cast<const SaveHeader*>(data.data());
+
+    if (std::memcmp(header->magic, SAVE_MAGIC, sizeof(SAVE_MAGIC)) != 0 || header->version != SAVE_VERSION)
+    {
+        return std::nullopt;
+    }
+
+    auto layout = CalculateSaveLayout(*header);
+
+    if (layout.total > data.size())
+    {
+        return std::nullopt;
+    }
+
+    SaveView view {};
+    view.header = header;
+    view.teams = ViewSection<UnitTeam>(data, layout.teams, header->team_count);
+    view.units = ViewSection<SaveUnit>(data, layout.units, header->unit_count);
+    view.cursor_path = ViewSection<SaveTile>(data, layout.cursor_path, header->cursor_path_size);
+    view.rng_state = { reinterpret_cast<const char*>(data.data() + layout.rng_state), header->rng_state_size };
+    view.map_path = { reinterpret_cast<const char*>(data.data() + layout.map_path), header->map_path_size };
+    return view;
+}
+
+static bool IsValidTeam(UnitTeam team)
+{
+    return team == UnitTeam::RED || team == UnitTeam::BLUE;
+}
+
+// Only living units are stored
+static bool IsValidUnit(const Unit& unit)
+{
+    // Read as a byte, a bool holding anything but 0 or 1 can't be read as a bool
+    uint8_t facing_right {};
+    std::memcpy(&facing_right, &unit.facingRight, sizeof(facing_right));
+
+    return IsValidTeam(unit.team)
+        && static_cast<uint32_t>(unit.type) < UNIT_TYPE_COUNT
+        && unit.state <= UnitState::USED
+        && facing_right <= 1
+        && unit.health > 0;
+}
+
+bool ApplySaveView(const SaveView& view, GameState& game_state, Cursor& cursor)
+{
+    auto& header = *view.header;
+    auto& level = *game_state.current_level;
+    auto grid_size = level.map.getMapGridSize();
+
+    auto in_bounds = [&](uint32_t x, uint32_t y)
+    {
+        return x < grid_size.x && y < grid_size.y;
+    };
+
+    if (header.level_hash != level.content_hash || header.grid_width != grid_size.x || header.grid_height != grid_size.y || view.teams.empty())
+    {
+        return false;
+    }
+
+    for (auto team : view.teams)
+    {
+        if (!IsValidTeam(team))
+            return false;
+    }
+
+    for (auto& saved : view.units)
+    {
+        if (!in_bounds(saved.x, saved.y) || !IsValidUnit(saved.unit))
+            return false;
+    }
+
+    for (auto& tile : view.cursor_path)
+    {
+        if (!in_bounds(tile.x, tile.y))
+            return false;
+    }
+
+    std::mt19937_64 rng {};
+    std::istringstream rng_stream { std::string(view.rng_state) };
+    rng_stream >> rng;
+
+    if (rng_stream.fail())
+    {
+        return false;
+    }
+
+    game_state.unit_state = SetupUnitMapState(level);
+
+    for (auto& saved : view.units)
+    {
+        game_state.unit_state.units.at(saved.x, saved.y) = saved.unit;
+    }
+
+    game_state.teams.assign(view.teams.begin(), view.teams.end());
+    game_state.turn_index = header.turn_index;
+    game_state.rng = rng;
+
+    glm::uvec2 cursor_tile = { header.cursor_tile_x, header.cursor_tile_y };
+    cursor.state = DefaultCursorState {};
+
+    if (header.cursor_kind == SaveCursorKind::SELECTED && in_bounds(cursor_tile.x, cursor_tile.y))
+    {
+        cursor.state = CalculateSelectedCursorState(game_state, cursor_tile);
+    }
+    else if (header.cursor_kind == SaveCursorKind::CONFIRMATION && !view.cursor_path.empty() && in_bounds(cursor_tile.x, cursor_tile.y))
+    {
+        ConfirmationCursorState state {};
+        state.interpolation = header.cursor_interpolation;
+        state.selected_unit_tile = cursor_tile;
+
+        for (auto& tile : view.cursor_path)
+        {
+            state.selected_path.tiles.emplace_back(tile.x, tile.y);
+        }
+
+        cursor.state = std::move(state);
+    }
+
+    return true;
+}
+
+bool LoadGame(const std::string& path, GameState& game_state, Cursor& cursor)
+{
+    std::ifstream file { path, std::ios::binary | std::ios::ate };
+
+    if (!file)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> data(size_t(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+    if (!file)
+    {
+        return false;
+    }
+
+    auto view = ViewSaveData(data);
+    return view && ApplySaveView(view.value(), game_state, cursor);
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <game/cursor.hpp>
+#include <future>
+#include <span>
+#include <string_view>
+
+// Versioned binary match save. A fixed size header is followed by flat sections, each 8 byte
+// aligned, so a loaded file is read in place. Native byte order. The level is referenced by
+// its content hash and has to be loaded before applying a save.
+
+constexpr char SAVE_MAGIC[4] = { 'T', 'W', 'S', 'V' };
+constexpr uint32_t SAVE_VERSION = 1;
+
+enum class SaveCursorKind : uint8_t
+{
+    NONE,
+    SELECTED,
+    CONFIRMATION
+};
+
+struct SaveHeader
+{
+    char magic[4] {};
+    uint32_t version {};
+    uint64_t level_hash {};
+    uint32_t grid_width {};
+    uint32_t grid_height {};
+    uint32_t turn_index {};
+
+    uint32_t team_count {};
+    uint32_t unit_count {};
+    uint32_t rng_state_size {};
+    uint32_t map_path_size {};
+
+    SaveCursorKind cursor_kind = SaveCursorKind::NONE;
+    uint8_t padding[3] {}; // Written as zeros, the struct is copied to disk byte for byte
+    uint32_t cursor_tile_x {};
+    uint32_t cursor_tile_y {};
+    float cursor_interpolation {};
+    uint32_t cursor_path_size {};
+};
+
+// Only living units are stored
+struct SaveUnit
+{
+    uint32_t x {};
+    uint32_t y {};
+    Unit unit {};
+    uint8_t padding[3] {};
+};
+
+struct SaveTile
+{
+    uint32_t x {};
+    uint32_t y {};
+};
+
+// Points into the loaded bytes, nothing is copied until ApplySaveView
+struct SaveView
+{
+    const SaveHeader* header {};
+    std::span<const UnitTeam> teams {};
+    std::span<const SaveUnit> units {};
+    std::span<const SaveTile> cursor_path {};
+    std::string_view rng_state {};
+    std::string_view map_path {};
+};
+
+std::vector<uint8_t> SerializeGame(const GameState& game_state, const Cursor& cursor);
+
+// Serializes on the calling thread, so the state can keep changing, and writes the file on a
+// background thread. The future holds whether the file was written.
+std::future<bool> SaveGameAsync(const GameState& game_state, const Cursor& cursor, const std::string& path);
+
+// Validates the layout without copying. The bytes must outlive the view and be 8 byte aligned.
+std::optional<SaveView> ViewSaveData(std::span<const uint8_t> data);
+
+// Fails without touching the game when the save belongs to another level,
+// or holds a tile out of bounds or a team, unit type or state this build doesn't know
+bool ApplySaveView(const SaveView& view, GameState& game_state, Cursor& cursor);
+bool LoadGame(const std::string& path, GameState& game_state, Cursor& cursor);
@@ -1,5 +1,35 @@
+#pragma once
 #include <resources/font.hpp>
 
+// Fills layout with the pen position of every glyph. Only reads glyph metrics, so any type
+// with the metric getters of Font can stand in for it, layout never needs a renderer.
+template <typename GlyphSource>
+void LayoutText(std::vector<CodepointDraw>& layout, const GlyphSource& font, const unicode::String& text, const glm::vec2& position, float text_scale)
+{
+    auto font_metrics = font.GetFontMetrics();
+    glm::vec2 pen_position = position;
+
+    layout.clear();
+
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        auto glyph = font.GetCodepointInfo(text[i]);
+        float kerning = i + 1 < text.size() ? font.GetKerning(text[i], text[i + 1]) : 0.0f;
+
+        glm::vec2 glyph_draw_offset = glm::vec2 {
+            glyph.left_bearing,
+            (glyph.offset.y + font_metrics.ascent)
+        } * text_scale;
+
+        CodepointDraw codepoint_draw {};
+        codepoint_draw.atlas_index = glyph.atlas_index;
+        codepoint_draw.offset = pen_position + glyph_draw_offset;
+
+        layout.emplace_back(codepoint_draw);
+        pen_position.x += (glyph.advance + kerning) * text_scale;
+    }
+}
+
 void DrawText(
     Renderer& renderer,
     const Font& font,
@@ -1,15 +1,171 @@
 #include <game/tileset_data.hpp>
 
-TileSetDrawData CreateTileSetDrawData(Renderer& renderer, tpp::TileSet& tileset)
+static glm::u8vec4 CalculateAverageColour(const uint8_t* pixels, const glm::uvec2& image_size, const glm::uvec2& start, const glm::uvec2& size)
+{
+    // Alpha weighted, so transparent pixels do not darken the result
+    glm::uvec4 sum {};
+
+    for (uint32_t y = start.y; y < start.y + size.y; ++y)
+    {
+        for (uint32_t x = start.x; x < start.x + size.x; ++x)
+        {
+            const uint8_t* pixel = pixels + (y * image_size.x + x) * 4;
+
+            sum.x += pixel[0] * pixel[3];
+            sum.y += pixel[1] * pixel[3];
+            sum.z += pixel[2] * pixel[3];
+            sum.w += pixel[3];
+        }
+    }
+
+    if (sum.w == 0)
+    {
+        return glm::u8vec4 { 0, 0, 0, 0 };
+    }
+
+    uint32_t pixel_count = size.x * size.y;
+    return glm::u8vec4 { sum.x / sum.w, sum.y / sum.w, sum.z / sum.w, sum.w / pixel_count };
+}
+
+static TileAlpha CalculateTileAlpha(const uint8_t* pixels, const glm::uvec2& image_size, const glm::uvec2& start, const glm::uvec2& size)
+{
+    bool any_visible = false;
+    bool all_opaque = true;
+
+    for (uint32_t y = start.y; y < start.y + size.y; ++y)
+    {
+        for (uint32_t x = start.x; x < start.x + size.x; ++x)
+        {
+            uint8_t alpha = pixels[(y * image_size.x + x) * 4 + 3];
+
+            any_visible |= alpha != 0;
+            all_opaque &= alpha == 255;
+        }
+    }
+
+    if (all_opaque)
+    {
+        return TileAlpha::FULLY_OPAQUE;
+    }
+
+    return any_visible ? TileAlpha::MIXED : TileAlpha::FULLY_TRANSPARENT;
+}
+
+void AnalyseTileSetImage(tpp::TileSet& tileset, TileSetDrawData& draw_data)
+{
+    auto& image = tileset.getImage();
+    auto image_size = glm::uvec2 { image.getSize().x, image.getSize().y };
+    auto* pixels = reinterpret_cast<const uint8_t*>(image.getData());
+
+    draw_data.tile_colours.resize(tileset.getTileCount());
+    draw_data.tile_alpha.resize(tileset.getTileCount(), TileAlpha::MIXED);
+
+    for (uint32_t i = 0; i < tileset.getTileCount(); ++i)
+    {
+        if (auto rect = tileset.getTileRect(i))
+        {
+            glm::uvec2 start = { rect->start.x, rect->start.y };
+            glm::uvec2 size = { rect->size.x, rect->size.y };
+
+            draw_data.tile_colours.at(i) = CalculateAverageColour(pixels, image_size, start, size);
+            draw_data.tile_alpha.at(i) = CalculateTileAlpha(pixels, image_size, start, size);
+        }
+    }
+
+    draw_data.image_hash = HashTileSetImage(tileset);
+}
+
+TileSetDrawData CreateTileSetDrawData(Renderer& renderer, ResourceCache& cache, tpp::TileSet& tileset, bool keep_cpu_pixels)
 {
     TileSetDrawData draw_data {};
 
     auto& image = tileset.getImage();
+    auto* pixels = reinterpret_cast<const uint8_t*>(image.getData());
     auto image_size = glm::uvec2 { image.getSize().x, image.getSize().y };
 
-    draw_data.spritesheet_texture = Texture::FromData(renderer, image.getData(), image_size).value();
+    // Identical spritesheets, also from other maps or tilesets, share one upload
+    AnalyseTileSetImage(tileset, draw_data);
+    draw_data.spritesheet_texture = AcquireImageTexture(cache, renderer, draw_data.image_hash, pixels, image_size);
+
+    if (keep_cpu_pixels)
+    {
+        draw_data.image_size = image_size;
+        draw_data.cpu_pixels = AcquireImagePixels(cache, draw_data.image_hash, pixels, image_size);
+    }
+
     image.freeData();
 
+    ResetAnimationStates(tileset, draw_data);
+    return draw_data;
+}
+
+void KeepTileSetPixels(tpp::TileSet& tileset, TileSetDrawData& draw_data)
+{
+    auto& image = tileset.getImage();
+    auto* pixels = reinterpret_cast<const uint8_t*>(image.getData());
+
+    draw_data.image_size = { image.getSize().x, image.getSize().y };
+    draw_data.cpu_pixels = std::make_shared<const std::vector<uint8_t>>(pixels, pixels + size_t(draw_data.image_size.x) * draw_data.image_size.y * 4);
+}
+
+uint64_t HashTileSetImage(tpp::TileSet& tileset)
+{
+    // FNV-1a over the raw RGBA data
+    auto& image = tileset.getImage();
+    auto* pixels = reinterpret_cast<const uint8_t*>(image.getData());
+    size_t byte_count = size_t(image.getSize().x) * image.getSize().y * 4;
+
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < byte_count; ++i)
+    {
+        hash = (hash ^ pixels[i]) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+bool HasSameAnimations(const tpp::TileSet& lhs, const tpp::TileSet& rhs)
+{
+    if (lhs.getTileCount() != rhs.getTileCount())
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < lhs.getTileCount(); ++i)
+    {
+        auto* lhs_anim = lhs.getTileAnimation(i);
+        auto* rhs_anim = rhs.getTileAnimation(i);
+
+        if (!lhs_anim || !rhs_anim)
+        {
+            if (lhs_anim != rhs_anim)
+                return false;
+            continue;
+        }
+
+        if (lhs_anim->frames.size() != rhs_anim->frames.size())
+        {
+            return false;
+        }
+
+        for (size_t f = 0; f < lhs_anim->frames.size(); ++f)
+        {
+            if (lhs_anim->frames.at(f).tile_id != rhs_anim->frames.at(f).tile_id
+                || lhs_anim->frames.at(f).duration_ms != rhs_anim->frames.at(f).duration_ms)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void ResetAnimationStates(const tpp::TileSet& tileset, TileSetDrawData& draw_data)
+{
+    draw_data.animation_states.clear();
+
     for (uint32_t i = 0; i < tileset.getTileCount(); ++i)
     {
         if (auto* anim = tileset.getTileAnimation(i))
@@ -17,13 +173,11 @@ TileSetDrawData CreateTileSetDrawData(Renderer& renderer, tpp::TileSet& tileset)
             draw_data.animation_states[i] = AnimationState {};
         }
     }
-
-    return draw_data;
 }
 
-void UpdateAnimationData(const tpp::TileSet& tileset, TileSetDrawData& tile_set_data, DeltaMS delta)
+void UpdateAnimationStates(const tpp::TileSet& tileset, AnimationStates& animation_states, DeltaMS delta)
 {
-    for (auto& [tile_id, anim_state] : tile_set_data.animation_states)
+    for (auto& [tile_id, anim_state] : animation_states)
     {
         auto* anim = tileset.getTileAnimation(tile_id);
 
@@ -44,7 +198,35 @@ void UpdateAnimationData(const tpp::TileSet& tileset, TileSetDrawData& tile_set_
     }
 }
 
-SDL_FRect GetTileRect(const tpp::TileSet& tileset, const TileSetDrawData& draw_data, uint32_t tile_id)
+void UpdateAnimationData(const tpp::TileSet& tileset, TileSetDrawData& tile_set_data, DeltaMS delta)
+{
+    UpdateAnimationStates(tileset, tile_set_data.animation_states, delta);
+}
+
+TileAlpha GetTileAlpha(const tpp::TileSet& tileset, const TileSetDrawData& draw_data, uint32_t tile_id)
+{
+    auto* anim = tileset.getTileAnimation(tile_id);
+
+    if (!anim || anim->frames.empty())
+    {
+        return draw_data.tile_alpha.at(tile_id);
+    }
+
+    // Animated tiles are only opaque or transparent if every frame is
+    auto alpha = draw_data.tile_alpha.at(anim->frames.front().tile_id);
+
+    for (auto& frame : anim->frames)
+    {
+        if (draw_data.tile_alpha.at(frame.tile_id) != alpha)
+        {
+            return TileAlpha::MIXED;
+        }
+    }
+
+    return alpha;
+}
+
+uint32_t GetAnimatedTileId(const tpp::TileSet& tileset, const TileSetDrawData& draw_data, uint32_t tile_id)
 {
     if (auto it = draw_data.animation_states.find(tile_id); it != draw_data.animation_states.end())
     {
@@ -54,7 +236,12 @@ SDL_FRect GetTileRect(const tpp::TileSet& tileset, const TileSetDrawData& draw_d
         tile_id = anim->frames.at(frame).tile_id;
     }
 
-    auto rect = tileset.getTileRect(tile_id).value();
+    return tile_id;
+}
+
+SDL_FRect GetTileRect(const tpp::TileSet& tileset, const TileSetDrawData& draw_data, uint32_t tile_id)
+{
+    auto rect = tileset.getTileRect(GetAnimatedTileId(tileset, draw_data, tile_id)).value();
 
     SDL_FRect src_rect {
         (float)rect.start.x, (float)rect.start.y, (float)rect.size.x, (float)rect.size.y
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <resources/texture.hpp>
+#include <game/resource_cache.hpp>
 #include <tiledcpp/tiledcpp.hpp>
 #include <unordered_map>
 #include <utility/time.hpp>
@@ -11,12 +11,36 @@ struct AnimationState
     DeltaMS accum {};
 };
 
+enum class TileAlpha : uint8_t
+{
+    FULLY_TRANSPARENT, // Never drawn
+    MIXED,
+    FULLY_OPAQUE // Hides every layer below
+};
+
+using AnimationStates = std::unordered_map<uint32_t, AnimationState>;
+
 struct TileSetDrawData
 {
-    std::unordered_map<uint32_t, AnimationState> animation_states {};
-    Texture spritesheet_texture {};
+    AnimationStates animation_states {};
+    std::vector<glm::u8vec4> tile_colours {}; // Average colour per tile, for the minimap
+    std::vector<TileAlpha> tile_alpha {}; // Coverage of each tile image, ignoring animations
+    uint64_t image_hash {}; // Content hash of the spritesheet, used to skip unchanged reloads
+    std::shared_ptr<Texture> spritesheet_texture {}; // Shared through the resource cache by image hash
+
+    glm::uvec2 image_size {};
+    std::shared_ptr<const std::vector<uint8_t>> cpu_pixels {}; // RGBA copy of the spritesheet, only kept for the CPU compositor
 };
 
-TileSetDrawData CreateTileSetDrawData(Renderer& renderer, tpp::TileSet& tileset);
+TileSetDrawData CreateTileSetDrawData(Renderer& renderer, ResourceCache& cache, tpp::TileSet& tileset, bool keep_cpu_pixels = false);
+// Per tile colours, alpha classes and image hash. Needs the image data, so call before freeData
+void AnalyseTileSetImage(tpp::TileSet& tileset, TileSetDrawData& draw_data);
+void KeepTileSetPixels(tpp::TileSet& tileset, TileSetDrawData& draw_data);
+uint64_t HashTileSetImage(tpp::TileSet& tileset);
+bool HasSameAnimations(const tpp::TileSet& lhs, const tpp::TileSet& rhs);
+void ResetAnimationStates(const tpp::TileSet& tileset, TileSetDrawData& draw_data);
+TileAlpha GetTileAlpha(const tpp::TileSet& tileset, const TileSetDrawData& draw_data, uint32_t tile_id);
+uint32_t GetAnimatedTileId(const tpp::TileSet& tileset, const TileSetDrawData& draw_data, uint32_t tile_id);
 SDL_FRect GetTileRect(const tpp::TileSet& tileset, const TileSetDrawData& draw_data, uint32_t tile_id);
+void UpdateAnimationStates(const tpp::TileSet& tileset, AnimationStates& animation_states, DeltaMS delta);
 void UpdateAnimationData(const tpp::TileSet& tileset, TileSetDrawData& tile_set_data, DeltaMS delta);
\ No newline at end of file
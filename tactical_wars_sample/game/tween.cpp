@@ -0,0 +1,186 @@
+#include <game/fog.hpp>
+#include <game/tween.hpp>
+#include <utility/colours.hpp>
+
+static uint8_t* GetMovingTile(UnitTweens& tweens, const glm::uvec2& tile)
+{
+    if (tile.x >= tweens.grid_size.x || tile.y >= tweens.grid_size.y)
+        return nullptr;
+
+    return &tweens.moving_tiles.at(size_t(tile.y) * tweens.grid_size.x + tile.x);
+}
+
+UnitTweens CreateUnitTweens(const glm::uvec2& grid_size, uint32_t capacity, uint32_t point_capacity)
+{
+    UnitTweens tweens {};
+    tweens.path_points.reserve(point_capacity);
+    tweens.first_point.reserve(capacity);
+    tweens.last_segment.reserve(capacity);
+    tweens.start_time.reserve(capacity);
+    tweens.unit_tiles.reserve(capacity);
+    tweens.progress.reserve(capacity);
+    tweens.positions.reserve(capacity);
+
+    ClearUnitTweens(tweens, grid_size);
+    return tweens;
+}
+
+void ClearUnitTweens(UnitTweens& tweens, const glm::uvec2& grid_size)
+{
+    tweens.path_points.clear();
+    tweens.first_point.clear();
+    tweens.last_segment.clear();
+    tweens.start_time.clear();
+    tweens.unit_tiles.clear();
+    tweens.progress.clear();
+    tweens.positions.clear();
+
+    tweens.time = 0.0f;
+    tweens.grid_size = grid_size;
+    tweens.moving_tiles.assign(size_t(grid_size.x) * grid_size.y, 0);
+}
+
+void AddUnitTween(UnitTweens& tweens, const UnitPath& path, float delay_ms)
+{
+    // A unit that stayed on its tile has nothing to animate
+    if (path.tiles.size() < 2)
+        return;
+
+    tweens.first_point.emplace_back((uint32_t)tweens.path_points.size());
+    tweens.last_segment.emplace_back(float(path.tiles.size() - 1));
+    tweens.start_time.emplace_back(tweens.time + delay_ms);
+    tweens.unit_tiles.emplace_back(path.tiles.back());
+    tweens.progress.emplace_back(0.0f);
+    tweens.positions.emplace_back(path.tiles.front());
+
+    for (auto tile : path.tiles)
+    {
+        tweens.path_points.emplace_back(tile);
+    }
+
+    if (auto* moving = GetMovingTile(tweens, path.tiles.back()))
+    {
+        ++*moving;
+    }
+}
+
+// Moves the path points of the remaining movements to the front, keeping their order
+static void RemoveArrivedTweens(UnitTweens& tweens, size_t first_arrived)
+{
+    size_t count = tweens.first_point.size();
+    size_t kept = first_arrived;
+    size_t point_end = tweens.first_point.at(first_arrived);
+
+    for (size_t i = first_arrived; i < count; ++i)
+    {
+        uint32_t point_count = uint32_t(tweens.last_segment[i]) + 1;
+
+        if (tweens.progress[i] >= tweens.last_segment[i])
+        {
+            if (auto* moving = GetMovingTile(tweens, tweens.unit_tiles[i]))
+            {
+                --*moving;
+            }
+
+            continue;
+        }
+
+        auto points = tweens.path_points.begin() + tweens.first_point[i];
+        std::copy(points, points + point_count, tweens.path_points.begin() + point_end);
+
+        tweens.first_point[kept] = (uint32_t)point_end;
+        tweens.last_segment[kept] = tweens.last_segment[i];
+        tweens.start_time[kept] = tweens.start_time[i];
+        tweens.unit_tiles[kept] = tweens.unit_tiles[i];
+        tweens.progress[kept] = tweens.progress[i];
+        tweens.positions[kept] = tweens.positions[i];
+
+        point_end += point_count;
+        ++kept;
+    }
+
+    // Shrinking keeps the capacity
+    tweens.path_points.resize(point_end);
+    tweens.first_point.resize(kept);
+    tweens.last_segment.resize(kept);
+    tweens.start_time.resize(kept);
+    tweens.unit_tiles.resize(kept);
+    tweens.progress.resize(kept);
+    tweens.positions.resize(kept);
+}
+
+void UpdateUnitTweens(UnitTweens& tweens, DeltaMS delta)
+{
+    tweens.time += delta.count();
+
+    size_t count = tweens.first_point.size();
+    float time = tweens.time;
+    float speed = tweens.speed;
+
+    const float* start_time = tweens.start_time.data();
+    const float* last_segment = tweens.last_segment.data();
+    float* progress = tweens.progress.data();
+
+    // No branches or lookups, compiles to packed min/max
+    for (size_t i = 0; i < count; ++i)
+    {
+        progress[i] = std::min(std::max((time - start_time[i]) * speed, 0.0f), last_segment[i]);
+    }
+
+    const glm::vec2* points = tweens.path_points.data();
+    const uint32_t* first_point = tweens.first_point.data();
+    glm::vec2* positions = tweens.positions.data();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        float segment = std::min(std::floor(progress[i]), last_segment[i] - 1.0f);
+        float t = progress[i] - segment;
+
+        auto from = points[first_point[i] + uint32_t(segment)];
+        auto to = points[first_point[i] + uint32_t(segment) + 1];
+        positions[i] = from + (to - from) * t;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (progress[i] >= last_segment[i])
+        {
+            RemoveArrivedTweens(tweens, i);
+            break;
+        }
+    }
+
+    // Keeps the clock precise over long sessions
+    if (tweens.first_point.empty())
+    {
+        tweens.time = 0.0f;
+    }
+}
+
+uint32_t GetUnitTweenCount(const UnitTweens& tweens)
+{
+    return (uint32_t)tweens.first_point.size();
+}
+
+bool IsUnitTweening(const UnitTweens* tweens, const glm::uvec2& tile)
+{
+    if (!tweens || tile.x >= tweens->grid_size.x || tile.y >= tweens->grid_size.y)
+        return false;
+
+    return tweens->moving_tiles.at(size_t(tile.y) * tweens->grid_size.x + tile.x) != 0;
+}
+
+void DrawUnitTweens(Renderer& renderer, const GameAssets& assets, const UnitMapState& unit_map, const UnitTweens& tweens, const FrameCamera& camera, const FogVisibility* fog)
+{
+    for (size_t i = 0; i < tweens.first_point.size(); ++i)
+    {
+        auto tile = tweens.unit_tiles[i];
+        auto unit = unit_map.units.at(tile.x, tile.y);
+
+        // Killed by a counter attack, or moved somewhere the viewer cannot see
+        if (unit.health <= 0 || IsUnitHidden(fog, tile, unit))
+            continue;
+
+        DrawUnit(renderer, camera, assets, tweens.positions[i], unit_map.map_tile_size, unit, colour::WHITE);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <game/pathfinding.hpp>
+#include <game/unit.hpp>
+
+// Unit movement animations, any number running at once. Stored as parallel arrays, one entry per
+// moving unit, and the path tiles of every movement packed back to back. The update is a straight
+// loop over the active movements, adding one only allocates when a reserved capacity is exceeded.
+// A movement ends on the tile the unit is stored on, that tile is drawn at the animated position.
+struct UnitTweens
+{
+    std::vector<glm::vec2> path_points {};
+
+    std::vector<uint32_t> first_point {};
+    std::vector<float> last_segment {}; // Path length in tiles
+    std::vector<float> start_time {};
+    std::vector<glm::uvec2> unit_tiles {};
+
+    // Written by the update
+    std::vector<float> progress {}; // Tiles travelled
+    std::vector<glm::vec2> positions {};
+
+    float time {}; // Milliseconds since creation
+    float speed = 0.005f; // Tiles per millisecond, same as the move preview
+
+    glm::uvec2 grid_size {};
+    std::vector<uint8_t> moving_tiles {}; // Movements ending on each tile
+};
+
+UnitTweens CreateUnitTweens(const glm::uvec2& grid_size, uint32_t capacity = 64, uint32_t point_capacity = 1024);
+// Drops every movement, the grid size can change on level reload
+void ClearUnitTweens(UnitTweens& tweens, const glm::uvec2& grid_size);
+
+// The path runs from the old tile to the tile the unit was moved to
+void AddUnitTween(UnitTweens& tweens, const UnitPath& path, float delay_ms = 0.0f);
+// Advances every movement and drops the ones that arrived
+void UpdateUnitTweens(UnitTweens& tweens, DeltaMS delta);
+
+uint32_t GetUnitTweenCount(const UnitTweens& tweens);
+bool IsUnitTweening(const UnitTweens* tweens, const glm::uvec2& tile);
+
+void DrawUnitTweens(Renderer& renderer, const GameAssets& assets, const UnitMapState& unit_map, const UnitTweens& tweens, const FrameCamera& camera, const FogVisibility* fog = nullptr);
@@ -11,24 +11,147 @@ std::string GetTeamName(UnitTeam team)
     }
 }
 
-void NextRound(GameState& game_state, GameUI& game_ui)
+std::vector<glm::uvec2> NextRound(GameState& game_state, GameUI& game_ui)
 {
-    ++game_state.turn_index;
+    auto reset_tiles = AdvanceTurn(game_state);
+    UpdateRoundText(game_state, game_ui);
+    return reset_tiles;
+}
 
+std::string FormatRoundText(const GameState& game_state)
+{
     size_t round_index = game_state.turn_index / game_state.teams.size();
-    size_t team_index = game_state.turn_index % game_state.teams.size();
+    auto team_name = GetTeamName(GetCurrentTeam(game_state));
+
+    return std::format("Round {}: {} Team", round_index + 1, team_name);
+}
+
+void UpdateRoundText(const GameState& game_state, GameUI& game_ui)
+{
+    SetRoundText(game_ui, FormatRoundText(game_state));
+}
+
+void SetRoundText(GameUI& game_ui, const std::string& text)
+{
+    if (text == game_ui.shown_round_text)
+        return;
+
+    game_ui.round_text->text = unicode::FromUTF8(text);
+    game_ui.shown_round_text = text;
+    game_ui.dirty = true;
+}
+
+enum UIButtonState : uint8_t
+{
+    BUTTON_HOVERED = 1 << 0,
+    BUTTON_HELD = 1 << 1
+};
+
+// Root nodes are laid out in units of the window height, x runs up to the aspect ratio
+static SDL_FRect GetRootNodeRect(const UINode& node, const glm::uvec2& window_size)
+{
+    auto& transform = node.local_transform;
+    glm::vec2 size = transform.size * float(window_size.y);
+    glm::vec2 origin = transform.position * float(window_size.y) - transform.pivot * size;
+
+    return SDL_FRect { origin.x, origin.y, size.x, size.y };
+}
+
+static SDL_Rect GetMenuBounds(const GameUI& game_ui, const glm::uvec2& window_size)
+{
+    glm::vec2 min = glm::vec2(window_size);
+    glm::vec2 max = glm::vec2(0.0f);
+
+    for (auto* node : game_ui.root_nodes)
+    {
+        SDL_FRect rect = GetRootNodeRect(*node, window_size);
+        min = glm::min(min, glm::vec2(rect.x, rect.y));
+        max = glm::max(max, glm::vec2(rect.x + rect.w, rect.y + rect.h));
+    }
+
+    // Whole pixels inside the window, text may round outwards
+    glm::ivec2 start = glm::max(glm::ivec2(glm::floor(min)) - 1, glm::ivec2(0));
+    glm::ivec2 end = glm::min(glm::ivec2(glm::ceil(max)) + 1, glm::ivec2(window_size));
+
+    if (end.x <= start.x || end.y <= start.y)
+        return SDL_Rect {};
+
+    return SDL_Rect { start.x, start.y, end.x - start.x, end.y - start.y };
+}
 
-    auto team = game_state.teams.at(team_index);
-    auto team_name = GetTeamName(team);
+// Only the button states change how the menu looks, moving the cursor elsewhere doesn't
+static bool UpdateButtonStates(GameUI& game_ui, const glm::uvec2& window_size, const UICursorInfo& cursor)
+{
+    if (cursor.cursor_state == InputState::PRESSED)
+        game_ui.cursor_held = true;
+    else if (cursor.cursor_state == InputState::RELEASED)
+        game_ui.cursor_held = false;
 
-    std::string round_text = std::format("Round {}: {} Team", round_index + 1, team_name);
-    game_ui.round_text->text = unicode::FromUTF8(round_text);
+    bool changed = false;
 
-    for (auto& unit : game_state.unit_state.units)
+    for (size_t i = 0; i < game_ui.buttons.size(); ++i)
     {
-        if (unit.health > 0 && unit.state == UnitState::USED)
+        SDL_FRect rect = GetRootNodeRect(*game_ui.buttons.at(i), window_size);
+        glm::vec2 position = cursor.cursor_position;
+
+        bool hovered = position.x >= rect.x && position.x < rect.x + rect.w && position.y >= rect.y && position.y < rect.y + rect.h;
+        uint8_t state = hovered ? BUTTON_HOVERED | (game_ui.cursor_held ? BUTTON_HELD : 0) : 0;
+
+        // The press and the release are seen by the menu, so a click on a button always redraws
+        if (hovered && cursor.cursor_state != InputState::NONE)
+            changed = true;
+
+        if (state != game_ui.button_states.at(i))
         {
-            unit.state = UnitState::IDLE;
+            game_ui.button_states.at(i) = state;
+            changed = true;
         }
     }
-}
\ No newline at end of file
+
+    return changed;
+}
+
+void DrawGameUI(Renderer& renderer, GameUI& game_ui, const glm::uvec2& window_size, const UICursorInfo& cursor)
+{
+    if (game_ui.window_size != window_size)
+    {
+        game_ui.window_size = window_size;
+        game_ui.layer_rect = GetMenuBounds(game_ui, window_size);
+        game_ui.layer = CreateRenderTarget(game_ui.sdl_renderer, glm::uvec2(game_ui.layer_rect.w, game_ui.layer_rect.h));
+        game_ui.dirty = true;
+    }
+
+    if (UpdateButtonStates(game_ui, window_size, cursor))
+    {
+        game_ui.dirty = true;
+    }
+
+    if (!game_ui.layer)
+    {
+        game_ui.menu.Draw(renderer, window_size, cursor);
+        return;
+    }
+
+    if (game_ui.dirty)
+    {
+        SDL_Texture* previous_target = BeginRenderTarget(game_ui.sdl_renderer, game_ui.layer);
+
+        // The menu is laid out for the whole window, the viewport moves its bounds onto the layer
+        SDL_Rect viewport { -game_ui.layer_rect.x, -game_ui.layer_rect.y, int(window_size.x), int(window_size.y) };
+        SDL_SetRenderViewport(game_ui.sdl_renderer, &viewport);
+        game_ui.menu.Draw(renderer, window_size, cursor);
+        SDL_SetRenderViewport(game_ui.sdl_renderer, nullptr);
+
+        EndRenderTarget(game_ui.sdl_renderer, previous_target);
+        game_ui.dirty = false;
+    }
+
+    SDL_FRect layer_rect {
+        float(game_ui.layer_rect.x),
+        float(game_ui.layer_rect.y),
+        float(game_ui.layer_rect.w),
+        float(game_ui.layer_rect.h)
+    };
+
+    SDL_RenderTexture(game_ui.sdl_renderer, game_ui.layer.get(), nullptr, &layer_rect);
+}
@@ -6,6 +6,7 @@
 #include <ui/widgets/text_box.hpp>
 
 #include <game/cursor.hpp>
+#include <game/render_target.hpp>
 
 namespace widgets
 {
@@ -67,11 +68,26 @@ struct GameUI
     Menu menu {};
     bool next_round = false;
     TextBox* round_text;
+
+    // Retained drawing, the menu is only laid out and drawn into the layer again when it can look
+    // different: the window was resized, the text changed or a button is hovered, pressed or left.
+    SDL_Renderer* sdl_renderer {};
+    RenderTarget layer {}; // Null when render targets aren't supported, the menu is then drawn every frame
+    glm::uvec2 window_size {};
+    SDL_Rect layer_rect {}; // Bounds of the root nodes on screen
+    std::string shown_round_text {};
+    bool dirty = true;
+
+    std::vector<const UINode*> root_nodes {};
+    std::vector<const Button*> buttons {};
+    std::vector<uint8_t> button_states {}; // UIButtonState bits, per button
+    bool cursor_held = false;
 };
 
-inline std::unique_ptr<GameUI> SetupGameUI(Renderer& renderer, const GameAssets& assets)
+inline std::unique_ptr<GameUI> SetupGameUI(Renderer& renderer, SDL_Renderer* sdl_renderer, const GameAssets& assets)
 {
     std::unique_ptr<GameUI> ui = std::make_unique<GameUI>();
+    ui->sdl_renderer = sdl_renderer;
     Menu& menu = ui->menu;
 
     {
@@ -79,6 +95,7 @@ inline std::unique_ptr<GameUI> SetupGameUI(Renderer& renderer, const GameAssets&
         panel->local_transform.position = { 0.5, 0.0f };
         panel->local_transform.pivot = { 0.5f, 0.0f };
         panel->local_transform.size = { 0.6, 0.1 };
+        ui->root_nodes.push_back(panel.get());
 
         auto panel_it = menu.AddRootNode(std::move(panel));
         auto text_box = widgets::MakeSimpleTextBox(assets.text_font, unicode::FromUTF8(""), 1.0f);
@@ -97,12 +114,23 @@ inline std::unique_ptr<GameUI> SetupGameUI(Renderer& renderer, const GameAssets&
         button->on_click.connect([ui = ui.get()](Button&)
             { ui->next_round = true; });
 
+        ui->root_nodes.push_back(button.get());
+        ui->buttons.push_back(button.get());
+
         auto it = menu.AddRootNode(std::move(button));
         menu.AddChildNode(it, std::move(button_back));
         menu.AddChildNode(it, std::move(text_box));
     }
 
+    ui->button_states.resize(ui->buttons.size());
     return ui;
 };
 
-void NextRound(GameState& game_state, GameUI& game_ui);
\ No newline at end of file
+std::vector<glm::uvec2> NextRound(GameState& game_state, GameUI& game_ui);
+std::string FormatRoundText(const GameState& game_state);
+void UpdateRoundText(const GameState& game_state, GameUI& game_ui);
+// Only marks the UI dirty when the text differs from the one shown
+void SetRoundText(GameUI& game_ui, const std::string& text);
+
+// Handles the cursor and draws the menu, from the cached layer while nothing changed
+void DrawGameUI(Renderer& renderer, GameUI& game_ui, const glm::uvec2& window_size, const UICursorInfo& cursor);
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include <game/undo.hpp>
+
+UndoHistory CreateUndoHistory(uint32_t max_actions, uint32_t max_deltas)
+{
+    UndoHistory history {};
+    history.entries.resize(max_actions);
+    history.deltas.resize(max_deltas);
+    return history;
+}
+
+void ClearUndoHistory(UndoHistory& history)
+{
+    history.delta_begin = history.delta_end = 0;
+    history.entry_begin = history.entry_current = history.entry_end = 0;
+}
+
+UndoRecord BeginUndoRecord(const GameState& game_state, const std::vector<glm::uvec2>& tiles)
+{
+    UndoRecord record {};
+    record.turn_before = game_state.turn_index;
+
+    for (auto tile : tiles)
+    {
+        auto unit = game_state.unit_state.units.at(tile.x, tile.y);
+
+        // Selections are not part of the history, an undone unit is idle again
+        if (unit.state == UnitState::MOVING)
+        {
+            unit.state = UnitState::IDLE;
+        }
+
+        record.deltas.emplace_back(UnitDelta { tile, unit, unit });
+    }
+
+    return record;
+}
+
+void FinishUndoRecord(UndoRecord& record, const GameState& game_state)
+{
+    record.turn_after = game_state.turn_index;
+
+    for (auto& delta : record.deltas)
+    {
+        delta.after = game_state.unit_state.units.at(delta.tile.x, delta.tile.y);
+    }
+}
+
+UndoRecord MakeTurnUndoRecord(const GameState& game_state, const std::vector<glm::uvec2>& reset_tiles, uint32_t turn_before)
+{
+    UndoRecord record {};
+    record.turn_before = turn_before;
+    record.turn_after = game_state.turn_index;
+
+    for (auto tile : reset_tiles)
+    {
+        auto after = game_state.unit_state.units.at(tile.x, tile.y);
+        auto before = after;
+        before.state = UnitState::USED;
+
+        record.deltas.emplace_back(UnitDelta { tile, before, after });
+    }
+
+    return record;
+}
+
+void PushUndoRecord(UndoHistory& history, const UndoRecord& record)
+{
+    std::vector<UnitDelta> changes {};
+
+    for (auto& delta : record.deltas)
+    {
+        if (delta.before != delta.after)
+        {
+            changes.emplace_back(delta);
+        }
+    }
+
+    if (changes.empty() && record.turn_before == record.turn_after)
+    {
+        return;
+    }
+
+    // Redo branch is lost once a new action is made
+    history.entry_end = history.entry_current;
+    history.delta_end = history.delta_begin;
+
+    if (history.entry_end > history.entry_begin)
+    {
+        auto& last = history.entries.at((history.entry_end - 1) % history.entries.size());
+        history.delta_end = last.first_delta + last.delta_count;
+    }
+
+    if (changes.size() > history.deltas.size())
+    {
+        // Larger than the whole ring, earlier actions can not be undone past this one
+        ClearUndoHistory(history);
+        return;
+    }
+
+    auto ring_full = [&]()
+    {
+        return history.delta_end + changes.size() - history.delta_begin > history.deltas.size()
+            || history.entry_end - history.entry_begin >= history.entries.size();
+    };
+
+    while (ring_full())
+    {
+        ++history.entry_begin;
+
+        history.delta_begin = history.entry_begin < history.entry_end
+            ? history.entries.at(history.entry_begin % history.entries.size()).first_delta
+            : history.delta_end;
+    }
+
+    UndoEntry entry {};
+    entry.first_delta = history.delta_end;
+    entry.delta_count = changes.size();
+    entry.turn_before = record.turn_before;
+    entry.turn_after = record.turn_after;
+
+    for (auto& delta : changes)
+    {
+        history.deltas.at(history.delta_end++ % history.deltas.size()) = delta;
+    }
+
+    history.entries.at(history.entry_end++ % history.entries.size()) = entry;
+    history.entry_current = history.entry_end;
+}
+
+std::optional<std::vector<glm::uvec2>> Undo(UndoHistory& history, GameState& game_state)
+{
+    if (history.entry_current == history.entry_begin)
+    {
+        return std::nullopt;
+    }
+
+    auto& entry = history.entries.at(--history.entry_current % history.entries.size());
+    std::vector<glm::uvec2> changed_tiles {};
+
+    // Reverse order, a tile can appear more than once in an action
+    for (size_t i = entry.delta_count; i-- > 0;)
+    {
+        auto& delta = history.deltas.at((entry.first_delta + i) % history.deltas.size());
+        game_state.unit_state.units.at(delta.tile.x, delta.tile.y) = delta.before;
+        changed_tiles.emplace_back(delta.tile);
+    }
+
+    game_state.turn_index = entry.turn_before;
+    return changed_tiles;
+}
+
+std::optional<std::vector<glm::uvec2>> Redo(UndoHistory& history, GameState& game_state)
+{
+    if (history.entry_current == history.entry_end)
+    {
+        return std::nullopt;
+    }
+
+    auto& entry = history.entries.at(history.entry_current++ % history.entries.size());
+    std::vector<glm::uvec2> changed_tiles {};
+
+    for (size_t i = 0; i < entry.delta_count; ++i)
+    {
+        auto& delta = history.deltas.at((entry.first_delta + i) % history.deltas.size());
+        game_state.unit_state.units.at(delta.tile.x, delta.tile.y) = delta.after;
+        changed_tiles.emplace_back(delta.tile);
+    }
+
+    game_state.turn_index = entry.turn_after;
+    return changed_tiles;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <game/game_state.hpp>
+#include <optional>
+#include <vector>
+
+// Undo/redo as per action unit deltas. Deltas and actions live in two fixed size rings,
+// the oldest actions are dropped when either is full. Undo and redo only touch the changed cells.
+
+struct UnitDelta
+{
+    glm::uvec2 tile {};
+    Unit before {};
+    Unit after {};
+};
+
+struct UndoRecord
+{
+    uint32_t turn_before {};
+    uint32_t turn_after {};
+    std::vector<UnitDelta> deltas {};
+};
+
+struct UndoEntry
+{
+    size_t first_delta {}; // Monotonic position in the delta ring
+    uint32_t delta_count {};
+    uint32_t turn_before {};
+    uint32_t turn_after {};
+};
+
+struct UndoHistory
+{
+    std::vector<UnitDelta> deltas {};
+    std::vector<UndoEntry> entries {};
+
+    // Monotonic positions, wrapped by the ring sizes on access
+    size_t delta_begin {};
+    size_t delta_end {};
+    size_t entry_begin {};
+    size_t entry_current {}; // Entries before this are undone in reverse, from here on they are redone
+    size_t entry_end {};
+};
+
+UndoHistory CreateUndoHistory(uint32_t max_actions = 256, uint32_t max_deltas = 4096);
+void ClearUndoHistory(UndoHistory& history);
+
+// Captures the units on the given tiles before an action, FinishUndoRecord captures them after
+UndoRecord BeginUndoRecord(const GameState& game_state, const std::vector<glm::uvec2>& tiles);
+void FinishUndoRecord(UndoRecord& record, const GameState& game_state);
+
+// AdvanceTurn only turns used units idle, so the reset tiles are enough to rebuild the record
+UndoRecord MakeTurnUndoRecord(const GameState& game_state, const std::vector<glm::uvec2>& reset_tiles, uint32_t turn_before);
+
+// Discards anything that could be redone. Records without changes are ignored.
+void PushUndoRecord(UndoHistory& history, const UndoRecord& record);
+
+// Return the changed tiles, or nothing when there is no action to undo or redo
+std::optional<std::vector<glm::uvec2>> Undo(UndoHistory& history, GameState& game_state);
+std::optional<std::vector<glm::uvec2>> Redo(UndoHistory& history, GameState& game_state);
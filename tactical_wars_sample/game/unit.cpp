@@ -1,4 +1,6 @@
+#include <game/fog.hpp>
 #include <game/text.hpp>
+#include <game/tween.hpp>
 #include <game/unit.hpp>
 #include <utility/colours.hpp>
 
@@ -10,11 +12,38 @@ UnitMapState SetupUnitMapState(const Level& level)
     return unit_map;
 }
 
-TeamAssets LoadUnitTeamAssets(Renderer& renderer, const std::string& tsx_file)
+void ResizeUnitMapState(UnitMapState& unit_map, const Level& level)
 {
+    // Units inside the overlapping area keep their tiles, the rest are dropped
+    auto resized = SetupUnitMapState(level);
+    auto grid_size = level.map.getMapGridSize();
+
+    for (auto it = unit_map.units.begin(); it != unit_map.units.end(); ++it)
+    {
+        auto pos = it.getIndices();
+
+        if (pos.x < grid_size.x && pos.y < grid_size.y)
+        {
+            resized.units.at(pos) = *it;
+        }
+    }
+
+    unit_map = std::move(resized);
+}
+
+std::optional<TeamAssets> LoadUnitTeamData(const std::string& tsx_file)
+{
+    auto tileset = tpp::TileSet::fromTSX(tsx_file);
+
+    if (!tileset)
+    {
+        return std::nullopt;
+    }
+
     TeamAssets assets {};
-    assets.tileset = tpp::TileSet::fromTSX(tsx_file).value();
-    assets.draw_data = CreateTileSetDrawData(renderer, assets.tileset);
+    assets.tsx_path = tsx_file;
+    assets.tileset = std::move(tileset.value());
+    ResetAnimationStates(assets.tileset, assets.draw_data);
 
     if (auto* props = assets.tileset.getProperties())
     {
@@ -26,8 +55,20 @@ TeamAssets LoadUnitTeamAssets(Renderer& renderer, const std::string& tsx_file)
     return assets;
 }
 
+std::optional<TeamAssets> LoadUnitTeamAssets(Renderer& renderer, ResourceCache& cache, const std::string& tsx_file, bool keep_cpu_pixels)
+{
+    auto assets = LoadUnitTeamData(tsx_file);
+
+    if (assets)
+    {
+        assets->draw_data = CreateTileSetDrawData(renderer, cache, assets->tileset, keep_cpu_pixels);
+    }
+
+    return assets;
+}
+
 static const std::vector<UnitStats> UNIT_STATS = {
-    { 3 }, // SOLDIER
+    { 3, 4 }, // SOLDIER
 };
 
 const UnitStats& GetUnitStats(UnitType type)
@@ -35,19 +76,39 @@ const UnitStats& GetUnitStats(UnitType type)
     return UNIT_STATS.at(static_cast<uint8_t>(type));
 }
 
-static tpp::Array2D<float> InitAttackMatrix()
+// Rounded up, so whole percentages of whole health values never truncate one point short
+static constexpr int32_t MakeDamageMultiplier(int32_t percent)
 {
-    tpp::Array2D<float> matrix { 1, 1 };
-    matrix.at(static_cast<uint32_t>(UnitType::SOLDIER), static_cast<uint32_t>(UnitType::SOLDIER)) = 0.55f; // Soldier vs Soldier
+    return ((percent << DAMAGE_FIXED_SHIFT) + 99) / 100;
+}
+
+static tpp::Array2D<int32_t> InitAttackMatrix()
+{
+    tpp::Array2D<int32_t> matrix { UNIT_TYPE_COUNT, UNIT_TYPE_COUNT };
+    matrix.at(static_cast<uint32_t>(UnitType::SOLDIER), static_cast<uint32_t>(UnitType::SOLDIER)) = MakeDamageMultiplier(55); // Soldier vs Soldier
     return matrix;
 }
 
-static const tpp::Array2D<float> UNIT_ATTACK_MATRIX = InitAttackMatrix();
+static const tpp::Array2D<int32_t> UNIT_ATTACK_MATRIX = InitAttackMatrix();
 
-void AttackUnit(Unit& attacker, Unit& defender)
+int32_t GetAttackMultiplier(UnitType attacker, UnitType defender)
 {
-    auto attacker_damage = UNIT_ATTACK_MATRIX.at(static_cast<uint32_t>(attacker.type), static_cast<uint32_t>(defender.type)) * attacker.health;
-    defender.health -= (int8_t)attacker_damage;
+    return UNIT_ATTACK_MATRIX.at(static_cast<uint32_t>(attacker), static_cast<uint32_t>(defender));
+}
+
+int32_t GetDamageMultiplier(UnitType attacker, UnitType defender, uint8_t defender_defence)
+{
+    return GetAttackMultiplier(attacker, defender) * (100 - std::min<int32_t>(defender_defence, 100)) / 100;
+}
+
+int8_t CalculateDamage(int32_t multiplier, int8_t health)
+{
+    return (int8_t)(health * multiplier / (1 << DAMAGE_FIXED_SHIFT));
+}
+
+void AttackUnit(Unit& attacker, Unit& defender, uint8_t attacker_defence, uint8_t defender_defence)
+{
+    defender.health -= CalculateDamage(GetDamageMultiplier(attacker.type, defender.type, defender_defence), attacker.health);
 
     if (defender.health < 0)
     {
@@ -55,8 +116,7 @@ void AttackUnit(Unit& attacker, Unit& defender)
         return;
     }
 
-    auto defender_damage = UNIT_ATTACK_MATRIX.at(static_cast<uint32_t>(defender.type), static_cast<uint32_t>(attacker.type)) * defender.health;
-    attacker.health -= (int8_t)defender_damage;
+    attacker.health -= CalculateDamage(GetDamageMultiplier(defender.type, attacker.type, attacker_defence), defender.health);
 
     if (attacker.health < 0)
     {
@@ -65,27 +125,49 @@ void AttackUnit(Unit& attacker, Unit& defender)
     }
 }
 
-void DrawUnit(Renderer& renderer, const FrameCamera& camera, const GameAssets& assets, const glm::vec2& map_position, const glm::vec2& tile_size, Unit unit, const glm::vec4& colour)
+std::vector<glm::uvec2> ApplyUnitAction(const Level& level, UnitMapState& unit_map, const UnitAction& action)
 {
-    auto& unit_assets = assets.team_assets.at(unit.team);
-    auto& texture = unit_assets.draw_data.spritesheet_texture;
+    auto& unit = unit_map.units.at(action.unit_tile.x, action.unit_tile.y);
+    auto& target_spot = unit_map.units.at(action.move_tile.x, action.move_tile.y);
 
-    glm::vec2 sprite_size = { unit_assets.tileset.getTileSize().x, unit_assets.tileset.getTileSize().y };
-    SDL_FRect src {};
+    unit.state = UnitState::USED;
+    std::swap(unit, target_spot);
 
-    if (unit.state == UnitState::IDLE)
+    if (!action.attack_tile)
     {
-        src = GetTileRect(unit_assets.tileset, unit_assets.draw_data, unit_assets.idle_anim_index);
+        return { action.unit_tile, action.move_tile };
     }
-    else if (unit.state == UnitState::MOVING)
+
+    auto attack_tile = action.attack_tile.value();
+    auto attacker_defence = level.terrain.at(action.move_tile.x, action.move_tile.y).defence;
+    auto defender_defence = level.terrain.at(attack_tile.x, attack_tile.y).defence;
+    AttackUnit(target_spot, unit_map.units.at(attack_tile.x, attack_tile.y), attacker_defence, defender_defence);
+
+    return { action.unit_tile, action.move_tile, attack_tile };
+}
+
+uint32_t GetUnitAnimIndex(const TeamAssets& assets, UnitState state)
+{
+    if (state == UnitState::IDLE)
     {
-        src = GetTileRect(unit_assets.tileset, unit_assets.draw_data, unit_assets.move_anim_index);
+        return assets.idle_anim_index;
     }
-    else
+    else if (state == UnitState::MOVING)
     {
-        src = GetTileRect(unit_assets.tileset, unit_assets.draw_data, unit_assets.exhausted_anim);
+        return assets.move_anim_index;
     }
 
+    return assets.exhausted_anim;
+}
+
+void DrawUnit(Renderer& renderer, const FrameCamera& camera, const GameAssets& assets, const glm::vec2& map_position, const glm::vec2& tile_size, Unit unit, const glm::vec4& colour)
+{
+    auto& unit_assets = assets.team_assets.at(unit.team);
+    auto& texture = *unit_assets.draw_data.spritesheet_texture;
+
+    glm::vec2 sprite_size = { unit_assets.tileset.getTileSize().x, unit_assets.tileset.getTileSize().y };
+    SDL_FRect src = GetTileRect(unit_assets.tileset, unit_assets.draw_data, GetUnitAnimIndex(unit_assets, unit.state));
+
     glm::vec2 offset = (sprite_size * unit_assets.scale - glm::vec2(tile_size)) * 0.5f;
 
     SDL_FRect dest {};
@@ -97,29 +179,47 @@ void DrawUnit(Renderer& renderer, const FrameCamera& camera, const GameAssets& a
     renderer.RenderTextureRect(texture, camera.ToScreenRect(dest), &src, colour, !unit.facingRight);
 }
 
-void DrawMapUnits(Renderer& renderer, GameAssets& assets, const UnitMapState& unit_map, const FrameCamera& camera, DeltaMS delta)
+void UpdateUnitAnimations(GameAssets& assets, DeltaMS delta)
 {
     for (auto& [unit, sheet] : assets.team_assets)
     {
         UpdateAnimationData(sheet.tileset, sheet.draw_data, delta);
     }
+}
+
+void DrawMapUnits(Renderer& renderer, GameAssets& assets, const UnitMapState& unit_map, const FrameCamera& camera, DeltaMS delta, const FogVisibility* fog, const UnitTweens* tweens)
+{
+    UpdateUnitAnimations(assets, delta);
 
     for (auto it = unit_map.units.begin(); it != unit_map.units.end(); ++it)
     {
         auto unit = *it;
-        if (unit.health <= 0)
+        glm::uvec2 tile = { it.getIndices().x, it.getIndices().y };
+
+        if (unit.health <= 0 || IsUnitHidden(fog, tile, unit) || IsUnitTweening(tweens, tile))
         {
             continue;
         }
 
-        DrawUnit(renderer, camera, assets, { it.getIndices().x, it.getIndices().y }, unit_map.map_tile_size, unit, colour::WHITE);
+        DrawUnit(renderer, camera, assets, tile, unit_map.map_tile_size, unit, colour::WHITE);
+    }
+
+    if (tweens)
+    {
+        DrawUnitTweens(renderer, assets, unit_map, *tweens, camera, fog);
     }
 
+    DrawUnitHealth(renderer, assets, unit_map, camera, fog, tweens);
+}
+
+void DrawUnitHealth(Renderer& renderer, const GameAssets& assets, const UnitMapState& unit_map, const FrameCamera& camera, const FogVisibility* fog, const UnitTweens* tweens)
+{
     for (auto it = unit_map.units.begin(); it != unit_map.units.end(); ++it)
     {
         auto unit = *it;
+        glm::uvec2 tile = { it.getIndices().x, it.getIndices().y };
 
-        if (unit.health <= 0)
+        if (unit.health <= 0 || IsUnitHidden(fog, tile, unit) || IsUnitTweening(tweens, tile))
         {
             continue;
         }
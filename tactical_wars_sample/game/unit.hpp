@@ -2,8 +2,12 @@
 #include <game/level.hpp>
 #include <game/tileset_data.hpp>
 #include <math/camera.hpp>
+#include <optional>
 #include <resources/font.hpp>
 
+struct FogVisibility;
+struct UnitTweens;
+
 enum class UnitTeam : uint8_t
 {
     RED,
@@ -15,6 +19,8 @@ enum class UnitType : uint8_t
     SOLDIER
 };
 
+constexpr uint32_t UNIT_TYPE_COUNT = 1;
+
 enum class UnitState : uint8_t
 {
     IDLE,
@@ -24,6 +30,7 @@ enum class UnitState : uint8_t
 
 struct TeamAssets
 {
+    std::string tsx_path {};
     tpp::TileSet tileset {};
     TileSetDrawData draw_data {};
 
@@ -36,6 +43,7 @@ struct TeamAssets
 struct UnitStats
 {
     uint32_t movement_range = 3;
+    uint32_t sight_range = 4;
 };
 
 struct Unit
@@ -45,6 +53,8 @@ struct Unit
     UnitState state = UnitState::IDLE;
     bool facingRight = true;
     int8_t health = 0;
+
+    bool operator==(const Unit&) const = default;
 };
 
 struct UnitMapState
@@ -53,6 +63,24 @@ struct UnitMapState
     tpp::Array2D<Unit> units;
 };
 
+struct UnitAction
+{
+    glm::uvec2 unit_tile {};
+    glm::uvec2 move_tile {};
+    std::optional<glm::uvec2> attack_tile {};
+};
+
+// Both sides of a fight before and after it, for the hit effects
+struct UnitAttack
+{
+    glm::uvec2 attacker_tile {};
+    glm::uvec2 defender_tile {};
+    Unit attacker_before {};
+    Unit attacker_after {};
+    Unit defender_before {};
+    Unit defender_after {};
+};
+
 struct GameAssets
 {
     std::unordered_map<UnitTeam, TeamAssets> team_assets;
@@ -61,11 +89,31 @@ struct GameAssets
     std::shared_ptr<Texture> round_background;
 };
 
-void AttackUnit(Unit& attacker, Unit& defender);
+// Damage multipliers are 16.16 fixed point. Combat only uses integer maths,
+// so every build and CPU resolves a fight to the same health values.
+constexpr int32_t DAMAGE_FIXED_SHIFT = 16;
+
+// Each side takes less damage by the terrain defence of its own tile
+void AttackUnit(Unit& attacker, Unit& defender, uint8_t attacker_defence = 0, uint8_t defender_defence = 0);
+int32_t GetAttackMultiplier(UnitType attacker, UnitType defender);
+int32_t GetDamageMultiplier(UnitType attacker, UnitType defender, uint8_t defender_defence);
+// Truncates towards zero
+int8_t CalculateDamage(int32_t multiplier, int8_t health);
+
+// Moves the unit, resolves the optional attack from the new tile and marks the unit as used.
+// Returns the tiles whose contents changed.
+std::vector<glm::uvec2> ApplyUnitAction(const Level& level, UnitMapState& unit_map, const UnitAction& action);
 const UnitStats& GetUnitStats(UnitType type);
 UnitMapState SetupUnitMapState(const Level& level);
-TeamAssets LoadUnitTeamAssets(Renderer& renderer, const std::string& tsx_file);
-void DrawMapUnits(Renderer& renderer, GameAssets& assets, const UnitMapState& unit_map, const FrameCamera& camera, DeltaMS delta);
+void ResizeUnitMapState(UnitMapState& unit_map, const Level& level);
+// Empty when the tileset can't be parsed, Tiled can still be writing it
+std::optional<TeamAssets> LoadUnitTeamData(const std::string& tsx_file); // Tileset and animations only, no textures
+std::optional<TeamAssets> LoadUnitTeamAssets(Renderer& renderer, ResourceCache& cache, const std::string& tsx_file, bool keep_cpu_pixels = false);
+uint32_t GetUnitAnimIndex(const TeamAssets& assets, UnitState state);
+void UpdateUnitAnimations(GameAssets& assets, DeltaMS delta);
+// Enemies hidden by the optional fog are skipped, moving units are drawn at their animated position
+void DrawMapUnits(Renderer& renderer, GameAssets& assets, const UnitMapState& unit_map, const FrameCamera& camera, DeltaMS delta, const FogVisibility* fog = nullptr, const UnitTweens* tweens = nullptr);
+void DrawUnitHealth(Renderer& renderer, const GameAssets& assets, const UnitMapState& unit_map, const FrameCamera& camera, const FogVisibility* fog = nullptr, const UnitTweens* tweens = nullptr);
 
 void DrawUnit(
     Renderer& renderer,
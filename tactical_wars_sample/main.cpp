@@ -1,119 +1,430 @@
 #include <engine/common.hpp>
 
 #include <SDL3/SDL_main.h>
+#include <charconv>
+#include <iostream>
 #include <engine/window.hpp>
+#include <game/asset_watcher.hpp>
+#include <game/compositor.hpp>
 #include <game/cursor.hpp>
+#include <game/fog.hpp>
+#include <game/frame_capture.hpp>
+#include <game/frame_pacing.hpp>
+#include <game/frame_pipeline.hpp>
 #include <game/game_bindings.hpp>
+#include <game/hot_reload.hpp>
 #include <game/level.hpp>
+#include <game/level_lod.hpp>
+#include <game/lockstep.hpp>
+#include <game/match_setup.hpp>
+#include <game/minimap.hpp>
+#include <game/resource_cache.hpp>
+#include <game/tween.hpp>
 #include <game/ui.hpp>
 #include <game/unit.hpp>
 #include <resources/font.hpp>
 #include <utility/colours.hpp>
 #include <utility/log.hpp>
 
-int main(int, char*[])
+int main(int argc, char* argv[])
 {
+    // Software rendered deployments composite the map on the CPU instead of one quad per tile
+    bool cpu_compositor = false;
+    // Steps the game on the main thread between drawing, instead of a frame ahead on its own thread
+    bool single_threaded = false;
+
+    // Usage: TacticalWars [--cpu-compositor] [--single-threaded] [--host PORT | --join ADDRESS PORT]
+    //                    [--pacing vsync|late|low-latency] [--frame-cap FPS] [--latency-histogram path.csv]
+    //                    [--capture out.y4m | --capture directory] [--capture-fps FPS] [--capture-frames N] [--headless]
+    std::optional<uint16_t> host_port {};
+    std::optional<std::pair<std::string, uint16_t>> join_address {};
+
+    FramePacingMode pacing_mode = FramePacingMode::VSYNC;
+    uint32_t frame_cap = 240;
+    std::string latency_histogram_path {};
+    bool report_latency = false; // Only when pacing or latency was asked about
+
+    std::optional<FrameCaptureConfig> capture_config {};
+    uint32_t capture_fps = 60;
+    uint32_t capture_frames = 0; // Quits after this many frames, 0 records until the window is closed
+    bool headless = false;
+
+    std::optional<std::string_view> invalid_port {};
+
+    auto parse_port = [&](std::string_view value)
+    {
+        uint16_t port {};
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), port);
+
+        if (error != std::errc {} || end != value.data() + value.size() || port == 0)
+        {
+            invalid_port = value;
+        }
+
+        return port;
+    };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view option = argv[i];
+
+        if (option == "--cpu-compositor")
+            cpu_compositor = true;
+        else if (option == "--single-threaded")
+            single_threaded = true;
+        else if (option == "--host" && i + 1 < argc)
+            host_port = parse_port(argv[++i]);
+        else if (option == "--join" && i + 2 < argc)
+        {
+            join_address = std::pair { std::string(argv[i + 1]), parse_port(argv[i + 2]) };
+            i += 2;
+        }
+        else if (option == "--pacing" && i + 1 < argc)
+        {
+            std::string_view mode = argv[++i];
+            report_latency = true;
+
+            if (mode == "late")
+                pacing_mode = FramePacingMode::LATE_INPUT;
+            else if (mode == "low-latency")
+                pacing_mode = FramePacingMode::LOW_LATENCY;
+            else
+                pacing_mode = FramePacingMode::VSYNC;
+        }
+        else if (option == "--frame-cap" && i + 1 < argc)
+        {
+            std::string_view value = argv[++i];
+            std::from_chars(value.data(), value.data() + value.size(), frame_cap);
+        }
+        else if (option == "--latency-histogram" && i + 1 < argc)
+        {
+            latency_histogram_path = argv[++i];
+            report_latency = true;
+        }
+        else if (option == "--capture" && i + 1 < argc)
+        {
+            std::string_view path = argv[++i];
+
+            capture_config = FrameCaptureConfig {};
+            capture_config->path = path;
+            capture_config->format = path.ends_with(".y4m") ? CaptureFormat::Y4M : CaptureFormat::PNG_SEQUENCE;
+        }
+        else if (option == "--capture-fps" && i + 1 < argc)
+        {
+            std::string_view value = argv[++i];
+            std::from_chars(value.data(), value.data() + value.size(), capture_fps);
+        }
+        else if (option == "--capture-frames" && i + 1 < argc)
+        {
+            std::string_view value = argv[++i];
+            std::from_chars(value.data(), value.data() + value.size(), capture_frames);
+        }
+        else if (option == "--headless")
+            headless = true;
+    }
+
+    if (invalid_port)
+    {
+        std::cerr << "Invalid port '" << invalid_port.value() << "', expected 1 to 65535\n"
+                  << "Usage: TacticalWars [--host PORT | --join ADDRESS PORT], the default port is " << LOCKSTEP_DEFAULT_PORT << "\n";
+        return 1;
+    }
+
+    if (headless)
+    {
+        // No display needed, frames are only seen through --capture
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    }
+
+    // The map is parsed on a worker while SDL and the window start up
+    auto level_data = PreloadLevelData("assets/maps/FinalMap.tmx");
+
     SDL::Init();
 
     {
-        auto window = std::make_unique<Window>("Tactical Wars!", glm::uvec2(1600, 900));
+        const std::string window_title = "Tactical Wars!";
+        auto window = std::make_unique<Window>(window_title, glm::uvec2(1600, 900));
         auto& renderer = window->GetRenderer();
+        // For the render targets and readback that Renderer doesn't wrap
+        SDL_Renderer* sdl_renderer = FindWindowRenderer(window_title);
 
-        renderer.SetVSync(true);
+        auto frame_pacer = CreateFramePacer(renderer, pacing_mode, frame_cap);
+        frame_pacer.pipelined = !single_threaded;
         renderer.SetDebugRendering(false);
 
         GameInput input_data { window->GetInput() };
 
-        GameState game_state {};
-        game_state.current_level = LoadLevel(renderer, "assets/maps/FinalMap.tmx");
-        game_state.unit_state = SetupUnitMapState(game_state.current_level);
+        // Declared after the window so every texture is released before the renderer
+        ResourceCache resource_cache {};
+
+        FrameSimulation simulation {};
+        auto& game_state = simulation.game_state;
+        // The CPU copy of the tilesets also bakes the zoomed out LOD pyramid
+        game_state.current_level = std::make_shared<Level>(FinishLevelLoad(renderer, resource_cache, level_data.get(), true));
+        game_state.unit_state = SetupUnitMapState(*game_state.current_level);
         game_state.teams = { UnitTeam::RED, UnitTeam::BLUE };
 
-        PersistentCamera camera {};
+        auto& camera = simulation.camera;
         camera.resolution = window->GetSize();
 
         {
-            auto grid_size = game_state.current_level.map.getMapGridSize();
-            auto tile_size = game_state.current_level.map.getMapTileSize();
+            auto grid_size = game_state.current_level->map.getMapGridSize();
+            auto tile_size = game_state.current_level->map.getMapTileSize();
 
             camera.translation = { grid_size.x * tile_size.x * 0.5f, grid_size.y * tile_size.y * 0.5f };
         }
 
         GameAssets assets {};
-        assets.team_assets[UnitTeam::RED] = LoadUnitTeamAssets(renderer, "assets/maps/Spearman.tsx");
-        assets.team_assets[UnitTeam::BLUE] = LoadUnitTeamAssets(renderer, "assets/maps/Goblin.tsx");
+        assets.team_assets[UnitTeam::RED] = LoadUnitTeamAssets(renderer, resource_cache, "assets/maps/Spearman.tsx", cpu_compositor).value();
+        assets.team_assets[UnitTeam::BLUE] = LoadUnitTeamAssets(renderer, resource_cache, "assets/maps/Goblin.tsx", cpu_compositor).value();
 
         FontLoadInfo font_info {};
         font_info.codepoint_ranges.emplace_back(unicode::ASCII_CODESET);
         font_info.codepoint_ranges.emplace_back(unicode::LATIN_SUPPLEMENT_CODESET);
-        assets.text_font = Font::SharedFromFile(renderer, "assets/fonts/forward.ttf", font_info);
+        assets.text_font = LoadCachedFont(resource_cache, renderer, "assets/fonts/forward.ttf", font_info);
 
-        assets.button_texture = Texture::SharedFromFile(renderer, "assets/images/button.png");
-        assets.round_background = Texture::SharedFromFile(renderer, "assets/images/round_background.png");
+        assets.button_texture = LoadCachedTexture(resource_cache, renderer, "assets/images/button.png");
+        assets.round_background = LoadCachedTexture(resource_cache, renderer, "assets/images/round_background.png");
 
-        auto game_ui = SetupGameUI(renderer, assets);
+        auto game_ui = SetupGameUI(renderer, sdl_renderer, assets);
         NextRound(game_state, *game_ui);
 
+        ApplyStartingLayout(game_state.unit_state, DefaultStartingLayout());
+
+        auto minimap = CreateMinimap(sdl_renderer, *game_state.current_level);
+        ResetMinimapUnits(minimap, game_state.unit_state);
+
+        auto level_lod = CreateLevelLod(*game_state.current_level);
+
+        game_state.fog = std::make_shared<FogOfWar>(CreateFogOfWar(*game_state.current_level));
+        ResetFogUnits(*game_state.fog, game_state.unit_state);
+
+        simulation.unit_tweens = CreateUnitTweens(game_state.fog->grid_size);
+        simulation.effects = CreateCombatEffects();
+
+        // Connects once the starting state is set up, both peers compare it before playing
+        auto& session = simulation.session;
+
+        if (host_port || join_address)
         {
-            Unit red_unit {};
-            red_unit.team = UnitTeam::RED;
-            red_unit.health = 100;
-
-            game_state.unit_state.units.at(5, 3) = red_unit;
-            game_state.unit_state.units.at(5, 4) = red_unit;
-            game_state.unit_state.units.at(4, 4) = red_unit;
-
-            Unit blue_unit {};
-            blue_unit.team = UnitTeam::BLUE;
-            blue_unit.health = 100;
-            blue_unit.facingRight = false;
-
-            game_state.unit_state.units.at(9, 2) = blue_unit;
-            game_state.unit_state.units.at(11, 1) = blue_unit;
-            game_state.unit_state.units.at(10, 1) = blue_unit;
+            // The window keeps answering while the peer is awaited, closing it gives up
+            auto keep_waiting = [&]()
+            {
+                window->ProcessEvents();
+                return input_data.running;
+            };
+
+            session = host_port
+                ? HostLockstep(host_port.value(), game_state, keep_waiting)
+                : JoinLockstep(join_address->first, join_address->second, game_state, keep_waiting);
+
+            if (!session)
+            {
+                std::cerr << "Failed to start the multiplayer session\n";
+                SDL::Shutdown();
+                return 1;
+            }
         }
 
-        Cursor cursor {};
         Timer timer {};
+        TileCompositor compositor {};
+
+        AssetWatcher asset_watcher { { "assets" } };
+
+        simulation.undo_history = CreateUndoHistory();
+        simulation.quicksave_path = "saves/quicksave.twsave";
+        ResetSimulationAnimations(simulation, assets);
+
+        auto pipeline = StartFramePipeline(simulation, !single_threaded);
+
+        std::unique_ptr<FrameCapture> capture {};
+
+        if (capture_config)
+        {
+            capture_config->fps = std::max(capture_fps, 1u);
+            // Nobody watches a headless run, so a slow disk slows the recording instead of losing frames
+            capture_config->wait_for_buffer = headless;
+            capture = StartFrameCapture(sdl_renderer, capture_config.value());
+
+            if (!capture)
+            {
+                std::cerr << "Failed to start capturing to " << capture_config->path << "\n";
+            }
+        }
+
+        uint64_t frame_count = 0;
+
+        // Units the minimap currently shows
+        uint64_t minimap_units_revision = simulation.units_revision;
 
         while (input_data.running)
         {
+            // Sleeps first, so the frame starts from the freshest input
+            WaitForInput(frame_pacer);
+
             auto deltatime = timer.GetElapsed();
             input_data.mouse_state = InputState::NONE;
             timer.Reset();
 
+            // Recordings advance by a fixed step, so a replay gives the same video however fast it runs
+            if (capture)
+            {
+                deltatime = DeltaMS(1000.0f / capture->config.fps);
+            }
+
             window->ProcessEvents();
 
-            if (game_ui->next_round)
+            if (auto changed_assets = asset_watcher.PollChangedFiles(); !changed_assets.empty())
+            {
+                // Reloading touches the game state, so the simulation has to be idle
+                WaitForSimulation(*pipeline);
+
+                auto reload = ReloadChangedAssets(renderer, resource_cache, changed_assets, game_state, assets, minimap);
+
+                if (reload.level.grid_size_changed)
+                {
+                    simulation.cursor.state = DefaultCursorState {};
+                    ClearUndoHistory(simulation.undo_history);
+                    ClearUnitTweens(simulation.unit_tweens, game_state.fog->grid_size);
+                }
+
+                // The fog already took the edited sight blockers, the pyramid drops the chunks under edited tiles
+                if (reload.level.grid_size_changed || reload.level.animations_changed)
+                {
+                    level_lod = CreateLevelLod(*game_state.current_level);
+                }
+                else if (reload.level.reloaded)
+                {
+                    UpdateLevelLod(level_lod, *game_state.current_level, reload.level.changed_tiles);
+                }
+
+                if (reload.level.animations_changed || !reload.reloaded_teams.empty())
+                {
+                    ResetSimulationAnimations(simulation, assets);
+                }
+
+                if (reload.units_recast)
+                {
+                    simulation.units_reset = true;
+                    simulation.units_revision++;
+                }
+            }
+
+            SimulationInput frame_input {};
+            frame_input.deltatime = deltatime;
+            frame_input.mouse_pos = input_data.mouse_pos;
+            frame_input.movement = input_data.movement;
+            frame_input.camera_zoom = input_data.camera_zoom;
+            frame_input.mouse_click = input_data.mouse_state == InputState::PRESSED;
+            frame_input.next_round = game_ui->next_round;
+            frame_input.save_requested = input_data.save_requested;
+            frame_input.load_requested = input_data.load_requested;
+            frame_input.undo_requested = input_data.undo_requested;
+            frame_input.redo_requested = input_data.redo_requested;
+
+            game_ui->next_round = false;
+            input_data.save_requested = false;
+            input_data.load_requested = false;
+            input_data.undo_requested = false;
+            input_data.redo_requested = false;
+
+            if (frame_input.mouse_click)
             {
-                NextRound(game_state, *game_ui);
-                game_ui->next_round = false;
+                // Clicking the minimap pans the camera instead of moving the cursor
+                if (auto world_pos = MinimapToWorld(minimap, window->GetSize(), input_data.mouse_pos))
+                {
+                    frame_input.camera_jump = world_pos.value();
+                    frame_input.mouse_click = false;
+                }
             }
 
-            camera.zoom = input_data.camera_zoom;
-            camera.translation += input_data.movement * deltatime.count();
-            auto frame_camera = camera.MakeFrameCamera();
+            // Threaded, this frame's step runs while the previous snapshot is drawn
+            SubmitSimulationInput(*pipeline, frame_input);
+
+            glm::vec4 clear_colour { 0.2f, 0.2f, 0.2f, 1.0f };
+            renderer.ClearScreen(clear_colour);
+
+            if (auto* snapshot = AcquireRenderSnapshot(*pipeline))
+            {
+                auto& level = *game_state.current_level;
+                auto& frame_camera = snapshot->camera;
+                auto& tile_size = snapshot->unit_state.map_tile_size;
 
-            auto cursor_commands = UpdateCursorInput(
-                cursor,
-                game_state,
-                frame_camera.ToWorld(input_data.mouse_pos),
-                input_data.mouse_state == InputState::PRESSED,
-                deltatime);
+                // Animations were already advanced by the simulation
+                ApplySnapshotAnimations(*snapshot, simulation, level, assets);
 
-            renderer.ClearScreen(glm::vec4(0.2f, 0.2f, 0.2f, 1.0f));
+                if (snapshot->units_revision != minimap_units_revision)
+                {
+                    // Only the changed tiles, unless a snapshot with changes of its own was skipped
+                    if (snapshot->previous_units_revision == minimap_units_revision && !snapshot->units_reset)
+                        UpdateMinimapTiles(minimap, snapshot->unit_state, snapshot->changed_tiles, &snapshot->fog);
+                    else
+                        ResetMinimapUnits(minimap, snapshot->unit_state, &snapshot->fog);
 
-            DrawLevel(renderer, game_state.current_level, frame_camera, deltatime);
-            DrawMapUnits(renderer, assets, game_state.unit_state, frame_camera, deltatime);
-            DrawCursorInput(renderer, assets, cursor_commands, frame_camera);
+                    minimap_units_revision = snapshot->units_revision;
+                }
+
+                SetRoundText(*game_ui, snapshot->round_text);
+
+                if (cpu_compositor)
+                {
+                    DrawCompositedMap(renderer, sdl_renderer, compositor, level, assets, snapshot->unit_state, frame_camera, window->GetSize(), clear_colour, DeltaMS {}, &snapshot->fog, &snapshot->unit_tweens);
+                }
+                else
+                {
+                    if (!DrawLevelLod(renderer, level_lod, level, frame_camera, window->GetSize(), DeltaMS {}))
+                    {
+                        DrawLevel(renderer, level, frame_camera, DeltaMS {});
+                    }
+
+                    DrawMapUnits(renderer, assets, snapshot->unit_state, frame_camera, DeltaMS {}, &snapshot->fog, &snapshot->unit_tweens);
+                }
+                DrawCombatEffects(renderer, assets, snapshot->effects, tile_size, frame_camera, &snapshot->fog);
+                DrawFog(renderer, snapshot->fog, tile_size, frame_camera, window->GetSize());
+                DrawCursorInput(renderer, assets, snapshot->cursor_overlay, frame_camera);
+                DrawMinimap(renderer, minimap, window->GetSize(), frame_camera, &snapshot->fog);
+            }
 
             UICursorInfo info {};
             info.cursor_position = input_data.mouse_pos;
             info.cursor_state = input_data.mouse_state;
             info.deltatime = deltatime;
 
-            game_ui->menu.Draw(renderer, window->GetSize(), info);
+            DrawGameUI(renderer, *game_ui, window->GetSize(), info);
+
+            if (capture && CaptureFrame(*capture) == CaptureResult::SIZE_CHANGED && capture->size_errors == 1)
+            {
+                std::cerr << "The window was resized, frames are no longer captured until it is restored\n";
+            }
+
+            if (capture_frames != 0 && ++frame_count >= capture_frames)
+            {
+                input_data.running = false;
+            }
+
+            OnFrameSubmitted(frame_pacer);
             window->RenderPresent();
+            OnFramePresented(frame_pacer);
+        }
+
+        StopFramePipeline(*pipeline);
+
+        if (capture)
+        {
+            StopFrameCapture(*capture);
+            std::cout << FormatCaptureReport(*capture);
+            std::cerr << FormatCaptureErrors(*capture);
+        }
+
+        if (report_latency)
+        {
+            std::cout << FormatLatencyReport(frame_pacer);
+        }
+
+        if (!latency_histogram_path.empty() && !WriteLatencyHistograms(frame_pacer, latency_histogram_path))
+        {
+            std::cerr << "Failed to write " << latency_histogram_path << "\n";
         }
     }
 
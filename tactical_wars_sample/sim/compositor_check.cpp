@@ -0,0 +1,143 @@
+#include <sim/compositor_check.hpp>
+
+#include <fstream>
+#include <game/match_setup.hpp>
+#include <game/render_target.hpp>
+#include <game/resource_cache.hpp>
+#include <random>
+
+static void WritePPM(const std::string& path, const std::vector<uint32_t>& pixels, const glm::uvec2& size)
+{
+    std::ofstream file { path, std::ios::binary };
+    file << "P6\n"
+         << size.x << " " << size.y << "\n255\n";
+
+    for (auto pixel : pixels)
+    {
+        char rgb[3] = { char(pixel & 0xFF), char((pixel >> 8) & 0xFF), char((pixel >> 16) & 0xFF) };
+        file.write(rgb, 3);
+    }
+}
+
+// Alpha is left out, the window has no use for it
+static uint64_t CountMismatches(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs, uint8_t tolerance)
+{
+    uint64_t mismatches = 0;
+
+    for (size_t i = 0; i < lhs.size(); ++i)
+    {
+        for (uint32_t shift = 0; shift < 24; shift += 8)
+        {
+            int32_t difference = int32_t((lhs[i] >> shift) & 0xFF) - int32_t((rhs[i] >> shift) & 0xFF);
+
+            if (std::abs(difference) > tolerance)
+            {
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+CompositorCheckResult CheckCompositor(Renderer& renderer, SDL_Renderer* sdl_renderer, const CompositorCheckConfig& config)
+{
+    ResourceCache cache {};
+    Level level = LoadLevel(renderer, cache, config.map_path, true);
+
+    GameAssets assets {};
+
+    for (auto& [team, tsx_path] : config.team_tilesets)
+    {
+        assets.team_assets[team] = LoadUnitTeamAssets(renderer, cache, tsx_path, true).value();
+    }
+
+    auto grid_size = level.map.getMapGridSize();
+    auto tile_size = level.map.getMapTileSize();
+    glm::vec2 world_size = { grid_size.x * tile_size.x, grid_size.y * tile_size.y };
+
+    std::mt19937_64 rng { config.seed };
+    std::uniform_real_distribution<float> unit_interval { 0.0f, 1.0f };
+
+    TileCompositor simd_compositor {};
+    TileCompositor scalar_compositor {};
+    scalar_compositor.kernel = CompositorKernel::SCALAR;
+
+    size_t pixel_count = size_t(config.screen_size.x) * config.screen_size.y;
+    std::vector<uint32_t> reference(pixel_count);
+    std::vector<uint32_t> simd_frame(pixel_count);
+    std::vector<uint32_t> scalar_frame(pixel_count);
+    glm::vec4 clear_colour { 0.2f, 0.2f, 0.2f, 1.0f };
+
+    auto read_frame = [&](std::vector<uint32_t>& pixels)
+    { return ConvertRenderPixels(ReadRenderPixels(sdl_renderer, config.screen_size), reinterpret_cast<uint8_t*>(pixels.data())); };
+
+    CompositorCheckResult result {};
+
+    for (uint32_t frame = 0; frame < config.frame_count; ++frame)
+    {
+        auto unit_map = SetupUnitMapState(level);
+        ApplyStartingLayout(unit_map, RandomStartingLayout(level, 8, rng()));
+
+        for (auto& unit : unit_map.units)
+        {
+            unit.facingRight = rng() % 2;
+            unit.state = static_cast<UnitState>(rng() % 3);
+        }
+
+        DeltaMS delta { unit_interval(rng) * 2000.0f };
+        UpdateLevelAnimations(level, delta);
+        UpdateUnitAnimations(assets, delta);
+
+        // Zoom changes every few frames so the scaled sheets are also reused
+        PersistentCamera camera {};
+        camera.resolution = config.screen_size;
+        camera.zoom = 0.25f + std::fmod((frame / 4) * 0.37f, 3.75f);
+        camera.translation = { unit_interval(rng) * world_size.x, unit_interval(rng) * world_size.y };
+
+        auto frame_camera = camera.MakeFrameCamera();
+
+        // Health labels go through the renderer on both paths, so they cancel out
+        renderer.ClearScreen(clear_colour);
+        DrawLevel(renderer, level, frame_camera, DeltaMS {});
+        DrawMapUnits(renderer, assets, unit_map, frame_camera, DeltaMS {});
+        bool read = read_frame(reference);
+
+        renderer.ClearScreen(clear_colour);
+        DrawCompositedMap(renderer, sdl_renderer, simd_compositor, level, assets, unit_map, frame_camera, config.screen_size, clear_colour, DeltaMS {});
+        read &= read_frame(simd_frame);
+
+        renderer.ClearScreen(clear_colour);
+        DrawCompositedMap(renderer, sdl_renderer, scalar_compositor, level, assets, unit_map, frame_camera, config.screen_size, clear_colour, DeltaMS {});
+        read &= read_frame(scalar_frame);
+
+        if (!read)
+        {
+            result.read_failed = true;
+            break;
+        }
+
+        auto simd_mismatches = CountMismatches(simd_frame, reference, config.tolerance);
+        auto scalar_mismatches = CountMismatches(scalar_frame, reference, config.tolerance);
+
+        if (simd_mismatches > 0 && result.simd_mismatches == 0)
+        {
+            WritePPM(std::format("compositor_simd_{}.ppm", frame), simd_frame, config.screen_size);
+            WritePPM(std::format("compositor_renderer_{}.ppm", frame), reference, config.screen_size);
+        }
+
+        if (scalar_mismatches > 0 && result.scalar_mismatches == 0)
+        {
+            WritePPM(std::format("compositor_scalar_{}.ppm", frame), scalar_frame, config.screen_size);
+            WritePPM(std::format("compositor_renderer_{}.ppm", frame), reference, config.screen_size);
+        }
+
+        result.frames++;
+        result.compared_pixels += pixel_count;
+        result.simd_mismatches += simd_mismatches;
+        result.scalar_mismatches += scalar_mismatches;
+    }
+
+    return result;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <game/compositor.hpp>
+
+// Image comparison of the CPU compositor against the frames DrawLevel and DrawMapUnits
+// render through the SDL renderer, both read back from the same render target.
+// Frames use random camera positions, zoom levels, animation times and unit placements.
+// Meant for the offscreen video driver and the software renderer, see TacticalWarsSim.
+struct CompositorCheckConfig
+{
+    std::string map_path = "assets/maps/FinalMap.tmx";
+    std::unordered_map<UnitTeam, std::string> team_tilesets = {
+        { UnitTeam::RED, "assets/maps/Spearman.tsx" },
+        { UnitTeam::BLUE, "assets/maps/Goblin.tsx" }
+    };
+
+    uint32_t frame_count = 100;
+    uint64_t seed = 0;
+    glm::uvec2 screen_size = { 800, 450 };
+    uint8_t tolerance = 0; // Largest channel difference still counted as a match, the kernels round like SDL
+};
+
+struct CompositorCheckResult
+{
+    uint32_t frames {};
+    uint64_t compared_pixels {};
+    uint64_t simd_mismatches {};
+    uint64_t scalar_mismatches {};
+    bool read_failed = false; // The render target couldn't be read back at the screen size
+};
+
+// The renderer must draw to a window of config.screen_size.
+// The first mismatching frame of each kernel is written next to the renderer frame as PPM images.
+CompositorCheckResult CheckCompositor(Renderer& renderer, SDL_Renderer* sdl_renderer, const CompositorCheckConfig& config);
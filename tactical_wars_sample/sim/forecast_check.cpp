@@ -0,0 +1,78 @@
+#include <sim/forecast_check.hpp>
+
+#include <iostream>
+
+ForecastCheckResult CheckCombatForecast(const ForecastCheckConfig& config)
+{
+    ForecastCheckResult result {};
+    CombatForecastBatch batch {};
+    CombatForecastBatch single {}; // Batches of one only run the scalar kernel
+    std::vector<std::pair<Unit, Unit>> fights {};
+
+    for (uint32_t attacker_type = 0; attacker_type < UNIT_TYPE_COUNT; ++attacker_type)
+    {
+        for (uint32_t defender_type = 0; defender_type < UNIT_TYPE_COUNT; ++defender_type)
+        {
+            for (uint32_t attacker_defence = 0; attacker_defence <= config.max_defence; ++attacker_defence)
+            {
+                for (uint32_t defender_defence = 0; defender_defence <= config.max_defence; ++defender_defence)
+                {
+                    ClearCombatForecasts(batch);
+                    fights.clear();
+
+                    // A dead unit is reset to Unit {}, the other team tells it apart from a survivor at zero health
+                    for (int32_t attacker_health = 0; attacker_health <= INT8_MAX; ++attacker_health)
+                    {
+                        for (int32_t defender_health = 0; defender_health <= INT8_MAX; ++defender_health)
+                        {
+                            Unit attacker { UnitTeam::BLUE, static_cast<UnitType>(attacker_type), UnitState::IDLE, false, int8_t(attacker_health) };
+                            Unit defender { UnitTeam::BLUE, static_cast<UnitType>(defender_type), UnitState::IDLE, false, int8_t(defender_health) };
+
+                            AddCombatForecast(batch, attacker, defender, attacker_defence, defender_defence);
+                            fights.emplace_back(attacker, defender);
+                        }
+                    }
+
+                    ForecastCombat(batch);
+
+                    for (size_t i = 0; i < fights.size(); ++i)
+                    {
+                        auto [attacker, defender] = fights.at(i);
+                        auto attacker_before = attacker.health;
+                        auto defender_before = defender.health;
+
+                        ClearCombatForecasts(single);
+                        AddCombatForecast(single, attacker, defender, attacker_defence, defender_defence);
+                        ForecastCombat(single);
+
+                        AttackUnit(attacker, defender, attacker_defence, defender_defence);
+
+                        bool defender_killed = defender.team != UnitTeam::BLUE;
+                        bool attacker_killed = attacker.team != UnitTeam::BLUE;
+
+                        bool matches = batch.defender_damage.at(i) == single.defender_damage.at(0)
+                            && batch.attacker_damage.at(i) == single.attacker_damage.at(0)
+                            && batch.defender_killed.at(i) == single.defender_killed.at(0)
+                            && batch.attacker_killed.at(i) == single.attacker_killed.at(0)
+                            && batch.defender_killed.at(i) == defender_killed
+                            && batch.attacker_killed.at(i) == attacker_killed
+                            && (defender_killed || batch.defender_damage.at(i) == defender_before - defender.health)
+                            && (defender_killed || attacker_killed || batch.attacker_damage.at(i) == attacker_before - attacker.health)
+                            && (!defender_killed || batch.attacker_damage.at(i) == 0);
+
+                        if (!matches && result.mismatches == 0)
+                        {
+                            std::cerr << std::format("First forecast mismatch: health {} vs {}, defence {} vs {}\n",
+                                attacker_before, defender_before, attacker_defence, defender_defence);
+                        }
+
+                        result.fights++;
+                        result.mismatches += !matches;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <game/combat.hpp>
+
+// Exhaustive comparison of the batch combat forecast against the scalar kernel and AttackUnit.
+// Every pair of health values is forecast for every pair of terrain defences up to max_defence.
+// Each fight is also forecast alone, so the vector kernel is compared bit for bit against the scalar one.
+struct ForecastCheckConfig
+{
+    uint8_t max_defence = 100;
+};
+
+struct ForecastCheckResult
+{
+    uint64_t fights {};
+    uint64_t mismatches {};
+};
+
+ForecastCheckResult CheckCombatForecast(const ForecastCheckConfig& config);
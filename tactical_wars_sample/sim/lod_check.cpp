@@ -0,0 +1,99 @@
+#include <sim/lod_check.hpp>
+
+#include <game/resource_cache.hpp>
+
+// Premultiplied, straight "over" compositing of every layer DrawLevel would draw at this pixel
+static glm::vec4 FlattenMapPixel(const Level& level, const glm::uvec2& pixel, const glm::uvec2& tile_size)
+{
+    auto cell = pixel / tile_size;
+    auto offset = pixel % tile_size;
+    auto& layers = level.map.getTileLayers();
+
+    glm::vec4 colour { 0.0f };
+
+    for (uint32_t l = 0; l < layers.size(); ++l)
+    {
+        if (!IsLayerDrawn(level, l, cell.x, cell.y))
+            continue;
+
+        auto tile_id = layers.at(l).tile_ids.at(cell.x, cell.y);
+        auto& tileset = level.map.getTileSets().at(tile_id.getTileset());
+        auto& draw_data = level.tile_set_data.at(tile_id.getTileset());
+        auto rect = tileset.getTileRect(GetAnimatedTileId(tileset, draw_data, tile_id.getId())).value();
+
+        // Tileset tiles are stretched to the map tile size
+        glm::uvec2 source = glm::uvec2 { rect.start.x, rect.start.y } + offset * glm::uvec2 { rect.size.x, rect.size.y } / tile_size;
+        const uint8_t* src = draw_data.cpu_pixels->data() + (size_t(source.y) * draw_data.image_size.x + source.x) * 4;
+
+        float alpha = src[3] / 255.0f;
+        colour = glm::vec4(src[0] * alpha, src[1] * alpha, src[2] * alpha, src[3]) + colour * (1.0f - alpha);
+    }
+
+    return colour;
+}
+
+LodCheckResult CheckLevelLod(Renderer& renderer, const LodCheckConfig& config)
+{
+    ResourceCache cache {};
+    Level level = LoadLevel(renderer, cache, config.map_path, true);
+
+    auto images = BakeLevelLodImages(level, config.chunk_texels, config.max_levels);
+
+    LodCheckResult result {};
+    result.levels = images.size();
+
+    if (images.empty())
+    {
+        return result;
+    }
+
+    auto tile_size = glm::uvec2 { level.map.getMapTileSize().x, level.map.getMapTileSize().y };
+    auto map_size = glm::uvec2 { level.map.getMapGridSize().x, level.map.getMapGridSize().y } * tile_size;
+
+    // Every map pixel is flattened once and added to the texel covering it on each level
+    std::vector<std::vector<glm::vec4>> sums(images.size());
+    std::vector<std::vector<uint32_t>> counts(images.size());
+
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        sums.at(i).assign(size_t(images.at(i).size.x) * images.at(i).size.y, glm::vec4(0.0f));
+        counts.at(i).assign(sums.at(i).size(), 0);
+    }
+
+    for (uint32_t y = 0; y < map_size.y; ++y)
+    {
+        for (uint32_t x = 0; x < map_size.x; ++x)
+        {
+            auto colour = FlattenMapPixel(level, { x, y }, tile_size);
+
+            for (size_t i = 0; i < images.size(); ++i)
+            {
+                auto texel = glm::uvec2 { x, y } / images.at(i).scale;
+                size_t index = size_t(texel.y) * images.at(i).size.x + texel.x;
+
+                sums.at(i).at(index) += colour;
+                counts.at(i).at(index)++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        auto& texels = images.at(i).texels;
+
+        for (size_t t = 0; t < texels.size(); ++t)
+        {
+            auto reference = glm::u8vec4(sums.at(i).at(t) / float(counts.at(i).at(t)) + 0.5f);
+            auto difference = glm::abs(glm::ivec4(texels.at(t)) - glm::ivec4(reference));
+            uint32_t largest = std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w));
+
+            result.max_difference = std::max(result.max_difference, largest);
+            result.compared_texels++;
+
+            if (largest > config.tolerance)
+                result.mismatches++;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <game/level_lod.hpp>
+
+// Compares every texel of the LOD pyramid with a reference built from the full resolution map:
+// each map pixel flattened through its visible layers, box averaged over the texel's footprint.
+// Texels are rounded to 8 bits once from float sums, the tolerance covers the last bit.
+// Tileset pixels are loaded through a renderer, see TacticalWarsSim.
+struct LodCheckConfig
+{
+    std::string map_path = "assets/maps/FinalMap.tmx";
+    uint8_t tolerance = 1; // Largest channel difference still counted as a match
+    uint32_t chunk_texels = 256; // As CreateLevelLod bakes it for the game
+    uint32_t max_levels = 6;
+};
+
+struct LodCheckResult
+{
+    uint32_t levels {};
+    uint64_t compared_texels {};
+    uint64_t mismatches {};
+    uint32_t max_difference {}; // Over every channel of every level
+};
+
+LodCheckResult CheckLevelLod(Renderer& renderer, const LodCheckConfig& config);
@@ -0,0 +1,282 @@
+#include <engine/common.hpp>
+
+#include <charconv>
+#include <engine/window.hpp>
+#include <game/render_target.hpp>
+#include <iostream>
+#include <sim/compositor_check.hpp>
+#include <sim/forecast_check.hpp>
+#include <sim/lod_check.hpp>
+#include <sim/undo_check.hpp>
+#include <sim/match_runner.hpp>
+
+// Headless self-play runner for balancing. Only the compositor and LOD checks create a window,
+// on the offscreen video driver with the software renderer.
+//
+// Usage: TacticalWarsSim [--matches N] [--threads N] [--seed N] [--max-turns N]
+//                        [--units N] [--layout default|random] [--map path.tmx]
+//                        [--red ai|scripted] [--blue ai|scripted] [--routing path|flow]
+//        TacticalWarsSim --verify-compositor FRAMES [--seed N] [--map path.tmx]
+//        TacticalWarsSim --verify-forecast MAX_DEFENCE
+//        TacticalWarsSim --verify-undo STEPS [--seed N] [--units N] [--map path.tmx]
+//        TacticalWarsSim --verify-lod TOLERANCE [--map path.tmx]
+//        TacticalWarsSim --lockstep-host PORT | --lockstep-join PORT [--lockstep-address ADDRESS]
+//                        [--seed N] [--units N] [--layout ...] [--map path.tmx] [--red ...] [--blue ...]
+
+static bool ParsePlayerKind(std::string_view value, PlayerKind& out)
+{
+    if (value == "ai")
+        out = PlayerKind::AI;
+    else if (value == "scripted")
+        out = PlayerKind::SCRIPTED;
+    else
+        return false;
+
+    return true;
+}
+
+static bool ParseRoutingKind(std::string_view value, RoutingKind& out)
+{
+    if (value == "path")
+        out = RoutingKind::PATH_GRAPH;
+    else if (value == "flow")
+        out = RoutingKind::FLOW_FIELD;
+    else
+        return false;
+
+    return true;
+}
+
+static bool ParseLayoutKind(std::string_view value, LayoutKind& out)
+{
+    if (value == "default")
+        out = LayoutKind::DEFAULT;
+    else if (value == "random")
+        out = LayoutKind::RANDOM;
+    else
+        return false;
+
+    return true;
+}
+
+template <typename T>
+static bool ParseNumber(std::string_view value, T& out)
+{
+    auto [ptr, error] = std::from_chars(value.data(), value.data() + value.size(), out);
+    return error == std::errc {} && ptr == value.data() + value.size();
+}
+
+// Checks run instead of the simulation when their option is given
+struct VerifyOptions
+{
+    uint32_t compositor_frames = 0;
+    std::optional<uint8_t> forecast_max_defence {};
+    uint32_t undo_steps = 0;
+    std::optional<uint8_t> lod_tolerance {};
+};
+
+static bool ParseArguments(int argc, char* argv[], SimulationConfig& config, VerifyOptions& verify)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string_view option = argv[i];
+        std::string_view value = argv[i + 1];
+        bool valid = true;
+
+        if (option == "--matches")
+            valid = ParseNumber(value, config.match_count);
+        else if (option == "--threads")
+            valid = ParseNumber(value, config.thread_count);
+        else if (option == "--seed")
+            valid = ParseNumber(value, config.seed);
+        else if (option == "--max-turns")
+            valid = ParseNumber(value, config.max_turns);
+        else if (option == "--units")
+            valid = ParseNumber(value, config.units_per_team);
+        else if (option == "--map")
+            config.map_path = value;
+        else if (option == "--layout")
+            valid = ParseLayoutKind(value, config.layout);
+        else if (option == "--red")
+            valid = ParsePlayerKind(value, config.players[UnitTeam::RED]);
+        else if (option == "--blue")
+            valid = ParsePlayerKind(value, config.players[UnitTeam::BLUE]);
+        else if (option == "--routing")
+            valid = ParseRoutingKind(value, config.routing);
+        else if (option == "--verify-compositor")
+            valid = ParseNumber(value, verify.compositor_frames);
+        else if (option == "--verify-forecast")
+            valid = ParseNumber(value, verify.forecast_max_defence.emplace());
+        else if (option == "--verify-undo")
+            valid = ParseNumber(value, verify.undo_steps);
+        else if (option == "--verify-lod")
+            valid = ParseNumber(value, verify.lod_tolerance.emplace());
+        else if (option == "--lockstep-host")
+        {
+            config.lockstep_role = LockstepRole::HOST;
+            valid = ParseNumber(value, config.lockstep_port);
+        }
+        else if (option == "--lockstep-join")
+        {
+            config.lockstep_role = LockstepRole::JOIN;
+            valid = ParseNumber(value, config.lockstep_port);
+        }
+        else if (option == "--lockstep-address")
+            config.lockstep_address = value;
+        else
+            valid = false;
+
+        if (!valid)
+        {
+            std::cerr << "Invalid argument: " << option << " " << value << "\n";
+            return false;
+        }
+    }
+
+    return argc % 2 == 1;
+}
+
+int main(int argc, char* argv[])
+{
+    SimulationConfig config {};
+    VerifyOptions verify {};
+
+    if (!ParseArguments(argc, argv, config, verify))
+    {
+        std::cerr << "Usage: TacticalWarsSim [--matches N] [--threads N] [--seed N] [--max-turns N] [--units N]"
+                     " [--layout default|random] [--map path.tmx] [--red ai|scripted] [--blue ai|scripted]"
+                     " [--routing path|flow] [--verify-compositor FRAMES] [--verify-forecast MAX_DEFENCE] [--verify-undo STEPS] [--verify-lod TOLERANCE] [--lockstep-host PORT] [--lockstep-join PORT] [--lockstep-address ADDRESS]\n";
+        return 1;
+    }
+
+    if (verify.compositor_frames > 0)
+    {
+        CompositorCheckConfig check_config {};
+        check_config.map_path = config.map_path;
+        check_config.frame_count = verify.compositor_frames;
+        check_config.seed = config.seed;
+
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        SDL::Init();
+
+        CompositorCheckResult check {};
+
+        {
+            const std::string title = "Compositor check";
+            auto window = std::make_unique<Window>(title, check_config.screen_size);
+            check = CheckCompositor(window->GetRenderer(), FindWindowRenderer(title), check_config);
+        }
+
+        SDL::Shutdown();
+
+        if (check.read_failed)
+        {
+            std::cerr << "Failed to read back the rendered frame\n";
+            return 1;
+        }
+
+        std::cout << std::format("Compositor ({}): {} frames, {} pixels compared\n", GetCompositorSimdName(), check.frames, check.compared_pixels);
+        std::cout << std::format("SIMD mismatches: {}, scalar mismatches: {}\n", check.simd_mismatches, check.scalar_mismatches);
+        return check.simd_mismatches == 0 && check.scalar_mismatches == 0 ? 0 : 1;
+    }
+
+    if (verify.forecast_max_defence)
+    {
+        ForecastCheckConfig check_config {};
+        check_config.max_defence = verify.forecast_max_defence.value();
+
+        auto check = CheckCombatForecast(check_config);
+
+        std::cout << std::format("Combat forecast: {} fights, {} mismatches\n", check.fights, check.mismatches);
+        return check.mismatches == 0 ? 0 : 1;
+    }
+
+    if (verify.undo_steps > 0)
+    {
+        UndoCheckConfig check_config {};
+        check_config.map_path = config.map_path;
+        check_config.step_count = verify.undo_steps;
+        check_config.seed = config.seed;
+        check_config.units_per_team = config.units_per_team;
+
+        auto check = CheckUndoHistory(check_config);
+
+        std::cout << std::format("Undo history: {} actions, {} undos, {} redos, {} mismatches\n", check.actions, check.undos, check.redos, check.mismatches);
+        return check.mismatches == 0 ? 0 : 1;
+    }
+
+    if (verify.lod_tolerance)
+    {
+        LodCheckConfig check_config {};
+        check_config.map_path = config.map_path;
+        check_config.tolerance = verify.lod_tolerance.value();
+
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        SDL::Init();
+
+        LodCheckResult check {};
+
+        {
+            auto window = std::make_unique<Window>("LOD check", glm::uvec2(64, 64));
+            check = CheckLevelLod(window->GetRenderer(), check_config);
+        }
+
+        SDL::Shutdown();
+
+        if (check.levels == 0)
+        {
+            std::cerr << "The map has no LOD levels, its tilesets have no CPU pixels\n";
+            return 1;
+        }
+
+        std::cout << std::format("LOD pyramid: {} levels, {} texels compared, largest difference {}/255\n", check.levels, check.compared_texels, check.max_difference);
+        std::cout << std::format("Mismatches over {}/255: {}\n", check_config.tolerance, check.mismatches);
+        return check.mismatches == 0 ? 0 : 1;
+    }
+
+    // Immutable and shared by every match, tileset images are not needed without a renderer
+    auto level = std::make_shared<Level>(LoadLevelData(config.map_path));
+
+    for (auto& tileset : level->map.getTileSets())
+    {
+        tileset.getImage().freeData();
+    }
+
+    if (config.lockstep_role != LockstepRole::NONE)
+    {
+        auto result = RunLockstepMatch(config, level);
+
+        if (!result.connected)
+        {
+            std::cerr << "Failed to connect to the lockstep peer\n";
+            return 1;
+        }
+
+        auto winner = !result.match.winner ? "none" : result.match.winner == UnitTeam::RED ? "red" : "blue";
+
+        std::cout << std::format("Lockstep: {} turns, winner: {}, checksum: {:016x}\n", result.match.turns, winner, result.checksum);
+        std::cout << std::format("Desynced: {}, disconnected: {}\n", result.desynced, result.disconnected);
+        return result.desynced || result.disconnected ? 1 : 0;
+    }
+
+    auto report = RunSimulation(config, level);
+    float seconds = report.duration.count() / 1000.0f;
+
+    std::cout << std::format("Matches: {} in {:.2f}s ({:.1f} matches/s, {:.1f} turns/s)\n",
+        report.matches, seconds, report.matches / seconds, report.turns / seconds);
+    std::cout << std::format("Average turns: {:.1f}\n", (float)report.turns / std::max(1u, report.matches));
+
+    for (auto [team, name] : { std::pair { UnitTeam::RED, "Red" }, std::pair { UnitTeam::BLUE, "Blue" } })
+    {
+        uint32_t wins = report.wins[team];
+
+        std::cout << std::format("{} wins: {} ({:.1f}%), average survivors: {:.2f}\n",
+            name, wins, 100.0f * wins / std::max(1u, report.matches),
+            (float)report.survivors[team] / std::max(1u, report.matches));
+    }
+
+    std::cout << std::format("Draws: {} ({:.1f}%)\n", report.draws, 100.0f * report.draws / std::max(1u, report.matches));
+    return 0;
+}
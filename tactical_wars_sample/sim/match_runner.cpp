@@ -0,0 +1,224 @@
+#include <sim/match_runner.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+static GameState SetupMatch(const SimulationConfig& config, std::shared_ptr<Level> level, uint64_t seed)
+{
+    GameState game_state {};
+    game_state.current_level = std::move(level);
+    game_state.unit_state = SetupUnitMapState(*game_state.current_level);
+    game_state.teams = { UnitTeam::RED, UnitTeam::BLUE };
+
+    auto layout = config.layout == LayoutKind::DEFAULT
+        ? DefaultStartingLayout()
+        : RandomStartingLayout(*game_state.current_level, config.units_per_team, seed);
+
+    ApplyStartingLayout(game_state.unit_state, layout);
+
+    game_state.rng.seed(seed);
+    return game_state;
+}
+
+static void CountSurvivors(const GameState& game_state, MatchResult& result)
+{
+    result.survivors.clear();
+
+    for (auto& unit : game_state.unit_state.units)
+    {
+        if (unit.health > 0)
+        {
+            ++result.survivors[unit.team];
+        }
+    }
+
+    if (result.survivors.size() == 1)
+    {
+        result.winner = result.survivors.begin()->first;
+    }
+}
+
+MatchResult RunMatch(const SimulationConfig& config, std::shared_ptr<Level> level, PathGraph& path_graph, uint64_t seed)
+{
+    // Matches already run in parallel, so the fields of one match are built on its own thread
+    std::optional<FlowFieldCache> flow_fields {};
+
+    if (config.routing == RoutingKind::FLOW_FIELD)
+    {
+        flow_fields = CreateFlowFieldCache(*level);
+    }
+
+    auto game_state = SetupMatch(config, std::move(level), seed);
+    MatchResult result {};
+
+    // The graph may have last seen another match, afterwards PlayTurn keeps it in sync
+    SyncPathGraphBlockers(path_graph, game_state.unit_state);
+
+    if (flow_fields)
+    {
+        SyncFlowFieldBlockers(flow_fields.value(), game_state.unit_state);
+    }
+
+    for (result.turns = 0; result.turns < config.max_turns; ++result.turns)
+    {
+        AdvanceTurn(game_state);
+        PlayTurn(game_state, config.players.at(GetCurrentTeam(game_state)), path_graph, game_state.rng, nullptr, flow_fields ? &flow_fields.value() : nullptr);
+
+        CountSurvivors(game_state, result);
+
+        if (result.survivors.size() < 2)
+        {
+            ++result.turns;
+            break;
+        }
+    }
+
+    return result;
+}
+
+LockstepMatchResult RunLockstepMatch(const SimulationConfig& config, std::shared_ptr<Level> level)
+{
+    auto game_state = SetupMatch(config, level, config.seed);
+    LockstepMatchResult result {};
+
+    auto session = config.lockstep_role == LockstepRole::HOST
+        ? HostLockstep(config.lockstep_port, game_state)
+        : JoinLockstep(config.lockstep_address, config.lockstep_port, game_state);
+
+    if (!session)
+    {
+        return result;
+    }
+
+    result.connected = true;
+    PathGraph path_graph = BuildPathGraph(*level);
+    auto& match = result.match;
+
+    std::optional<FlowFieldCache> flow_fields {};
+
+    if (config.routing == RoutingKind::FLOW_FIELD)
+    {
+        flow_fields = CreateFlowFieldCache(*level);
+        flow_fields->thread_count = std::max(1u, std::thread::hardware_concurrency());
+        SyncFlowFieldBlockers(flow_fields.value(), game_state.unit_state);
+    }
+
+    SyncPathGraphBlockers(path_graph, game_state.unit_state);
+
+    for (match.turns = 0; match.turns < config.max_turns; ++match.turns)
+    {
+        AdvanceTurn(game_state);
+        bool turn_ended = false;
+
+        if (IsLocalTurn(session.value(), game_state))
+        {
+            std::vector<UnitAction> actions {};
+            PlayTurn(game_state, config.players.at(session->local_team), path_graph, game_state.rng, &actions, flow_fields ? &flow_fields.value() : nullptr);
+
+            for (auto& action : actions)
+            {
+                SendLockstepAction(session.value(), game_state, action);
+            }
+
+            SendLockstepEndTurn(session.value(), game_state);
+            turn_ended = !session->disconnected;
+        }
+        else
+        {
+            while (!turn_ended && !session->desynced && !session->disconnected)
+            {
+                auto update = UpdateLockstep(session.value(), game_state, true);
+                turn_ended = update.turn_ended;
+
+                // The moves of the peer, so the next local turn routes around them
+                UpdatePathGraphBlockers(path_graph, game_state.unit_state, update.changed_tiles);
+
+                if (flow_fields)
+                {
+                    UpdateFlowFieldBlockers(flow_fields.value(), game_state.unit_state, update.changed_tiles);
+                }
+            }
+        }
+
+        if (!turn_ended)
+        {
+            break;
+        }
+
+        CountSurvivors(game_state, match);
+
+        if (match.survivors.size() < 2)
+        {
+            ++match.turns;
+            break;
+        }
+    }
+
+    result.desynced = session->desynced;
+    // The peer closes the connection after playing the last turn
+    result.disconnected = session->disconnected && match.survivors.size() > 1 && match.turns < config.max_turns;
+    result.checksum = ChecksumGameState(game_state);
+    return result;
+}
+
+SimulationReport RunSimulation(const SimulationConfig& config, std::shared_ptr<Level> level)
+{
+    uint32_t thread_count = config.thread_count != 0 ? config.thread_count : std::max(1u, std::thread::hardware_concurrency());
+    const PathGraph path_graph = BuildPathGraph(*level);
+
+    SimulationReport report {};
+    std::mutex report_mutex {};
+    std::atomic<uint32_t> next_match = 0;
+
+    Timer timer {};
+
+    auto worker = [&]()
+    {
+        PathGraph worker_graph = path_graph;
+        SimulationReport local {};
+
+        for (uint32_t match = next_match++; match < config.match_count; match = next_match++)
+        {
+            auto result = RunMatch(config, level, worker_graph, config.seed + match);
+
+            ++local.matches;
+            local.turns += result.turns;
+
+            if (result.winner)
+                ++local.wins[result.winner.value()];
+            else
+                ++local.draws;
+
+            for (auto& [team, count] : result.survivors)
+            {
+                local.survivors[team] += count;
+            }
+        }
+
+        std::scoped_lock lock { report_mutex };
+        report.matches += local.matches;
+        report.turns += local.turns;
+        report.draws += local.draws;
+
+        for (auto& [team, count] : local.wins)
+            report.wins[team] += count;
+        for (auto& [team, count] : local.survivors)
+            report.survivors[team] += count;
+    };
+
+    std::vector<std::thread> threads {};
+
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    report.duration = timer.GetElapsed();
+    return report;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <game/ai.hpp>
+#include <game/lockstep.hpp>
+#include <game/match_setup.hpp>
+
+enum class LayoutKind : uint8_t
+{
+    DEFAULT,
+    RANDOM
+};
+
+enum class RoutingKind : uint8_t
+{
+    PATH_GRAPH, // One hierarchical path per advancing unit
+    FLOW_FIELD // One shared flow field per targeted enemy
+};
+
+enum class LockstepRole : uint8_t
+{
+    NONE,
+    HOST,
+    JOIN
+};
+
+struct SimulationConfig
+{
+    std::string map_path = "assets/maps/FinalMap.tmx";
+    uint32_t match_count = 1000;
+    uint32_t thread_count = 0; // 0 uses every hardware thread
+    uint64_t seed = 0;
+    uint32_t max_turns = 200;
+    uint32_t units_per_team = 3;
+    LayoutKind layout = LayoutKind::RANDOM;
+    std::unordered_map<UnitTeam, PlayerKind> players = {
+        { UnitTeam::RED, PlayerKind::AI },
+        { UnitTeam::BLUE, PlayerKind::AI }
+    };
+    RoutingKind routing = RoutingKind::PATH_GRAPH;
+
+    LockstepRole lockstep_role = LockstepRole::NONE;
+    std::string lockstep_address = "127.0.0.1";
+    uint16_t lockstep_port = LOCKSTEP_DEFAULT_PORT;
+};
+
+struct MatchResult
+{
+    std::optional<UnitTeam> winner {};
+    uint32_t turns {};
+    std::unordered_map<UnitTeam, uint32_t> survivors {};
+};
+
+struct LockstepMatchResult
+{
+    MatchResult match {};
+    bool connected = false;
+    bool desynced = false;
+    bool disconnected = false;
+    uint64_t checksum {}; // Final game state, equal on both peers
+};
+
+struct SimulationReport
+{
+    uint32_t matches {};
+    uint64_t turns {};
+    std::unordered_map<UnitTeam, uint32_t> wins {};
+    std::unordered_map<UnitTeam, uint64_t> survivors {};
+    uint32_t draws {};
+    DeltaMS duration {};
+};
+
+MatchResult RunMatch(const SimulationConfig& config, std::shared_ptr<Level> level, PathGraph& path_graph, uint64_t seed);
+
+// Runs all matches on a pool of worker threads. Every match shares the same level,
+// each worker owns one copy of the path graph.
+SimulationReport RunSimulation(const SimulationConfig& config, std::shared_ptr<Level> level);
+
+// Plays one match against another process, each side only plans the turns of its own team.
+// Both sides need the same map, seed, layout and unit count.
+LockstepMatchResult RunLockstepMatch(const SimulationConfig& config, std::shared_ptr<Level> level);
@@ -0,0 +1,188 @@
+#include <sim/undo_check.hpp>
+
+#include <algorithm>
+#include <game/match_setup.hpp>
+#include <game/pathfinding.hpp>
+#include <tuple>
+
+struct UndoSnapshot
+{
+    UnitMapState unit_state {};
+    uint32_t turn_index {};
+};
+
+static bool MatchesSnapshot(const GameState& game_state, const UndoSnapshot& snapshot)
+{
+    if (game_state.turn_index != snapshot.turn_index)
+        return false;
+
+    for (auto it = snapshot.unit_state.units.begin(); it != snapshot.unit_state.units.end(); ++it)
+    {
+        if (game_state.unit_state.units.at(it.getIndices()) != *it)
+            return false;
+    }
+
+    return true;
+}
+
+static bool HasChanges(const UndoRecord& record)
+{
+    if (record.turn_before != record.turn_after)
+        return true;
+
+    for (auto& delta : record.deltas)
+    {
+        if (delta.before != delta.after)
+            return true;
+    }
+
+    return false;
+}
+
+// Random legal action of an idle unit of the current team, like the scripted player picks
+static std::optional<UnitAction> PickRandomAction(const GameState& game_state, std::mt19937_64& rng)
+{
+    const auto& level = *game_state.current_level;
+    const auto& unit_map = game_state.unit_state;
+    auto team = GetCurrentTeam(game_state);
+
+    std::vector<glm::uvec2> unit_tiles {};
+
+    for (auto it = unit_map.units.begin(); it != unit_map.units.end(); ++it)
+    {
+        if ((*it).health > 0 && (*it).team == team && (*it).state == UnitState::IDLE)
+            unit_tiles.emplace_back(it.getIndices().x, it.getIndices().y);
+    }
+
+    if (unit_tiles.empty())
+    {
+        return std::nullopt;
+    }
+
+    auto unit_tile = unit_tiles.at(rng() % unit_tiles.size());
+    std::vector<glm::uvec2> stop_tiles {};
+
+    for (auto& [tile, path] : FindMoveTiles(level, unit_map, unit_tile))
+    {
+        if (tile == unit_tile || unit_map.units.at(tile.x, tile.y).health <= 0)
+            stop_tiles.emplace_back(tile);
+    }
+
+    // Sorted, the move tiles come from a hash map
+    std::sort(stop_tiles.begin(), stop_tiles.end(), [](auto& lhs, auto& rhs)
+        { return std::tie(lhs.y, lhs.x) < std::tie(rhs.y, rhs.x); });
+
+    UnitAction action { unit_tile, stop_tiles.at(rng() % stop_tiles.size()) };
+    auto grid_size = level.map.getMapGridSize();
+    std::vector<glm::uvec2> targets {};
+
+    for (auto dir : { glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1) })
+    {
+        auto target = glm::ivec2(action.move_tile) + dir;
+
+        if (target.x < 0 || target.y < 0 || target.x >= (int)grid_size.x || target.y >= (int)grid_size.y)
+            continue;
+
+        auto other = unit_map.units.at(target.x, target.y);
+
+        if (other.health > 0 && other.team != team)
+            targets.emplace_back(target);
+    }
+
+    if (!targets.empty() && rng() % 2)
+    {
+        action.attack_tile = targets.at(rng() % targets.size());
+    }
+
+    return action;
+}
+
+UndoCheckResult CheckUndoHistory(const UndoCheckConfig& config)
+{
+    std::mt19937_64 rng { config.seed };
+
+    GameState game_state {};
+    game_state.current_level = std::make_shared<Level>(LoadLevelData(config.map_path));
+    game_state.unit_state = SetupUnitMapState(*game_state.current_level);
+    game_state.teams = { UnitTeam::RED, UnitTeam::BLUE };
+    game_state.turn_index = 0;
+
+    ApplyStartingLayout(game_state.unit_state, RandomStartingLayout(*game_state.current_level, config.units_per_team, rng()));
+
+    auto history = CreateUndoHistory(config.max_actions, config.max_deltas);
+
+    // Snapshot of every point of the history, the current one is at position
+    std::vector<UndoSnapshot> snapshots { { game_state.unit_state, game_state.turn_index } };
+    size_t position = 0;
+
+    UndoCheckResult result {};
+
+    auto push = [&](const UndoRecord& record)
+    {
+        if (!HasChanges(record))
+            return;
+
+        PushUndoRecord(history, record);
+
+        snapshots.resize(position + 1);
+        snapshots.push_back({ game_state.unit_state, game_state.turn_index });
+        position++;
+        result.actions++;
+    };
+
+    for (uint32_t step = 0; step < config.step_count; ++step)
+    {
+        uint32_t roll = rng() % 10;
+
+        if (roll < 5)
+        {
+            auto action = PickRandomAction(game_state, rng);
+
+            if (!action)
+                continue;
+
+            std::vector<glm::uvec2> tiles { action->unit_tile, action->move_tile };
+
+            if (action->attack_tile)
+            {
+                tiles.emplace_back(action->attack_tile.value());
+            }
+
+            auto record = BeginUndoRecord(game_state, tiles);
+            ApplyUnitAction(*game_state.current_level, game_state.unit_state, action.value());
+            FinishUndoRecord(record, game_state);
+            push(record);
+        }
+        else if (roll < 6)
+        {
+            uint32_t turn_before = game_state.turn_index;
+            auto reset_tiles = AdvanceTurn(game_state);
+            push(MakeTurnUndoRecord(game_state, reset_tiles, turn_before));
+        }
+        else if (roll < 8)
+        {
+            if (Undo(history, game_state))
+            {
+                position--;
+                result.undos++;
+            }
+        }
+        else if (Redo(history, game_state))
+        {
+            position++;
+            result.redos++;
+        }
+
+        result.mismatches += !MatchesSnapshot(game_state, snapshots.at(position));
+    }
+
+    // Everything still in the rings has to undo back to where it was recorded
+    while (Undo(history, game_state))
+    {
+        position--;
+        result.undos++;
+        result.mismatches += !MatchesSnapshot(game_state, snapshots.at(position));
+    }
+
+    return result;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <game/undo.hpp>
+
+// Randomised round trips through the undo history. Random moves, attacks and turn ends are
+// recorded the way the cursor and NextRound record them, mixed with undos and redos.
+// After every step the game must match the full snapshot taken at that point of the history.
+struct UndoCheckConfig
+{
+    std::string map_path = "assets/maps/FinalMap.tmx";
+    uint32_t step_count = 10000;
+    uint64_t seed = 0;
+    uint32_t units_per_team = 8;
+
+    // Small rings, so the oldest actions are evicted many times
+    uint32_t max_actions = 16;
+    uint32_t max_deltas = 48;
+};
+
+struct UndoCheckResult
+{
+    uint32_t actions {};
+    uint32_t undos {};
+    uint32_t redos {};
+    uint32_t mismatches {};
+};
+
+UndoCheckResult CheckUndoHistory(const UndoCheckConfig& config);